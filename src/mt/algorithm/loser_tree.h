@@ -0,0 +1,98 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace mkr {
+    /**
+     * A tournament tree of losers, used to repeatedly find the smallest head of k sorted sequences in a k-way merge.
+     * Replacing the winner only replays the matches on the path from its leaf to the root, which is log2(k) comparisons,
+     * each against a single stored loser, unlike a binary heap which compares against both children at each level.
+     *
+     * Invariants:
+     * - tree_[0] is the index of the overall winner.
+     * - tree_[n] for 0 < n < k is the index of the loser of the match at node n. The leaf of sequence i is node k+i.
+     * - An exhausted sequence loses every match.
+     * - Ties are won by the sequence with the smaller index, so a merge with a loser_tree is stable.
+     *
+     * @tparam T The typename of the keys.
+     * @tparam Compare The typename of the comparator.
+     */
+    template<typename T, typename Compare = std::less<>>
+    class loser_tree {
+    private:
+        /// The number of sequences.
+        std::size_t num_sequences_;
+        /// The tournament tree.
+        std::vector<std::size_t> tree_;
+        /// The current head of every sequence. std::nullopt if the sequence is exhausted.
+        std::vector<std::optional<T>> keys_;
+        /// The comparator.
+        Compare comp_;
+
+        /**
+         * @return Returns true if sequence _a beats sequence _b.
+         */
+        bool beats(std::size_t _a, std::size_t _b) const
+        {
+            if (!keys_[_a]) { return false; }
+            if (!keys_[_b]) { return true; }
+            if (comp_(*keys_[_a], *keys_[_b])) { return true; }
+            if (comp_(*keys_[_b], *keys_[_a])) { return false; }
+            return _a<_b;
+        }
+
+    public:
+        /**
+         * Constructs the tree and plays the initial tournament.
+         * @param _keys The first key of every sequence, or std::nullopt for an empty sequence. Must not be empty.
+         * @param _comp The comparator.
+         */
+        explicit loser_tree(std::vector<std::optional<T>> _keys, Compare _comp = {})
+                :num_sequences_{_keys.size()}, tree_(_keys.size(), 0), keys_{std::move(_keys)}, comp_{std::move(_comp)}
+        {
+            // Play the tournament bottom-up, remembering the winner of every node so that its parent can play it.
+            std::vector<std::size_t> winners(2*num_sequences_);
+            for (std::size_t i = 0; i<num_sequences_; ++i) { winners[num_sequences_+i] = i; }
+            for (std::size_t node = num_sequences_-1; node>0; --node) {
+                std::size_t left = winners[2*node];
+                std::size_t right = winners[2*node+1];
+                bool left_wins = beats(left, right);
+                winners[node] = left_wins ? left : right;
+                tree_[node] = left_wins ? right : left;
+            }
+            tree_[0] = num_sequences_==1 ? 0 : winners[1];
+        }
+
+        /**
+         * @return Returns true if every sequence is exhausted.
+         */
+        bool empty() const { return !keys_[tree_[0]]; }
+
+        /**
+         * @return The index of the sequence with the smallest head.
+         */
+        std::size_t top_index() const { return tree_[0]; }
+
+        /**
+         * @return The smallest head.
+         * @warning The behavior is undefined if empty()==true.
+         */
+        const T& top() const { return *keys_[tree_[0]]; }
+
+        /**
+         * Replace the smallest head with the next key of its sequence, and find the new smallest head.
+         * @param _next The next key of the winning sequence, or std::nullopt if it is exhausted.
+         */
+        void replace_top(std::optional<T> _next)
+        {
+            std::size_t winner = tree_[0];
+            keys_[winner] = std::move(_next);
+            for (std::size_t node = (winner+num_sequences_)/2; node>0; node /= 2) {
+                if (beats(tree_[node], winner)) { std::swap(tree_[node], winner); }
+            }
+            tree_[0] = winner;
+        }
+    };
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "../executor/spawn.h"
+#include "../thread_pool/thread_pool.h"
+#include "../util/concepts.h"
+
+#include <algorithm>
+#include <concepts>
+#include <utility>
+
+namespace mkr {
+    /**
+     * A one-dimensional half-open range [begin, end) that can be recursively split in half until it is no larger than its grain size.
+     * @tparam T The typename of the range's values. Must be an integral type.
+     */
+    template<std::integral T>
+    class blocked_range {
+    private:
+        /// The first value in the range.
+        T begin_;
+        /// One past the last value in the range.
+        T end_;
+        /// A range is not split further if its size is less than or equal to the grain size.
+        std::size_t grain_size_;
+
+    public:
+        /**
+         * Constructs the range.
+         * @param _begin The first value in the range.
+         * @param _end One past the last value in the range.
+         * @param _grain_size The range is not split further if its size is less than or equal to the grain size. Must be 1 or greater.
+         */
+        blocked_range(T _begin, T _end, std::size_t _grain_size = 1)
+                :begin_{_begin}, end_{std::max(_begin, _end)}, grain_size_{std::max<std::size_t>(_grain_size, 1)} { }
+
+        inline T begin() const { return begin_; }
+        inline T end() const { return end_; }
+        inline std::size_t size() const { return static_cast<std::size_t>(end_-begin_); }
+        inline std::size_t grain_size() const { return grain_size_; }
+        inline bool empty() const { return begin_==end_; }
+
+        /**
+         * Checks if the range can be split.
+         * @return Returns true if the size of the range is greater than the grain size.
+         */
+        inline bool is_divisible() const { return size()>grain_size_; }
+
+        /**
+         * Split the range in half. This range keeps the first half.
+         * @return The second half of the range.
+         * @warning The behavior is undefined if is_divisible()==false.
+         */
+        blocked_range split()
+        {
+            T mid = begin_+static_cast<T>(size()/2);
+            blocked_range right{mid, end_, grain_size_};
+            end_ = mid;
+            return right;
+        }
+    };
+
+    /**
+     * A two-dimensional range of rows and columns, for tiling matrix, image and grid kernels.
+     * Each split halves the longer divisible dimension, so the pieces stay close to square tiles of about row grain size by column grain size,
+     * which keeps the rows and columns touched by a tile in cache.
+     * @tparam RowT The typename of the row values. Must be an integral type.
+     * @tparam ColT The typename of the column values. Must be an integral type.
+     */
+    template<std::integral RowT, std::integral ColT = RowT>
+    class blocked_range2d {
+    private:
+        /// The rows of the range.
+        blocked_range<RowT> rows_;
+        /// The columns of the range.
+        blocked_range<ColT> cols_;
+
+    public:
+        /**
+         * Constructs the range.
+         * @param _rows The rows of the range.
+         * @param _cols The columns of the range.
+         */
+        blocked_range2d(const blocked_range<RowT>& _rows, const blocked_range<ColT>& _cols)
+                :rows_{_rows}, cols_{_cols} { }
+
+        /**
+         * Constructs the range.
+         * @param _row_begin The first row in the range.
+         * @param _row_end One past the last row in the range.
+         * @param _row_grain_size The rows are not split further if there are no more of them than the grain size.
+         * @param _col_begin The first column in the range.
+         * @param _col_end One past the last column in the range.
+         * @param _col_grain_size The columns are not split further if there are no more of them than the grain size.
+         */
+        blocked_range2d(RowT _row_begin, RowT _row_end, std::size_t _row_grain_size, ColT _col_begin, ColT _col_end, std::size_t _col_grain_size)
+                :rows_{_row_begin, _row_end, _row_grain_size}, cols_{_col_begin, _col_end, _col_grain_size} { }
+
+        inline const blocked_range<RowT>& rows() const { return rows_; }
+        inline const blocked_range<ColT>& cols() const { return cols_; }
+        inline bool empty() const { return rows_.empty() || cols_.empty(); }
+
+        /**
+         * Checks if the range can be split.
+         * @return Returns true if either dimension can be split.
+         */
+        inline bool is_divisible() const { return rows_.is_divisible() || cols_.is_divisible(); }
+
+        /**
+         * Split the longer divisible dimension in half. This range keeps the first half.
+         * @return The second half of the range.
+         * @warning The behavior is undefined if is_divisible()==false.
+         */
+        blocked_range2d split()
+        {
+            if (rows_.is_divisible() && (!cols_.is_divisible() || rows_.size()>=cols_.size())) {
+                return blocked_range2d{rows_.split(), cols_};
+            }
+            return blocked_range2d{rows_, cols_.split()};
+        }
+    };
+
+    /**
+     * A three-dimensional range of pages, rows and columns, for tiling volume and grid kernels.
+     * Each split halves the longest divisible dimension.
+     * @tparam PageT The typename of the page values. Must be an integral type.
+     * @tparam RowT The typename of the row values. Must be an integral type.
+     * @tparam ColT The typename of the column values. Must be an integral type.
+     */
+    template<std::integral PageT, std::integral RowT = PageT, std::integral ColT = RowT>
+    class blocked_range3d {
+    private:
+        /// The pages of the range.
+        blocked_range<PageT> pages_;
+        /// The rows of the range.
+        blocked_range<RowT> rows_;
+        /// The columns of the range.
+        blocked_range<ColT> cols_;
+
+    public:
+        /**
+         * Constructs the range.
+         * @param _pages The pages of the range.
+         * @param _rows The rows of the range.
+         * @param _cols The columns of the range.
+         */
+        blocked_range3d(const blocked_range<PageT>& _pages, const blocked_range<RowT>& _rows, const blocked_range<ColT>& _cols)
+                :pages_{_pages}, rows_{_rows}, cols_{_cols} { }
+
+        inline const blocked_range<PageT>& pages() const { return pages_; }
+        inline const blocked_range<RowT>& rows() const { return rows_; }
+        inline const blocked_range<ColT>& cols() const { return cols_; }
+        inline bool empty() const { return pages_.empty() || rows_.empty() || cols_.empty(); }
+
+        /**
+         * Checks if the range can be split.
+         * @return Returns true if any dimension can be split.
+         */
+        inline bool is_divisible() const { return pages_.is_divisible() || rows_.is_divisible() || cols_.is_divisible(); }
+
+        /**
+         * Split the longest divisible dimension in half. This range keeps the first half.
+         * @return The second half of the range.
+         * @warning The behavior is undefined if is_divisible()==false.
+         */
+        blocked_range3d split()
+        {
+            // The size of each dimension, or 0 if it cannot be split.
+            const std::size_t page_size = pages_.is_divisible() ? pages_.size() : 0;
+            const std::size_t row_size = rows_.is_divisible() ? rows_.size() : 0;
+            const std::size_t col_size = cols_.is_divisible() ? cols_.size() : 0;
+
+            if (page_size>=row_size && page_size>=col_size) {
+                return blocked_range3d{pages_.split(), rows_, cols_};
+            }
+            if (row_size>=col_size) {
+                return blocked_range3d{pages_, rows_.split(), cols_};
+            }
+            return blocked_range3d{pages_, rows_, cols_.split()};
+        }
+    };
+
+    /**
+     * A range which can be recursively split by mkr::parallel_for.
+     */
+    template<class R>
+    concept splittable_range = std::copy_constructible<R> && requires(R _range) {
+        { _range.is_divisible() } -> std::convertible_to<bool>;
+        { _range.split() } -> std::same_as<R>;
+    };
+
+    /**
+     * Recursively split a range and run the body on each of the pieces on the executor.
+     * The calling thread works on one half of each split and runs pending tasks while waiting for the other half,
+     * so it is safe to call parallel_for from within a task running on the same executor.
+     * @tparam Range The typename of the range.
+     * @tparam Body The typename of the body. It is invoked with a sub-range that is no longer divisible.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _range The range to iterate over.
+     * @param _body The body to invoke on each sub-range.
+     */
+    template<executor Executor, splittable_range Range, typename Body>
+    void parallel_for(Executor& _executor, Range _range, const Body& _body)
+        requires mkr::is_consumer<const Body&, const Range&>
+    {
+        if (!_range.is_divisible()) {
+            std::invoke(_body, std::as_const(_range));
+            return;
+        }
+
+        Range right = _range.split();
+        auto fork = spawn(_executor, [&_executor, right, &_body]() {
+            parallel_for(_executor, right, _body);
+        });
+
+        // The forked task references _body, so it must be finished before this function returns, even if the other half throws.
+        try {
+            parallel_for(_executor, std::move(_range), _body);
+        }
+        catch (...) {
+            _executor.run_pending_tasks(fork);
+            throw;
+        }
+
+        _executor.run_pending_tasks(fork);
+        fork.get();
+    }
+}
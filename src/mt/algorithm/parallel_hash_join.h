@@ -0,0 +1,195 @@
+#pragma once
+
+#include "parallel_for.h"
+#include "../util/hardware.h"
+
+#include <bit>
+#include <limits>
+#include <ranges>
+#include <vector>
+
+namespace mkr {
+    namespace detail {
+        /**
+         * A row of a partitioned join input. Only the hash and the position of the row are moved around,
+         * the rows themselves are never copied.
+         */
+        struct hash_join_entry {
+            /// The mixed hash of the row's key.
+            std::size_t hash_;
+            /// The index of the row in its input range.
+            std::size_t index_;
+        };
+
+        /**
+         * std::hash is the identity function for integral types on most standard libraries, which leaves the high bits empty.
+         * Both the partition (high bits) and the hash table slot (low bits) are taken from the hash, so the bits are mixed first.
+         * @param _hash The hash to mix.
+         * @return The mixed hash. (Finalizer of MurmurHash3.)
+         */
+        constexpr std::size_t mix_hash(std::size_t _hash)
+        {
+            std::uint64_t h = _hash;
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdULL;
+            h ^= h >> 33;
+            h *= 0xc4ceb9fe1a85ec53ULL;
+            h ^= h >> 33;
+            return static_cast<std::size_t>(h);
+        }
+
+        /**
+         * Radix-partition a range by the high bits of the hash of its keys.
+         * The range is split into chunks. Each chunk is hashed and histogrammed by one task, and after a prefix sum
+         * each chunk scatters its entries into a disjoint region of the output, so no locks are needed.
+         * @tparam Executor The typename of the executor.
+         * @param _executor The executor to run on.
+         * @param _rows The rows to partition.
+         * @param _key_fn The function which returns the key of a row.
+         * @param _partition_bits log2 of the number of partitions.
+         * @param _offsets Output. Partition p occupies [_offsets[p], _offsets[p+1]) of the returned entries.
+         * @return The partitioned entries.
+         */
+        template<executor Executor, typename Range, typename KeyFn>
+        std::vector<hash_join_entry> radix_partition(Executor& _executor, const Range& _rows, const KeyFn& _key_fn,
+                                                     unsigned _partition_bits, std::vector<std::size_t>& _offsets)
+        {
+            typedef std::remove_cvref_t<std::invoke_result_t<const KeyFn&, std::ranges::range_reference_t<const Range>>> key_type;
+
+            const std::size_t num_rows = std::ranges::size(_rows);
+            const std::size_t num_partitions = std::size_t{1} << _partition_bits;
+            // Take the partition from the high bits. When there is only 1 partition, every entry belongs to partition 0.
+            auto partition_of = [_partition_bits](std::size_t _hash) -> std::size_t {
+                return _partition_bits==0 ? 0 : _hash >> (std::numeric_limits<std::size_t>::digits-_partition_bits);
+            };
+
+            // Enough chunks to keep every thread busy, but not so many that the histograms dominate.
+            constexpr std::size_t min_chunk_size = 4096;
+            const std::size_t num_chunks = std::clamp<std::size_t>(num_rows/min_chunk_size, 1, 4*(_executor.num_threads()+1));
+            auto chunk_begin = [num_rows, num_chunks](std::size_t _chunk) { return _chunk*num_rows/num_chunks; };
+
+            // Pass 1: Hash every row and count the rows of each chunk that belong to each partition.
+            std::vector<std::size_t> hashes(num_rows);
+            std::vector<std::size_t> histograms(num_chunks*num_partitions, 0);
+            parallel_for(_executor, blocked_range<std::size_t>{0, num_chunks}, [&](const blocked_range<std::size_t>& _chunks) {
+                for (std::size_t c = _chunks.begin(); c<_chunks.end(); ++c) {
+                    std::size_t* histogram = &histograms[c*num_partitions];
+                    for (std::size_t i = chunk_begin(c); i<chunk_begin(c+1); ++i) {
+                        hashes[i] = mix_hash(std::hash<key_type>{}(std::invoke(_key_fn, _rows[i])));
+                        ++histogram[partition_of(hashes[i])];
+                    }
+                }
+            });
+
+            // Prefix sum. Partitions are laid out one after another, and within a partition, chunks are laid out in order.
+            // Afterwards, histograms[c*num_partitions+p] is the position at which chunk c writes its first entry of partition p.
+            _offsets.assign(num_partitions+1, 0);
+            std::size_t position = 0;
+            for (std::size_t p = 0; p<num_partitions; ++p) {
+                _offsets[p] = position;
+                for (std::size_t c = 0; c<num_chunks; ++c) {
+                    std::size_t count = histograms[c*num_partitions+p];
+                    histograms[c*num_partitions+p] = position;
+                    position += count;
+                }
+            }
+            _offsets[num_partitions] = position;
+
+            // Pass 2: Scatter the entries into their partitions.
+            std::vector<hash_join_entry> entries(num_rows);
+            parallel_for(_executor, blocked_range<std::size_t>{0, num_chunks}, [&](const blocked_range<std::size_t>& _chunks) {
+                for (std::size_t c = _chunks.begin(); c<_chunks.end(); ++c) {
+                    std::size_t* cursor = &histograms[c*num_partitions];
+                    for (std::size_t i = chunk_begin(c); i<chunk_begin(c+1); ++i) {
+                        entries[cursor[partition_of(hashes[i])]++] = hash_join_entry{hashes[i], i};
+                    }
+                }
+            });
+
+            return entries;
+        }
+    }
+
+    /**
+     * Parallel radix-partitioned hash join. Emits a row for every pair of build and probe rows with equal keys.
+     *
+     * Both inputs are radix-partitioned on the hash of their keys, so that the hash table of each build partition fits in the L2 cache.
+     * Each group of partitions is then built and probed by a single task using a private open-addressing hash table, so neither
+     * building nor probing takes any locks. Each task appends its output rows to its own output buffer.
+     *
+     * @tparam BuildRange The typename of the build side. Must be a random access range. It should be the smaller of the two inputs.
+     * @tparam ProbeRange The typename of the probe side. Must be a random access range.
+     * @tparam KeyFn The typename of the key function. It must accept rows from both sides, and the key type must be hashable by std::hash and equality comparable.
+     * @tparam Emit The typename of the emit function. It is invoked with the matching build and probe rows, and returns the output row.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _build The build side.
+     * @param _probe The probe side.
+     * @param _key_fn The function which returns the key of a row.
+     * @param _emit The function which constructs an output row from a matching pair of rows. It may be invoked concurrently.
+     * @param _cache_size The number of bytes of the cache that a partition's hash table should fit in.
+     * @return The output buffers, one per task. The order of the output rows is unspecified.
+     */
+    template<executor Executor, std::ranges::random_access_range BuildRange, std::ranges::random_access_range ProbeRange, typename KeyFn, typename Emit>
+    auto parallel_hash_join(Executor& _executor, const BuildRange& _build, const ProbeRange& _probe, const KeyFn& _key_fn,
+                            const Emit& _emit, std::size_t _cache_size = l2_cache_size())
+        requires std::ranges::sized_range<BuildRange> && std::ranges::sized_range<ProbeRange> &&
+                 mkr::is_function<const Emit&, std::ranges::range_reference_t<const BuildRange>, std::ranges::range_reference_t<const ProbeRange>>
+    {
+        typedef std::invoke_result_t<const Emit&, std::ranges::range_reference_t<const BuildRange>, std::ranges::range_reference_t<const ProbeRange>> output_type;
+        typedef detail::hash_join_entry entry;
+
+        // Size the partitions so that each hash table, at a load factor of 0.5, takes up at most half of the cache.
+        // The other half is left for the probe entries and output buffers streaming through.
+        constexpr unsigned max_partition_bits = 14;
+        const std::size_t table_bytes = 2*std::ranges::size(_build)*sizeof(entry);
+        const std::size_t wanted_partitions = table_bytes/std::max<std::size_t>(_cache_size/2, sizeof(entry))+1;
+        const unsigned partition_bits = std::min<unsigned>(std::bit_width(std::bit_ceil(wanted_partitions))-1, max_partition_bits);
+        const std::size_t num_partitions = std::size_t{1} << partition_bits;
+
+        std::vector<std::size_t> build_offsets, probe_offsets;
+        std::vector<entry> build_entries = detail::radix_partition(_executor, _build, _key_fn, partition_bits, build_offsets);
+        std::vector<entry> probe_entries = detail::radix_partition(_executor, _probe, _key_fn, partition_bits, probe_offsets);
+
+        // Group the partitions into tasks. Each task owns one output buffer.
+        const std::size_t num_tasks = std::min(num_partitions, 4*(_executor.num_threads()+1));
+        std::vector<std::vector<output_type>> outputs(num_tasks);
+
+        parallel_for(_executor, blocked_range<std::size_t>{0, num_tasks}, [&](const blocked_range<std::size_t>& _tasks) {
+            constexpr std::size_t empty_slot = std::numeric_limits<std::size_t>::max();
+            std::vector<entry> table;
+
+            for (std::size_t t = _tasks.begin(); t<_tasks.end(); ++t) {
+                std::vector<output_type>& output = outputs[t];
+                for (std::size_t p = t*num_partitions/num_tasks; p<(t+1)*num_partitions/num_tasks; ++p) {
+                    const std::size_t build_count = build_offsets[p+1]-build_offsets[p];
+                    if (build_count==0 || probe_offsets[p+1]==probe_offsets[p]) { continue; }
+
+                    // Build. Linear probing on the low bits of the hash. Duplicate keys occupy separate slots.
+                    const std::size_t mask = std::bit_ceil(2*build_count)-1;
+                    table.assign(mask+1, entry{0, empty_slot});
+                    for (std::size_t i = build_offsets[p]; i<build_offsets[p+1]; ++i) {
+                        std::size_t slot = build_entries[i].hash_ & mask;
+                        while (table[slot].index_!=empty_slot) { slot = (slot+1) & mask; }
+                        table[slot] = build_entries[i];
+                    }
+
+                    // Probe. Every slot up to the next empty slot may hold a match.
+                    for (std::size_t i = probe_offsets[p]; i<probe_offsets[p+1]; ++i) {
+                        const entry& probe_entry = probe_entries[i];
+                        for (std::size_t slot = probe_entry.hash_ & mask; table[slot].index_!=empty_slot; slot = (slot+1) & mask) {
+                            if (table[slot].hash_!=probe_entry.hash_) { continue; }
+                            const auto& build_row = _build[table[slot].index_];
+                            const auto& probe_row = _probe[probe_entry.index_];
+                            if (std::invoke(_key_fn, build_row)==std::invoke(_key_fn, probe_row)) {
+                                output.push_back(std::invoke(_emit, build_row, probe_row));
+                            }
+                        }
+                    }
+                }
+            }
+        });
+
+        return outputs;
+    }
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "parallel_for.h"
+#include "parallel_scan.h"
+#include "parallel_sort.h"
+
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace mkr {
+    /**
+     * An execution policy which runs the algorithms below on an executor, such as a mkr::thread_pool.
+     * It takes the place of std::execution::par, whose backend does not know about the thread pool and oversubscribes the machine.
+     * Code written against the standard parallel algorithms migrates by swapping the namespace and the policy:
+     * @code
+     * std::sort(std::execution::par, v.begin(), v.end());  // Before
+     * mkr::sort(mkr::par(pool), v.begin(), v.end());       // After
+     * @endcode
+     * @tparam Executor The typename of the executor.
+     */
+    template<executor Executor>
+    class parallel_policy {
+    private:
+        /// The executor to run on.
+        Executor* executor_;
+        /// The number of elements processed by a task. If 0, a few tasks per thread are created.
+        std::size_t grain_size_;
+
+    public:
+        /**
+         * Constructs the policy.
+         * @param _executor The executor to run on.
+         * @param _grain_size The number of elements processed by a task. If 0, a few tasks per thread are created.
+         */
+        explicit parallel_policy(Executor& _executor, std::size_t _grain_size = 0)
+                :executor_{&_executor}, grain_size_{_grain_size} { }
+
+        inline Executor& get_executor() const { return *executor_; }
+
+        /**
+         * @param _grain_size The number of elements processed by a task.
+         * @return A copy of this policy with a different grain size.
+         */
+        inline parallel_policy with_grain_size(std::size_t _grain_size) const { return parallel_policy{*executor_, _grain_size}; }
+
+        /**
+         * @param _num_elements The number of elements to process.
+         * @return The number of elements processed by a task.
+         */
+        std::size_t grain_size(std::size_t _num_elements) const
+        {
+            if (grain_size_!=0) { return grain_size_; }
+            // A few tasks per thread lets stealing balance uneven work without creating many tiny tasks.
+            return std::max<std::size_t>(_num_elements/(4*(executor_->num_threads()+1)), 1);
+        }
+    };
+
+    /**
+     * Create a parallel execution policy.
+     * @param _executor The executor to run on.
+     * @param _grain_size The number of elements processed by a task. If 0, a few tasks per thread are created.
+     * @return The policy.
+     */
+    template<executor Executor>
+    parallel_policy<Executor> par(Executor& _executor, std::size_t _grain_size = 0)
+    {
+        return parallel_policy<Executor>{_executor, _grain_size};
+    }
+
+    namespace detail {
+        template<typename T>
+        struct is_parallel_policy : std::false_type { };
+
+        template<typename Executor>
+        struct is_parallel_policy<parallel_policy<Executor>> : std::true_type { };
+    }
+
+    /**
+     * A mkr::parallel_policy.
+     */
+    template<typename P>
+    concept execution_policy = detail::is_parallel_policy<std::remove_cvref_t<P>>::value;
+
+    /**
+     * Parallel std::for_each.
+     * @param _policy The execution policy.
+     * @param _first The beginning of the range.
+     * @param _last The end of the range.
+     * @param _func The function to invoke on every element. It may be invoked concurrently.
+     */
+    template<execution_policy Policy, std::random_access_iterator RandomIt, typename Func>
+    void for_each(const Policy& _policy, RandomIt _first, RandomIt _last, Func _func)
+    {
+        const std::size_t num_elements = static_cast<std::size_t>(std::distance(_first, _last));
+        parallel_for(_policy.get_executor(), blocked_range<std::size_t>{0, num_elements, _policy.grain_size(num_elements)},
+                     [&](const blocked_range<std::size_t>& _range) {
+            for (std::size_t i = _range.begin(); i<_range.end(); ++i) { std::invoke(_func, _first[i]); }
+        });
+    }
+
+    /**
+     * Parallel std::transform of one range.
+     * @param _policy The execution policy.
+     * @param _first The beginning of the input.
+     * @param _last The end of the input.
+     * @param _d_first The beginning of the output.
+     * @param _op The operation to invoke on every element. It may be invoked concurrently.
+     * @return The end of the output.
+     */
+    template<execution_policy Policy, std::random_access_iterator InputIt, std::random_access_iterator OutputIt, typename UnaryOp>
+    OutputIt transform(const Policy& _policy, InputIt _first, InputIt _last, OutputIt _d_first, UnaryOp _op)
+    {
+        const std::size_t num_elements = static_cast<std::size_t>(std::distance(_first, _last));
+        parallel_for(_policy.get_executor(), blocked_range<std::size_t>{0, num_elements, _policy.grain_size(num_elements)},
+                     [&](const blocked_range<std::size_t>& _range) {
+            for (std::size_t i = _range.begin(); i<_range.end(); ++i) { _d_first[i] = std::invoke(_op, _first[i]); }
+        });
+        return _d_first+static_cast<std::ptrdiff_t>(num_elements);
+    }
+
+    /**
+     * Parallel std::transform of two ranges.
+     * @param _policy The execution policy.
+     * @param _first1 The beginning of the first input.
+     * @param _last1 The end of the first input.
+     * @param _first2 The beginning of the second input. It must be at least as long as the first input.
+     * @param _d_first The beginning of the output.
+     * @param _op The operation to invoke on every pair of elements. It may be invoked concurrently.
+     * @return The end of the output.
+     */
+    template<execution_policy Policy, std::random_access_iterator InputIt1, std::random_access_iterator InputIt2,
+             std::random_access_iterator OutputIt, typename BinaryOp>
+    OutputIt transform(const Policy& _policy, InputIt1 _first1, InputIt1 _last1, InputIt2 _first2, OutputIt _d_first, BinaryOp _op)
+    {
+        const std::size_t num_elements = static_cast<std::size_t>(std::distance(_first1, _last1));
+        parallel_for(_policy.get_executor(), blocked_range<std::size_t>{0, num_elements, _policy.grain_size(num_elements)},
+                     [&](const blocked_range<std::size_t>& _range) {
+            for (std::size_t i = _range.begin(); i<_range.end(); ++i) { _d_first[i] = std::invoke(_op, _first1[i], _first2[i]); }
+        });
+        return _d_first+static_cast<std::ptrdiff_t>(num_elements);
+    }
+
+    /**
+     * Parallel std::reduce.
+     * @param _policy The execution policy.
+     * @param _first The beginning of the range.
+     * @param _last The end of the range.
+     * @param _init The initial value.
+     * @param _op The reduction. It must be associative and commutative, as the elements are reduced in an unspecified order.
+     * @return The reduction of _init and every element.
+     */
+    template<execution_policy Policy, std::random_access_iterator RandomIt, typename T, typename BinaryOp = std::plus<>>
+    T reduce(const Policy& _policy, RandomIt _first, RandomIt _last, T _init, BinaryOp _op = {})
+    {
+        const std::size_t num_elements = static_cast<std::size_t>(std::distance(_first, _last));
+        if (num_elements==0) { return _init; }
+
+        // Each block is reduced starting from its first element, because there is no identity value to start from.
+        const std::size_t grain_size = _policy.grain_size(num_elements);
+        const std::size_t num_blocks = (num_elements+grain_size-1)/grain_size;
+        std::vector<std::optional<T>> block_sums(num_blocks);
+        parallel_for(_policy.get_executor(), blocked_range<std::size_t>{0, num_blocks}, [&](const blocked_range<std::size_t>& _blocks) {
+            for (std::size_t b = _blocks.begin(); b<_blocks.end(); ++b) {
+                const std::size_t end = std::min((b+1)*grain_size, num_elements);
+                T sum = static_cast<T>(_first[b*grain_size]);
+                for (std::size_t i = b*grain_size+1; i<end; ++i) { sum = std::invoke(_op, std::move(sum), _first[i]); }
+                block_sums[b].emplace(std::move(sum));
+            }
+        });
+
+        for (std::optional<T>& block_sum : block_sums) { _init = std::invoke(_op, std::move(_init), std::move(*block_sum)); }
+        return _init;
+    }
+
+    /**
+     * Parallel std::reduce with std::plus, starting from a value-initialised element.
+     * @param _policy The execution policy.
+     * @param _first The beginning of the range.
+     * @param _last The end of the range.
+     * @return The sum of every element.
+     */
+    template<execution_policy Policy, std::random_access_iterator RandomIt>
+    typename std::iterator_traits<RandomIt>::value_type reduce(const Policy& _policy, RandomIt _first, RandomIt _last)
+    {
+        return reduce(_policy, _first, _last, typename std::iterator_traits<RandomIt>::value_type{});
+    }
+
+    /**
+     * Parallel std::sort. The sort is stable, like std::stable_sort.
+     * @param _policy The execution policy.
+     * @param _first The beginning of the range.
+     * @param _last The end of the range.
+     * @param _comp The comparator.
+     */
+    template<execution_policy Policy, std::random_access_iterator RandomIt, typename Compare = std::less<>>
+    void sort(const Policy& _policy, RandomIt _first, RandomIt _last, Compare _comp = {})
+    {
+        const std::size_t num_elements = static_cast<std::size_t>(std::distance(_first, _last));
+        parallel_sort(_policy.get_executor(), _first, _last, _comp, _policy.grain_size(num_elements));
+    }
+
+    /**
+     * Parallel std::copy_if. The copied elements keep their relative order.
+     *
+     * The predicate is evaluated once per element in parallel, the number of selected elements of each block is scanned to find where
+     * each block's elements go, and the blocks are then copied in parallel.
+     *
+     * @param _policy The execution policy.
+     * @param _first The beginning of the input.
+     * @param _last The end of the input.
+     * @param _d_first The beginning of the output.
+     * @param _pred The predicate. It may be invoked concurrently.
+     * @return The end of the output.
+     */
+    template<execution_policy Policy, std::random_access_iterator InputIt, std::random_access_iterator OutputIt, typename Predicate>
+    OutputIt copy_if(const Policy& _policy, InputIt _first, InputIt _last, OutputIt _d_first, Predicate _pred)
+    {
+        const std::size_t num_elements = static_cast<std::size_t>(std::distance(_first, _last));
+        if (num_elements==0) { return _d_first; }
+
+        const std::size_t grain_size = _policy.grain_size(num_elements);
+        const std::size_t num_blocks = (num_elements+grain_size-1)/grain_size;
+        // std::vector<bool> packs bits, so neighbouring blocks would write to the same word.
+        std::vector<char> selected(num_elements);
+        std::vector<std::size_t> offsets(num_blocks);
+
+        // Pass 1: Evaluate the predicate, and count the selected elements of each block.
+        parallel_for(_policy.get_executor(), blocked_range<std::size_t>{0, num_blocks}, [&](const blocked_range<std::size_t>& _blocks) {
+            for (std::size_t b = _blocks.begin(); b<_blocks.end(); ++b) {
+                std::size_t count = 0;
+                for (std::size_t i = b*grain_size; i<std::min((b+1)*grain_size, num_elements); ++i) {
+                    selected[i] = std::invoke(_pred, _first[i]) ? 1 : 0;
+                    count += selected[i];
+                }
+                offsets[b] = count;
+            }
+        });
+
+        const std::size_t total = parallel_exclusive_scan(_policy.get_executor(), offsets.begin(), offsets.end(), offsets.begin(), std::size_t{0});
+
+        // Pass 2: Copy the selected elements of each block to its offset.
+        parallel_for(_policy.get_executor(), blocked_range<std::size_t>{0, num_blocks}, [&](const blocked_range<std::size_t>& _blocks) {
+            for (std::size_t b = _blocks.begin(); b<_blocks.end(); ++b) {
+                OutputIt out = _d_first+static_cast<std::ptrdiff_t>(offsets[b]);
+                for (std::size_t i = b*grain_size; i<std::min((b+1)*grain_size, num_elements); ++i) {
+                    if (selected[i]) { *out++ = _first[i]; }
+                }
+            }
+        });
+        return _d_first+static_cast<std::ptrdiff_t>(total);
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "parallel_for.h"
+
+namespace mkr {
+    /**
+     * Recursively split a range, reduce each of the pieces on the executor, and join the partial results.
+     * The calling thread works on one half of each split and runs pending tasks while waiting for the other half,
+     * so it is safe to call parallel_reduce from within a task running on the same executor.
+     * @tparam Range The typename of the range.
+     * @tparam T The typename of the result.
+     * @tparam Body The typename of the body. It is invoked with a sub-range that is no longer divisible and an initial value, and returns the reduction of the sub-range.
+     * @tparam Join The typename of the join function. It is invoked with the results of two adjacent sub-ranges, and returns their reduction.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _range The range to reduce.
+     * @param _identity The identity value of the reduction.
+     * @param _body The body to invoke on each sub-range.
+     * @param _join The function to join the results of two sub-ranges.
+     * @return The reduction of the range.
+     */
+    template<executor Executor, splittable_range Range, typename T, typename Body, typename Join>
+    T parallel_reduce(Executor& _executor, Range _range, const T& _identity, const Body& _body, const Join& _join)
+        requires std::convertible_to<std::invoke_result_t<const Body&, const Range&, const T&>, T> &&
+                 std::convertible_to<std::invoke_result_t<const Join&, T, T>, T>
+    {
+        if (!_range.is_divisible()) {
+            return std::invoke(_body, std::as_const(_range), _identity);
+        }
+
+        Range right = _range.split();
+        auto fork = spawn(_executor, [&_executor, right, &_identity, &_body, &_join]() -> T {
+            return parallel_reduce(_executor, right, _identity, _body, _join);
+        });
+
+        // The forked task references _body, so it must be finished before this function returns, even if the other half throws.
+        T left_result = [&]() -> T {
+            try {
+                return parallel_reduce(_executor, std::move(_range), _identity, _body, _join);
+            }
+            catch (...) {
+                _executor.run_pending_tasks(fork);
+                throw;
+            }
+        }();
+
+        _executor.run_pending_tasks(fork);
+        return std::invoke(_join, std::move(left_result), fork.get());
+    }
+}
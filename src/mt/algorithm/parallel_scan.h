@@ -0,0 +1,99 @@
+#pragma once
+
+#include "parallel_for.h"
+
+#include <iterator>
+#include <vector>
+
+namespace mkr {
+    /**
+     * Parallel exclusive prefix scan. Output element i is the reduction of _init and input elements [0, i).
+     *
+     * The input is split into blocks. Each block is reduced by one task, the block sums are scanned by the calling thread,
+     * and each block is then scanned by one task starting from its block's offset. Each input element is read before its output
+     * element is written, so _first==_d_first is allowed.
+     *
+     * @tparam InputIt The typename of the input iterator.
+     * @tparam OutputIt The typename of the output iterator.
+     * @tparam T The typename of the scanned values.
+     * @tparam BinaryOp The typename of the scan operation. It must be associative.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _first The beginning of the input.
+     * @param _last The end of the input.
+     * @param _d_first The beginning of the output.
+     * @param _init The initial value.
+     * @param _op The scan operation.
+     * @return The reduction of _init and all input elements.
+     */
+    template<executor Executor, std::random_access_iterator InputIt, std::random_access_iterator OutputIt, typename T, typename BinaryOp = std::plus<>>
+    T parallel_exclusive_scan(Executor& _executor, InputIt _first, InputIt _last, OutputIt _d_first, T _init, BinaryOp _op = {})
+    {
+        const std::size_t num_elements = static_cast<std::size_t>(std::distance(_first, _last));
+        if (num_elements==0) { return _init; }
+
+        constexpr std::size_t min_block_size = 4096;
+        const std::size_t num_blocks = std::clamp<std::size_t>(num_elements/min_block_size, 1, 4*(_executor.num_threads()+1));
+        auto block_begin = [num_elements, num_blocks](std::size_t _block) { return _block*num_elements/num_blocks; };
+
+        // Pass 1: Reduce each block. Every block is non-empty, so its first element is the starting value.
+        std::vector<T> block_sums(num_blocks);
+        parallel_for(_executor, blocked_range<std::size_t>{0, num_blocks}, [&](const blocked_range<std::size_t>& _blocks) {
+            for (std::size_t b = _blocks.begin(); b<_blocks.end(); ++b) {
+                T sum = static_cast<T>(_first[block_begin(b)]);
+                for (std::size_t i = block_begin(b)+1; i<block_begin(b+1); ++i) {
+                    sum = _op(std::move(sum), _first[i]);
+                }
+                block_sums[b] = std::move(sum);
+            }
+        });
+
+        // Scan the block sums. There are only a few of them.
+        T total = std::move(_init);
+        for (std::size_t b = 0; b<num_blocks; ++b) {
+            T block_sum = std::move(block_sums[b]);
+            block_sums[b] = total;
+            total = _op(std::move(total), std::move(block_sum));
+        }
+
+        // Pass 2: Scan each block starting from its offset.
+        parallel_for(_executor, blocked_range<std::size_t>{0, num_blocks}, [&](const blocked_range<std::size_t>& _blocks) {
+            for (std::size_t b = _blocks.begin(); b<_blocks.end(); ++b) {
+                T sum = block_sums[b];
+                for (std::size_t i = block_begin(b); i<block_begin(b+1); ++i) {
+                    T value = _first[i];
+                    _d_first[i] = sum;
+                    sum = _op(std::move(sum), std::move(value));
+                }
+            }
+        });
+
+        return total;
+    }
+
+    /**
+     * Concatenate buffers into a single vector. The offset of each buffer is found with a prefix scan of the buffer sizes,
+     * after which every buffer is copied into its region of the output in parallel.
+     * This is used to merge the per-task output buffers of parallel algorithms without any locking.
+     * @tparam T The typename of the buffer elements.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _buffers The buffers to concatenate.
+     * @return The concatenation of the buffers, in order.
+     */
+    template<executor Executor, typename T>
+    std::vector<T> parallel_concatenate(Executor& _executor, const std::vector<std::vector<T>>& _buffers)
+    {
+        std::vector<std::size_t> offsets(_buffers.size());
+        for (std::size_t i = 0; i<_buffers.size(); ++i) { offsets[i] = _buffers[i].size(); }
+        const std::size_t total = parallel_exclusive_scan(_executor, offsets.begin(), offsets.end(), offsets.begin(), std::size_t{0});
+
+        std::vector<T> result(total);
+        parallel_for(_executor, blocked_range<std::size_t>{0, _buffers.size()}, [&](const blocked_range<std::size_t>& _range) {
+            for (std::size_t i = _range.begin(); i<_range.end(); ++i) {
+                std::copy(_buffers[i].begin(), _buffers[i].end(), result.begin()+static_cast<std::ptrdiff_t>(offsets[i]));
+            }
+        });
+        return result;
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../executor/spawn.h"
+#include "../thread_pool/thread_pool.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace mkr {
+    namespace detail {
+        /**
+         * Merge two sorted ranges into an output range. The larger input is split at its middle element, the other input is split
+         * at the matching position with a binary search, and the two halves are merged in parallel.
+         */
+        template<executor Executor, typename InputIt, typename OutputIt, typename Compare>
+        void parallel_merge(Executor& _executor, InputIt _first1, InputIt _last1, InputIt _first2, InputIt _last2,
+                            OutputIt _d_first, const Compare& _comp, std::size_t _grain_size)
+        {
+            const std::size_t size1 = static_cast<std::size_t>(_last1-_first1);
+            const std::size_t size2 = static_cast<std::size_t>(_last2-_first2);
+            if (size1+size2<=_grain_size) {
+                std::merge(std::make_move_iterator(_first1), std::make_move_iterator(_last1),
+                           std::make_move_iterator(_first2), std::make_move_iterator(_last2), _d_first, _comp);
+                return;
+            }
+
+            // Split so that the merge stays stable. Equal elements of the first range always go before those of the second range.
+            InputIt mid1, mid2;
+            if (size1>=size2) {
+                mid1 = _first1+static_cast<std::ptrdiff_t>(size1/2);
+                mid2 = std::lower_bound(_first2, _last2, *mid1, _comp);
+            }
+            else {
+                mid2 = _first2+static_cast<std::ptrdiff_t>(size2/2);
+                mid1 = std::upper_bound(_first1, _last1, *mid2, _comp);
+            }
+            OutputIt d_mid = _d_first+((mid1-_first1)+(mid2-_first2));
+
+            auto fork = spawn(_executor, [&_executor, _first1, mid1, _first2, mid2, _d_first, &_comp, _grain_size]() {
+                parallel_merge(_executor, _first1, mid1, _first2, mid2, _d_first, _comp, _grain_size);
+            });
+            parallel_merge(_executor, mid1, _last1, mid2, _last2, d_mid, _comp, _grain_size);
+            _executor.run_pending_tasks(fork);
+            fork.get();
+        }
+
+        /**
+         * Sort a range. If _to_buffer is true, the sorted elements are moved into the buffer, otherwise they are left in the range.
+         * The two halves are sorted into the opposite storage to their parent, so every merge moves data from one storage to the other.
+         */
+        template<executor Executor, typename RandomIt, typename BufferIt, typename Compare>
+        void parallel_merge_sort(Executor& _executor, RandomIt _first, RandomIt _last, BufferIt _buffer, bool _to_buffer,
+                                 const Compare& _comp, std::size_t _grain_size)
+        {
+            const std::size_t size = static_cast<std::size_t>(_last-_first);
+            if (size<=_grain_size) {
+                std::stable_sort(_first, _last, _comp);
+                if (_to_buffer) { std::move(_first, _last, _buffer); }
+                return;
+            }
+
+            const std::ptrdiff_t half = static_cast<std::ptrdiff_t>(size/2);
+            RandomIt mid = _first+half;
+            BufferIt buffer_mid = _buffer+half;
+            BufferIt buffer_last = _buffer+static_cast<std::ptrdiff_t>(size);
+
+            auto fork = spawn(_executor, [&_executor, _first, mid, _buffer, _to_buffer, &_comp, _grain_size]() {
+                parallel_merge_sort(_executor, _first, mid, _buffer, !_to_buffer, _comp, _grain_size);
+            });
+            parallel_merge_sort(_executor, mid, _last, buffer_mid, !_to_buffer, _comp, _grain_size);
+            _executor.run_pending_tasks(fork);
+            fork.get();
+
+            if (_to_buffer) {
+                parallel_merge(_executor, _first, mid, mid, _last, _buffer, _comp, _grain_size);
+            }
+            else {
+                parallel_merge(_executor, _buffer, buffer_mid, buffer_mid, buffer_last, _first, _comp, _grain_size);
+            }
+        }
+    }
+
+    /**
+     * Stable parallel merge sort. Both the recursive sorts and the merges are split into tasks, so the final merges are parallel as well.
+     * A buffer the size of the range is allocated.
+     * @tparam RandomIt The typename of the iterators.
+     * @tparam Compare The typename of the comparator.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _first The beginning of the range.
+     * @param _last The end of the range.
+     * @param _comp The comparator.
+     * @param _grain_size Ranges of this size or smaller are sorted or merged serially.
+     */
+    template<executor Executor, std::random_access_iterator RandomIt, typename Compare = std::less<>>
+    void parallel_sort(Executor& _executor, RandomIt _first, RandomIt _last, Compare _comp = {}, std::size_t _grain_size = 16384)
+    {
+        typedef typename std::iterator_traits<RandomIt>::value_type value_type;
+        _grain_size = std::max<std::size_t>(_grain_size, 2);
+        if (static_cast<std::size_t>(_last-_first)<=_grain_size) {
+            std::stable_sort(_first, _last, _comp);
+            return;
+        }
+
+        std::vector<value_type> buffer(static_cast<std::size_t>(_last-_first));
+        detail::parallel_merge_sort(_executor, _first, _last, buffer.begin(), false, _comp, _grain_size);
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "container.h"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+
+namespace mkr {
+    /**
+     * Fixed-size bitmap whose bits can be set and tested concurrently without locks.
+     *
+     * Invariants:
+     * - The number of bits do not change.
+     * - Bits past size() are always 0.
+     *
+     * Additional Notes:
+     * - atomic_bitmap is non-copyable AND non-movable. (As it has non-copyable and non-movable members.)
+     * - Setting and testing bits are atomic. clear() and count() are not atomic with respect to concurrent set().
+     */
+    class atomic_bitmap : public container {
+    private:
+        typedef std::uint64_t word_type;
+        static constexpr std::size_t bits_per_word = 64;
+
+        /// Number of bits.
+        const std::size_t num_bits_;
+        /// Number of words.
+        const std::size_t num_words_;
+        /// Words holding the bits.
+        std::unique_ptr<std::atomic<word_type>[]> words_;
+
+    public:
+        /**
+         * Constructs the bitmap with all bits cleared.
+         * @param _num_bits The number of bits.
+         */
+        explicit atomic_bitmap(std::size_t _num_bits)
+                :num_bits_{_num_bits}, num_words_{(_num_bits+bits_per_word-1)/bits_per_word},
+                 words_{std::make_unique<std::atomic<word_type>[]>(num_words_)}
+        {
+            clear();
+        }
+
+        /**
+         * Destructs the bitmap.
+         */
+        virtual ~atomic_bitmap() { }
+
+        atomic_bitmap(const atomic_bitmap&) = delete;
+        atomic_bitmap(atomic_bitmap&&) = delete;
+        atomic_bitmap& operator=(const atomic_bitmap&) = delete;
+        atomic_bitmap& operator=(atomic_bitmap&&) = delete;
+
+        /**
+         * Set a bit.
+         * @param _index The index of the bit.
+         * @return Returns true if this call set the bit. Returns false if the bit was already set.
+         */
+        bool set(std::size_t _index)
+        {
+            const word_type mask = word_type{1} << (_index%bits_per_word);
+            std::atomic<word_type>& word = words_[_index/bits_per_word];
+            // Testing before the read-modify-write avoids taking the cache line exclusive when the bit is already set.
+            if (word.load(std::memory_order_relaxed) & mask) { return false; }
+            return (word.fetch_or(mask, std::memory_order_relaxed) & mask)==0;
+        }
+
+        /**
+         * Test a bit.
+         * @param _index The index of the bit.
+         * @return Returns true if the bit is set, false otherwise.
+         */
+        bool test(std::size_t _index) const
+        {
+            return (words_[_index/bits_per_word].load(std::memory_order_relaxed) >> (_index%bits_per_word)) & 1;
+        }
+
+        /**
+         * Clear all bits.
+         */
+        void clear()
+        {
+            for (std::size_t i = 0; i<num_words_; ++i) { words_[i].store(0, std::memory_order_relaxed); }
+        }
+
+        /**
+         * Count the number of set bits.
+         * @return The number of set bits.
+         */
+        std::size_t count() const
+        {
+            std::size_t result = 0;
+            for (std::size_t i = 0; i<num_words_; ++i) { result += std::popcount(words_[i].load(std::memory_order_relaxed)); }
+            return result;
+        }
+
+        /**
+         * Swap the contents of two bitmaps of the same size. This is not atomic.
+         * @param _other The other bitmap.
+         */
+        void swap(atomic_bitmap& _other)
+        {
+            words_.swap(_other.words_);
+        }
+
+        /**
+         * Returns the number of bits.
+         * @return Returns the number of bits.
+         */
+        std::size_t size() const { return num_bits_; }
+    };
+}
@@ -0,0 +1,263 @@
+#pragma once
+
+#include "container.h"
+#include "../util/concepts.h"
+#include "../util/hardware.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <thread>
+#include <utility>
+
+namespace mkr {
+    namespace detail {
+        /// The number of entries in each thread's cache of enumerable_thread_specific lookups.
+        constexpr std::size_t ets_cache_size = 16;
+
+        /**
+         * An entry of a thread's cache of enumerable_thread_specific lookups.
+         */
+        struct ets_cache_entry {
+            /// The id of the enumerable_thread_specific. Ids are never reused, so a stale entry never matches.
+            std::uint64_t id_ = 0;
+            /// This thread's element of the enumerable_thread_specific.
+            void* element_ = nullptr;
+        };
+
+        /// Each thread's direct-mapped cache of enumerable_thread_specific lookups, indexed by id.
+        inline thread_local ets_cache_entry ets_cache[ets_cache_size];
+        /// The next enumerable_thread_specific id. 0 is never used, so empty cache entries never match.
+        inline std::atomic_uint64_t ets_next_id{1};
+    }
+
+    /**
+     * A container with a separate element for every thread that accesses it, for contention-free accumulation of per-thread
+     * partial results. The elements are enumerated or combined after the parallel work is done.
+     *
+     * Invariants:
+     * - Every thread has at most one element. It is constructed lazily, by the thread itself, on the first call to local().
+     * - Elements are never moved, and each is padded to a whole number of cache lines so that no two elements share a cache line.
+     * - Traversing head_->next_ will eventually lead to nullptr.
+     *
+     * Additional Notes:
+     * - local() is O(1) when it hits the calling thread's cache, which holds the last element looked up in each of a few enumerable_thread_specific.
+     *   On a miss, the elements are scanned, which is O(number of threads).
+     * - A thread that reuses the std::thread::id of a finished thread also reuses its element.
+     * - Enumeration, combine(), and clear() must not run concurrently with local().
+     * - enumerable_thread_specific is non-copyable AND non-movable.
+     *
+     * @tparam T The typename of the elements.
+     */
+    template<typename T>
+    class enumerable_thread_specific : public container {
+    private:
+        /**
+         * An element, aligned to a cache line, and the next element in the list.
+         */
+        struct alignas(cache_line_size) element {
+            /// Value.
+            T value_;
+            /// The thread this element belongs to.
+            const std::thread::id owner_;
+            /// Next element.
+            element* next_;
+
+            element(const std::function<T()>& _supplier, std::thread::id _owner)
+                    :value_(_supplier()), owner_{_owner}, next_{nullptr} { }
+        };
+
+        /// The id of this container in the per-thread caches. It is changed by clear(), so that cached elements are forgotten.
+        std::uint64_t id_;
+        /// Constructs the element of a thread.
+        std::function<T()> supplier_;
+        /// The most recently created element.
+        std::atomic<element*> head_;
+        /// Number of elements in the container.
+        std::atomic_size_t num_elements_;
+
+        /**
+         * Find the element of the calling thread, or create it.
+         * @param _exists Set to true if the element already existed, false if it was created.
+         * @return The element of the calling thread.
+         */
+        element* find_or_create(bool& _exists)
+        {
+            const std::thread::id this_id = std::this_thread::get_id();
+            // Only the calling thread can add an element for itself, so if it is not in the list now, it will not be added by anyone else.
+            for (element* e = head_.load(std::memory_order_acquire); e; e = e->next_) {
+                if (e->owner_==this_id) {
+                    _exists = true;
+                    return e;
+                }
+            }
+
+            // Construct the value before publishing it, so other threads never see a partially constructed element.
+            element* new_element = new element{supplier_, this_id};
+            new_element->next_ = head_.load(std::memory_order_relaxed);
+            while (!head_.compare_exchange_weak(new_element->next_, new_element, std::memory_order_release, std::memory_order_relaxed)) { }
+            ++num_elements_;
+            _exists = false;
+            return new_element;
+        }
+
+        template<bool Const>
+        class basic_iterator {
+        private:
+            element* element_;
+
+        public:
+            typedef std::forward_iterator_tag iterator_category;
+            typedef std::ptrdiff_t difference_type;
+            typedef T value_type;
+            typedef std::conditional_t<Const, const T*, T*> pointer;
+            typedef std::conditional_t<Const, const T&, T&> reference;
+
+            basic_iterator()
+                    :element_{nullptr} { }
+            explicit basic_iterator(element* _element)
+                    :element_{_element} { }
+
+            reference operator*() const { return element_->value_; }
+            pointer operator->() const { return &element_->value_; }
+            basic_iterator& operator++()
+            {
+                element_ = element_->next_;
+                return *this;
+            }
+            basic_iterator operator++(int)
+            {
+                basic_iterator previous = *this;
+                element_ = element_->next_;
+                return previous;
+            }
+            bool operator==(const basic_iterator& _other) const { return element_==_other.element_; }
+        };
+
+    public:
+        typedef basic_iterator<false> iterator;
+        typedef basic_iterator<true> const_iterator;
+
+        /**
+         * Constructs the container. Each thread's element is value-initialized.
+         */
+        enumerable_thread_specific()
+            requires std::default_initializable<T>
+                :enumerable_thread_specific([]() { return T{}; }) { }
+
+        /**
+         * Constructs the container.
+         * @tparam Supplier The typename of the supplier.
+         * @param _supplier The supplier which constructs each thread's element. It is invoked by the thread that the element belongs to.
+         */
+        template<class Supplier>
+        explicit enumerable_thread_specific(Supplier&& _supplier)
+            requires mkr::is_supplier<Supplier, T>
+                :id_{detail::ets_next_id++}, supplier_{std::forward<Supplier>(_supplier)}, head_{nullptr}, num_elements_{0} { }
+
+        /**
+         * Destructs the container.
+         */
+        virtual ~enumerable_thread_specific() { clear(); }
+
+        enumerable_thread_specific(const enumerable_thread_specific&) = delete;
+        enumerable_thread_specific(enumerable_thread_specific&&) = delete;
+        enumerable_thread_specific& operator=(const enumerable_thread_specific&) = delete;
+        enumerable_thread_specific& operator=(enumerable_thread_specific&&) = delete;
+
+        /**
+         * Returns the element of the calling thread, constructing it if this is the thread's first call.
+         * @param _exists Set to true if the element already existed, false if it was constructed by this call.
+         * @return The element of the calling thread.
+         */
+        T& local(bool& _exists)
+        {
+            detail::ets_cache_entry& entry = detail::ets_cache[id_%detail::ets_cache_size];
+            if (entry.id_==id_) {
+                _exists = true;
+                return static_cast<element*>(entry.element_)->value_;
+            }
+
+            element* e = find_or_create(_exists);
+            entry.id_ = id_;
+            entry.element_ = e;
+            return e->value_;
+        }
+
+        /**
+         * Returns the element of the calling thread, constructing it if this is the thread's first call.
+         * @return The element of the calling thread.
+         */
+        T& local()
+        {
+            bool exists;
+            return local(exists);
+        }
+
+        iterator begin() { return iterator{head_.load(std::memory_order_acquire)}; }
+        iterator end() { return iterator{}; }
+        const_iterator begin() const { return const_iterator{head_.load(std::memory_order_acquire)}; }
+        const_iterator end() const { return const_iterator{}; }
+
+        /**
+         * Combine the elements of every thread. The order in which the elements are combined is unspecified.
+         * @tparam BinaryOp The typename of the combining function.
+         * @param _op The combining function. It must be associative and commutative.
+         * @return The combination of every element. If there are no elements, the result of the supplier is returned.
+         */
+        template<typename BinaryOp>
+        T combine(BinaryOp&& _op) const
+            requires std::copyable<T> && std::convertible_to<std::invoke_result_t<BinaryOp, const T&, const T&>, T>
+        {
+            const_iterator it = begin();
+            if (it==end()) { return supplier_(); }
+
+            T result = *it;
+            for (++it; it!=end(); ++it) {
+                result = std::invoke(_op, std::as_const(result), *it);
+            }
+            return result;
+        }
+
+        /**
+         * Perform the consumer operation on every element.
+         * @tparam Consumer The typename of the consumer function.
+         * @param _consumer Consumer to operate on the elements.
+         */
+        template<class Consumer>
+        void combine_each(Consumer&& _consumer)
+            requires mkr::is_consumer<Consumer, T&>
+        {
+            for (T& value : *this) { std::invoke(_consumer, value); }
+        }
+
+        /**
+         * Destroy every element. Each thread's element is constructed again on its next call to local().
+         */
+        void clear()
+        {
+            element* e = head_.exchange(nullptr);
+            while (e) {
+                element* next = e->next_;
+                delete e;
+                e = next;
+            }
+            num_elements_ = 0;
+            // Forget the elements cached by every thread.
+            id_ = detail::ets_next_id++;
+        }
+
+        /**
+         * Checks if the container is empty.
+         * @return Returns true if the container is empty, false otherwise.
+         */
+        bool empty() const { return num_elements_.load()==0; }
+
+        /**
+         * Returns the number of elements in the container, which is the number of threads that have called local().
+         * @return Returns the number of elements in the container.
+         */
+        std::size_t size() const { return num_elements_.load(); }
+    };
+}
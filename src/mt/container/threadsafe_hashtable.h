@@ -1,6 +1,7 @@
 #pragma once
 
 #include "threadsafe_list.h"
+#include "../sync/contention_counting_mutex.h"
 
 namespace mkr {
     /**
@@ -27,7 +28,7 @@ namespace mkr {
     template<typename K, typename V, std::size_t N = 61>
     class threadsafe_hashtable : public container {
     private:
-        typedef std::shared_timed_mutex mutex_type;
+        typedef contention_counting_mutex<std::shared_timed_mutex> mutex_type;
         typedef std::unique_lock<mutex_type> writer_lock;
         typedef std::shared_lock<mutex_type> reader_lock;
 
@@ -487,5 +488,16 @@ namespace mkr {
          * @return Returns the number of elements in the container.
          */
         std::size_t size() const { return num_elements_.load(); }
+
+        /**
+         * Returns the number of times a thread had to wait for a bucket lock held by another thread.
+         * @return Returns the number of contended bucket locks.
+         */
+        std::size_t num_contentions() const
+        {
+            std::size_t num_contentions = 0;
+            for (const bucket& b : buckets_) { num_contentions += b.mutex_.num_contentions(); }
+            return num_contentions;
+        }
     };
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "container.h"
+#include "../sync/contention_counting_mutex.h"
 #include "../util/concepts.h"
+#include "../util/tracepoints.h"
 
 #include <memory>
 #include <mutex>
@@ -33,7 +35,7 @@ namespace mkr {
     template<typename T>
     class threadsafe_queue : public container {
     private:
-        typedef std::timed_mutex mutex_type;
+        typedef contention_counting_mutex<std::timed_mutex> mutex_type;
 
         /**
          * A node containing a value, and the next node in the stack.
@@ -102,6 +104,7 @@ namespace mkr {
             tail_ = tail_->next_.get();
             // Increase the element counter.
             num_elements_++;
+            MKR_TRACE(queue_push, this, num_elements_.load(std::memory_order_relaxed));
         }
 
         /**
@@ -116,6 +119,7 @@ namespace mkr {
             head_ = std::move(old_head->next_);
             // Decrease the element counter.
             num_elements_--;
+            MKR_TRACE(queue_pop, this, num_elements_.load(std::memory_order_relaxed));
             // Return the extracted value.
             return old_head->value_;
         }
@@ -258,5 +262,11 @@ namespace mkr {
          * @return Returns the number of elements in the container.
          */
         size_t size() const { return num_elements_.load(); }
+
+        /**
+         * Returns the number of times a thread had to wait for another thread to push or pop.
+         * @return Returns the number of contended locks.
+         */
+        size_t num_contentions() const { return head_mutex_.num_contentions()+tail_mutex_.num_contentions(); }
     };
 }
\ No newline at end of file
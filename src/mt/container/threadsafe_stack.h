@@ -1,7 +1,9 @@
 #pragma once
 
 #include "container.h"
+#include "../sync/contention_counting_mutex.h"
 #include "../util/concepts.h"
+#include "../util/tracepoints.h"
 
 #include <memory>
 #include <mutex>
@@ -28,7 +30,7 @@ namespace mkr {
     template<typename T>
     class threadsafe_stack : public container {
     private:
-        typedef std::timed_mutex mutex_type;
+        typedef contention_counting_mutex<std::timed_mutex> mutex_type;
 
         /**
          * A node containing a value, and the next node in the stack.
@@ -55,9 +57,10 @@ namespace mkr {
         /**
          * Internal function to push a new value onto the top of the stack.
          * @param _value The value to push onto the top of the stack.
+         * @return The number of elements in the stack after the push, which is the position of the value counted from the bottom.
          * @warning If multiple threads pushes at the same time, the value will be inserted but may no longer be at the top of the stack.
          */
-        void do_push(std::shared_ptr<T> _value)
+        size_t do_push(std::shared_ptr<T> _value)
         {
             // Construct a new node.
             std::unique_ptr<node> new_node = std::make_unique<node>();
@@ -70,7 +73,9 @@ namespace mkr {
             // Set the new node as the top node.
             top_ = std::move(new_node);
             // Increase the element counter.
-            ++num_elements_;
+            const size_t num_elements = ++num_elements_;
+            MKR_TRACE(queue_push, this, num_elements);
+            return num_elements;
         }
 
         /**
@@ -84,7 +89,8 @@ namespace mkr {
             // Point the top node to it's next node.
             top_ = std::move(top_->next_);
             // Decrease the element counter.
-            --num_elements_;
+            const size_t num_elements = --num_elements_;
+            MKR_TRACE(queue_pop, this, num_elements);
             // Return the extracted value.
             return head_data;
         }
@@ -149,27 +155,31 @@ namespace mkr {
         /**
          * Push a new value to the top of the stack.
          * @param _value The value to push to the top of the stack.
+         * @return The number of elements in the stack after the push, which is the position of the value counted from the bottom.
          * @warning If multiple threads pushes at the same time, the value will be inserted but may no longer be at the top of the stack.
          */
-        void push(const T& _value)
+        size_t push(const T& _value)
         {
             // When possible, expensive operations like constructing an object should be done before acquiring the mutex.
-            do_push(std::make_shared<T>(_value));
+            size_t position = do_push(std::make_shared<T>(_value));
             // Notify any threads waiting for value_. This is done AFTER unlocking the mutex so that any waiting threads can operate immediately.
             cond_.notify_one();
+            return position;
         }
 
         /**
          * Push a new value to the top of the stack.
          * @param _value The value to push to the top of the stack.
+         * @return The number of elements in the stack after the push, which is the position of the value counted from the bottom.
          * @warning If multiple threads pushes at the same time, the value will be inserted but may no longer be at the top of the stack.
          */
-        void push(T&& _value)
+        size_t push(T&& _value)
         {
             // When possible, expensive operations like constructing an object should be done before acquiring the mutex.
-            do_push(std::make_shared<T>(std::forward<T>(_value)));
+            size_t position = do_push(std::make_shared<T>(std::forward<T>(_value)));
             // Notify any threads waiting for value_. This is done AFTER unlocking the mutex so that any waiting threads can operate immediately.
             cond_.notify_one();
+            return position;
         }
 
         /**
@@ -196,6 +206,20 @@ namespace mkr {
             return do_pop();
         }
 
+        /**
+         * Try to remove the top value from the stack, only if the stack has more than a given number of elements.
+         * As values are only removed from the top, this never removes a value at or below the given position.
+         * @param _size The number of elements which must remain in the stack.
+         * @return Pop and return the value from the top of the stack. If the stack has _size elements or fewer, return a nullptr.
+         */
+        std::shared_ptr<T> try_pop_if_size_above(size_t _size)
+        {
+            // Lock the top mutex.
+            std::lock_guard<mutex_type> lock(top_mutex_);
+            if (top_==nullptr || num_elements_.load()<=_size) { return nullptr; }
+            return do_pop();
+        }
+
         /**
          * Clears the stack.
          */
@@ -218,5 +242,11 @@ namespace mkr {
          * @return Returns the number of elements in the container.
          */
         size_t size() const { return num_elements_.load(); }
+
+        /**
+         * Returns the number of times a thread had to wait for another thread to push or pop.
+         * @return Returns the number of contended locks.
+         */
+        size_t num_contentions() const { return top_mutex_.num_contentions(); }
     };
 }
\ No newline at end of file
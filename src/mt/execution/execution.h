@@ -0,0 +1,513 @@
+#pragma once
+
+#include "../algorithm/parallel_for.h"
+#include "../thread_pool/thread_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+
+/**
+ * A subset of P2300 (std::execution) senders and receivers, until the standard library provides them.
+ *
+ * - A sender describes work which completes with at most one value (value_type, which may be void), an error, or a stop.
+ * - connect(sender, receiver) returns an operation state, which holds everything the work needs, including the receiver.
+ *   It is neither copyable nor movable, so it lives wherever the caller put it, usually the caller's stack frame.
+ * - start(operation state) starts the work. When the work completes, one of set_value(), set_error() or set_stopped() is invoked on the receiver.
+ *
+ * Composing senders composes their operation states into a single object, so a pipeline such as
+ * @code
+ * auto [sum] = *sync_wait(schedule(pool.get_scheduler()) | then([]() { return 1; }) | then([](int _x) { return _x+1; }));
+ * @endcode
+ * runs on the thread pool without any heap allocations.
+ */
+namespace mkr {
+    /**
+     * A receiver can be completed with an error or a stop.
+     */
+    template<class R>
+    concept receiver = std::move_constructible<std::remove_cvref_t<R>> &&
+                       requires(std::remove_cvref_t<R>& _receiver, std::exception_ptr _error) {
+                           _receiver.set_error(_error);
+                           _receiver.set_stopped();
+                       };
+
+    /**
+     * A receiver which can be completed with a value of type T, or with no value if T is void.
+     */
+    template<class R, class T>
+    concept receiver_of = receiver<R> &&
+                          ((std::is_void_v<T> && requires(std::remove_cvref_t<R>& _receiver) { _receiver.set_value(); }) ||
+                           (!std::is_void_v<T> && requires(std::remove_cvref_t<R>& _receiver, std::add_rvalue_reference_t<T> _value) {
+                               _receiver.set_value(std::forward<T>(_value));
+                           }));
+
+    /**
+     * An operation state can be started.
+     */
+    template<class O>
+    concept operation_state = requires(O& _operation) {
+        { _operation.start() } noexcept;
+    };
+
+    /**
+     * A sender describes work which completes with a value of type value_type, or with no value if value_type is void.
+     */
+    template<class S>
+    concept sender = std::move_constructible<std::remove_cvref_t<S>> && requires {
+        typename std::remove_cvref_t<S>::value_type;
+    };
+
+    /**
+     * A sender which can be connected to a receiver of type R.
+     */
+    template<class S, class R>
+    concept sender_to = sender<S> && receiver_of<R, typename std::remove_cvref_t<S>::value_type> &&
+                        requires(S&& _sender, R&& _receiver) {
+                            { std::forward<S>(_sender).connect(std::forward<R>(_receiver)) } -> operation_state;
+                        };
+
+    /**
+     * A scheduler produces senders which complete on its execution context.
+     */
+    template<class S>
+    concept scheduler = std::copy_constructible<std::remove_cvref_t<S>> && std::equality_comparable<std::remove_cvref_t<S>> &&
+                        requires(const std::remove_cvref_t<S>& _scheduler) {
+                            { _scheduler.schedule() } -> sender;
+                        };
+
+    /**
+     * @return A sender which completes on the scheduler's execution context.
+     */
+    template<scheduler Scheduler>
+    auto schedule(const Scheduler& _scheduler) { return _scheduler.schedule(); }
+
+    /**
+     * Connect a sender to a receiver.
+     * @return The operation state. It is not copyable or movable, and must be started to run.
+     */
+    template<sender Sender, receiver Receiver>
+    auto connect(Sender&& _sender, Receiver&& _receiver)
+        requires sender_to<Sender, Receiver>
+    {
+        return std::forward<Sender>(_sender).connect(std::forward<Receiver>(_receiver));
+    }
+
+    /**
+     * Start an operation state.
+     */
+    template<operation_state Operation>
+    void start(Operation& _operation) noexcept { _operation.start(); }
+
+    namespace detail {
+        /**
+         * A sender which completes on a thread of a mkr::thread_pool, so that algorithms can be customised to run on the thread pool.
+         */
+        template<class S>
+        concept thread_pool_sender = requires(const std::remove_cvref_t<S>& _sender) {
+            { _sender.get_completion_scheduler() } -> std::same_as<thread_pool::scheduler>;
+        };
+
+        /**
+         * The result of a sender adaptor called without its sender, such as then(f). Piping a sender into it applies the adaptor.
+         */
+        template<typename Adaptor>
+        struct sender_adaptor_closure {
+            Adaptor adaptor_;
+        };
+
+        template<sender Sender, typename Adaptor>
+        auto operator|(Sender&& _sender, sender_adaptor_closure<Adaptor> _closure)
+        {
+            return std::move(_closure.adaptor_)(std::forward<Sender>(_sender));
+        }
+
+        /**
+         * The operation state of a sender which sends values known when it is connected.
+         */
+        template<typename Receiver, typename... Ts>
+        class just_operation_state {
+        private:
+            std::tuple<Ts...> values_;
+            Receiver receiver_;
+
+        public:
+            just_operation_state(std::tuple<Ts...>&& _values, Receiver&& _receiver)
+                    :values_{std::move(_values)}, receiver_{std::move(_receiver)} { }
+
+            just_operation_state(const just_operation_state&) = delete;
+            just_operation_state(just_operation_state&&) = delete;
+            just_operation_state& operator=(const just_operation_state&) = delete;
+            just_operation_state& operator=(just_operation_state&&) = delete;
+
+            void start() noexcept
+            {
+                try {
+                    std::apply([this](Ts&... _values) { receiver_.set_value(std::move(_values)...); }, values_);
+                }
+                catch (...) {
+                    receiver_.set_error(std::current_exception());
+                }
+            }
+        };
+
+        /**
+         * A sender which sends values known when it is created, on the thread which starts it.
+         */
+        template<typename... Ts>
+        class just_sender {
+        private:
+            std::tuple<Ts...> values_;
+
+        public:
+            typedef std::conditional_t<sizeof...(Ts)==0, void, std::tuple_element_t<0, std::tuple<Ts..., void>>> value_type;
+
+            explicit just_sender(Ts... _values)
+                    :values_{std::move(_values)...} { }
+
+            template<typename Receiver>
+            just_operation_state<std::decay_t<Receiver>, Ts...> connect(Receiver&& _receiver) &&
+            {
+                return {std::move(values_), std::decay_t<Receiver>{std::forward<Receiver>(_receiver)}};
+            }
+
+            template<typename Receiver>
+            just_operation_state<std::decay_t<Receiver>, Ts...> connect(Receiver&& _receiver) const&
+            {
+                return {std::tuple<Ts...>{values_}, std::decay_t<Receiver>{std::forward<Receiver>(_receiver)}};
+            }
+        };
+
+        template<typename T, typename Func>
+        struct then_result {
+            typedef std::invoke_result_t<Func, T> type;
+        };
+
+        template<typename Func>
+        struct then_result<void, Func> {
+            typedef std::invoke_result_t<Func> type;
+        };
+
+        /**
+         * The receiver which then() connects to its predecessor. It invokes the function on the predecessor's value,
+         * and completes the next receiver with the result.
+         */
+        template<typename Receiver, typename Func>
+        class then_receiver {
+        private:
+            Receiver receiver_;
+            Func func_;
+
+        public:
+            then_receiver(Receiver&& _receiver, Func&& _func)
+                    :receiver_{std::move(_receiver)}, func_{std::move(_func)} { }
+
+            template<typename... Ts>
+            void set_value(Ts&& ... _values)
+            {
+                typedef std::invoke_result_t<Func&, Ts...> result_t;
+                if constexpr (std::is_void_v<result_t>) {
+                    try {
+                        std::invoke(func_, std::forward<Ts>(_values)...);
+                    }
+                    catch (...) {
+                        receiver_.set_error(std::current_exception());
+                        return;
+                    }
+                    receiver_.set_value();
+                }
+                else {
+                    // Exceptions thrown by the next receiver are not errors of this function, so the result is computed separately.
+                    std::optional<result_t> result;
+                    try {
+                        result.emplace(std::invoke(func_, std::forward<Ts>(_values)...));
+                    }
+                    catch (...) {
+                        receiver_.set_error(std::current_exception());
+                        return;
+                    }
+                    receiver_.set_value(std::move(*result));
+                }
+            }
+
+            void set_error(std::exception_ptr _error) { receiver_.set_error(_error); }
+            void set_stopped() { receiver_.set_stopped(); }
+        };
+
+        /**
+         * A sender which invokes a function on the value of its predecessor, and sends the result.
+         */
+        template<sender Sender, typename Func>
+        class then_sender {
+        private:
+            Sender sender_;
+            Func func_;
+
+        public:
+            typedef typename then_result<typename Sender::value_type, Func&>::type value_type;
+
+            then_sender(Sender&& _sender, Func&& _func)
+                    :sender_{std::move(_sender)}, func_{std::move(_func)} { }
+
+            template<typename Receiver>
+            auto connect(Receiver&& _receiver) &&
+            {
+                return std::move(sender_).connect(then_receiver<std::decay_t<Receiver>, Func>{
+                        std::decay_t<Receiver>{std::forward<Receiver>(_receiver)}, std::move(func_)});
+            }
+
+            template<typename Receiver>
+            auto connect(Receiver&& _receiver) const&
+            {
+                return sender_.connect(then_receiver<std::decay_t<Receiver>, Func>{
+                        std::decay_t<Receiver>{std::forward<Receiver>(_receiver)}, Func{func_}});
+            }
+
+            auto get_completion_scheduler() const
+                requires requires(const Sender& _sender) { _sender.get_completion_scheduler(); }
+            {
+                return sender_.get_completion_scheduler();
+            }
+        };
+
+        /**
+         * The receiver which bulk() connects to its predecessor. It invokes the function for every index of the shape,
+         * then completes the next receiver with the predecessor's value.
+         */
+        template<typename Receiver, std::integral Shape, typename Func>
+        class bulk_receiver {
+        private:
+            Receiver receiver_;
+            Shape shape_;
+            Func func_;
+            /// If not nullptr, the indices are split with mkr::parallel_for on this thread pool. Otherwise, they are run in order.
+            thread_pool* thread_pool_;
+
+        public:
+            bulk_receiver(Receiver&& _receiver, Shape _shape, Func&& _func, thread_pool* _thread_pool)
+                    :receiver_{std::move(_receiver)}, shape_{_shape}, func_{std::move(_func)}, thread_pool_{_thread_pool} { }
+
+            template<typename... Ts>
+            void set_value(Ts&& ... _values)
+            {
+                try {
+                    if (thread_pool_) {
+                        // Aim for a few pieces per thread, so that stealing can balance uneven work.
+                        const std::size_t num_pieces = 4*(thread_pool_->num_threads()+1);
+                        const std::size_t grain_size = std::max<std::size_t>(static_cast<std::size_t>(shape_)/num_pieces, 1);
+                        parallel_for(*thread_pool_, blocked_range<Shape>{0, shape_, grain_size}, [&](const blocked_range<Shape>& _range) {
+                            for (Shape i = _range.begin(); i<_range.end(); ++i) { std::invoke(func_, i, _values...); }
+                        });
+                    }
+                    else {
+                        for (Shape i = 0; i<shape_; ++i) { std::invoke(func_, i, _values...); }
+                    }
+                }
+                catch (...) {
+                    receiver_.set_error(std::current_exception());
+                    return;
+                }
+                receiver_.set_value(std::forward<Ts>(_values)...);
+            }
+
+            void set_error(std::exception_ptr _error) { receiver_.set_error(_error); }
+            void set_stopped() { receiver_.set_stopped(); }
+        };
+
+        /**
+         * A sender which invokes a function for every index of a shape, then sends the value of its predecessor.
+         */
+        template<sender Sender, std::integral Shape, typename Func>
+        class bulk_sender {
+        private:
+            Sender sender_;
+            Shape shape_;
+            Func func_;
+
+            thread_pool* get_thread_pool() const
+            {
+                if constexpr (thread_pool_sender<Sender>) { return &sender_.get_completion_scheduler().get_thread_pool(); }
+                else { return nullptr; }
+            }
+
+        public:
+            typedef typename Sender::value_type value_type;
+
+            bulk_sender(Sender&& _sender, Shape _shape, Func&& _func)
+                    :sender_{std::move(_sender)}, shape_{_shape}, func_{std::move(_func)} { }
+
+            template<typename Receiver>
+            auto connect(Receiver&& _receiver) &&
+            {
+                thread_pool* tp = get_thread_pool();
+                return std::move(sender_).connect(bulk_receiver<std::decay_t<Receiver>, Shape, Func>{
+                        std::decay_t<Receiver>{std::forward<Receiver>(_receiver)}, shape_, std::move(func_), tp});
+            }
+
+            template<typename Receiver>
+            auto connect(Receiver&& _receiver) const&
+            {
+                return sender_.connect(bulk_receiver<std::decay_t<Receiver>, Shape, Func>{
+                        std::decay_t<Receiver>{std::forward<Receiver>(_receiver)}, shape_, Func{func_}, get_thread_pool()});
+            }
+
+            auto get_completion_scheduler() const
+                requires requires(const Sender& _sender) { _sender.get_completion_scheduler(); }
+            {
+                return sender_.get_completion_scheduler();
+            }
+        };
+
+        template<typename T>
+        struct sync_wait_result {
+            typedef std::tuple<T> type;
+        };
+
+        template<>
+        struct sync_wait_result<void> {
+            typedef std::tuple<> type;
+        };
+
+        /**
+         * The state shared by sync_wait() and its receiver. It lives on sync_wait()'s stack frame.
+         */
+        template<typename T>
+        struct sync_wait_state {
+            std::optional<typename sync_wait_result<T>::type> value_;
+            std::exception_ptr error_;
+            std::atomic_bool done_{false};
+            std::mutex mutex_;
+            std::condition_variable condition_;
+        };
+
+        template<typename T>
+        class sync_wait_receiver {
+        private:
+            sync_wait_state<T>* state_;
+
+            void done()
+            {
+                // Notify while holding the lock, so that sync_wait() cannot return and destroy the state before the notification.
+                std::lock_guard lock{state_->mutex_};
+                state_->done_.store(true);
+                state_->condition_.notify_one();
+            }
+
+        public:
+            explicit sync_wait_receiver(sync_wait_state<T>* _state)
+                    :state_{_state} { }
+
+            template<typename... Ts>
+            void set_value(Ts&& ... _values)
+            {
+                state_->value_.emplace(std::forward<Ts>(_values)...);
+                done();
+            }
+
+            void set_error(std::exception_ptr _error)
+            {
+                state_->error_ = _error;
+                done();
+            }
+
+            void set_stopped() { done(); }
+        };
+    }
+
+    /**
+     * Create a sender which sends values on the thread which starts it.
+     * @param _values The values to send. At most one value is supported.
+     * @return The sender.
+     */
+    template<typename... Ts>
+        requires (sizeof...(Ts)<=1)
+    detail::just_sender<std::decay_t<Ts>...> just(Ts&& ... _values)
+    {
+        return detail::just_sender<std::decay_t<Ts>...>{std::forward<Ts>(_values)...};
+    }
+
+    /**
+     * Create a sender which invokes a function on the value of a sender, and sends the result.
+     * @param _sender The predecessor.
+     * @param _func The function. Exceptions it throws complete the receiver with an error.
+     * @return The sender.
+     */
+    template<sender Sender, typename Func>
+    detail::then_sender<std::decay_t<Sender>, std::decay_t<Func>> then(Sender&& _sender, Func&& _func)
+    {
+        return {std::decay_t<Sender>{std::forward<Sender>(_sender)}, std::decay_t<Func>{std::forward<Func>(_func)}};
+    }
+
+    /**
+     * @return An adaptor which applies then() to the sender piped into it.
+     */
+    template<typename Func>
+    auto then(Func&& _func)
+    {
+        return detail::sender_adaptor_closure{[func = std::forward<Func>(_func)]<sender Sender>(Sender&& _sender) mutable {
+            return then(std::forward<Sender>(_sender), std::move(func));
+        }};
+    }
+
+    /**
+     * Create a sender which invokes a function with every index in [0, _shape) and the value of a sender, then sends the value.
+     * If the sender completes on a mkr::thread_pool, the indices are split between the threads with mkr::parallel_for.
+     * Otherwise, they are run in order on the thread which completes the sender.
+     * @param _sender The predecessor.
+     * @param _shape The number of indices.
+     * @param _func The function. It is invoked with an index and an lvalue reference to the value, possibly concurrently.
+     * @return The sender.
+     */
+    template<sender Sender, std::integral Shape, typename Func>
+    detail::bulk_sender<std::decay_t<Sender>, Shape, std::decay_t<Func>> bulk(Sender&& _sender, Shape _shape, Func&& _func)
+    {
+        return {std::decay_t<Sender>{std::forward<Sender>(_sender)}, _shape, std::decay_t<Func>{std::forward<Func>(_func)}};
+    }
+
+    /**
+     * @return An adaptor which applies bulk() to the sender piped into it.
+     */
+    template<std::integral Shape, typename Func>
+    auto bulk(Shape _shape, Func&& _func)
+    {
+        return detail::sender_adaptor_closure{[_shape, func = std::forward<Func>(_func)]<sender Sender>(Sender&& _sender) mutable {
+            return bulk(std::forward<Sender>(_sender), _shape, std::move(func));
+        }};
+    }
+
+    /**
+     * Start a sender and wait for it to complete. The operation state lives on this function's stack frame.
+     * If the sender completes on a mkr::thread_pool, the calling thread runs pending tasks of the thread pool while waiting,
+     * so sync_wait() may be called from within a task of the same thread pool.
+     * @param _sender The sender.
+     * @return The value sent, in a std::tuple, or std::nullopt if the sender was stopped.
+     * @throws The exception the sender completed with, if any.
+     */
+    template<sender Sender>
+    std::optional<typename detail::sync_wait_result<typename std::remove_cvref_t<Sender>::value_type>::type> sync_wait(Sender&& _sender)
+    {
+        typedef typename std::remove_cvref_t<Sender>::value_type value_t;
+        detail::sync_wait_state<value_t> state;
+        thread_pool* tp = nullptr;
+        if constexpr (detail::thread_pool_sender<Sender>) { tp = &_sender.get_completion_scheduler().get_thread_pool(); }
+
+        auto operation = connect(std::forward<Sender>(_sender), detail::sync_wait_receiver<value_t>{&state});
+        start(operation);
+
+        if (tp) {
+            while (!state.done_.load()) {
+                if (!tp->run_pending_task()) { std::this_thread::yield(); }
+            }
+        }
+        // Wait for the receiver to release the lock, as it may still be notifying.
+        std::unique_lock lock{state.mutex_};
+        state.condition_.wait(lock, [&state]() { return state.done_.load(); });
+
+        if (state.error_) { std::rethrow_exception(state.error_); }
+        return std::move(state.value_);
+    }
+}
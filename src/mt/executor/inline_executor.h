@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../util/concepts.h"
+
+#include <future>
+
+namespace mkr {
+    /**
+     * An executor which runs every function immediately on the calling thread.
+     * Running an algorithm on an inline_executor has no scheduling overhead, which is the fastest choice for small inputs.
+     * Futures returned by submit() are always ready.
+     */
+    class inline_executor {
+    public:
+        /**
+         * Constructs the inline executor.
+         */
+        inline_executor() = default;
+        /**
+         * Destructs the inline executor.
+         */
+        ~inline_executor() = default;
+
+        /**
+         * @return 0, as every function is run by the calling thread.
+         */
+        inline size_t num_threads() const { return 0; }
+
+        /**
+         * There are never any pending tasks.
+         * @return Returns false.
+         */
+        inline bool run_pending_task() { return false; }
+
+        /**
+         * Wait until a std::future is ready. There are never any pending tasks to run while waiting.
+         * @tparam T The std::future type.
+         * @param _future The std::future to wait on.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::future<T>& _future) { _future.wait(); }
+
+        /**
+         * Wait until a std::shared_future is ready. There are never any pending tasks to run while waiting.
+         * @tparam T The std::shared_future type.
+         * @param _future The std::shared_future to wait on.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::shared_future<T>& _future) { _future.wait(); }
+
+        /**
+         * Run a function immediately, discarding its result.
+         * @tparam Callable The typename of the function or callable object.
+         * @param _func The function or callable object. It is invoked with no arguments.
+         */
+        template<typename Callable>
+        void post(Callable&& _func) { std::invoke(std::forward<Callable>(_func)); }
+
+        /**
+         * Run a function immediately.
+         * @tparam Callable The typename of the function or callable object.
+         * @tparam Args The typename of the function arguments.
+         * @param _func The function or callable object.
+         * @param _args The function arguments.
+         * @return A ready std::future which contains the result of the function, or the exception it threw.
+         */
+        template<typename Callable, typename... Args>
+        std::future<std::invoke_result_t<Callable, Args...>> submit(Callable&& _func, Args&& ... _args)
+        {
+            std::packaged_task<std::invoke_result_t<Callable, Args...>(Args&&...)> p_task{std::forward<Callable>(_func)};
+            std::future<std::invoke_result_t<Callable, Args...>> result = p_task.get_future();
+            p_task(std::forward<Args>(_args)...);
+            return result;
+        }
+    };
+
+    static_assert(executor<inline_executor>);
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "../thread_pool/task.h"
+#include "../util/concepts.h"
+#include "../util/future.h"
+
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace mkr {
+    /**
+     * An executor which only runs functions when asked to, in the order they were submitted.
+     * It makes the interleaving of tasks deterministic, which is useful for testing code written against the executor concept.
+     */
+    class manual_executor {
+    private:
+        /// Protects pending_tasks_.
+        mutable std::mutex mutex_;
+        /// The tasks which have been submitted but not run, in submission order.
+        std::deque<task> pending_tasks_;
+
+    public:
+        /**
+         * Constructs the manual executor.
+         */
+        manual_executor() = default;
+        /**
+         * Destructs the manual executor. Pending tasks are discarded without being run.
+         */
+        ~manual_executor() = default;
+
+        manual_executor(const manual_executor&) = delete;
+        manual_executor(manual_executor&&) = delete;
+        manual_executor& operator=(const manual_executor&) = delete;
+        manual_executor& operator=(manual_executor&&) = delete;
+
+        /**
+         * @return 0, as tasks are only run by threads that call run_pending_task().
+         */
+        inline size_t num_threads() const { return 0; }
+
+        /**
+         * @return The number of tasks which have been submitted but not run.
+         */
+        size_t num_pending() const
+        {
+            std::lock_guard lock{mutex_};
+            return pending_tasks_.size();
+        }
+
+        /**
+         * Run the oldest pending task.
+         * @return Returns true if a task was run. Else, return false.
+         */
+        bool run_pending_task()
+        {
+            std::unique_lock lock{mutex_};
+            if (pending_tasks_.empty()) { return false; }
+            task t = std::move(pending_tasks_.front());
+            pending_tasks_.pop_front();
+            lock.unlock();
+
+            t();
+            return true;
+        }
+
+        /**
+         * Run pending tasks until there are none left, including the tasks they submit.
+         * @return The number of tasks run.
+         */
+        size_t run_all()
+        {
+            size_t num_run = 0;
+            while (run_pending_task()) { ++num_run; }
+            return num_run;
+        }
+
+        /**
+         * While a std::future is not ready, run pending tasks.
+         * @tparam T The std::future type.
+         * @param _future The std::future to check if it is ready.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::future<T>& _future)
+        {
+            while (!is_future_ready(_future)) {
+                if (!run_pending_task()) { std::this_thread::yield(); }
+            }
+        }
+
+        /**
+         * While a std::shared_future is not ready, run pending tasks.
+         * @tparam T The std::shared_future type.
+         * @param _future The std::shared_future to check if it is ready.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::shared_future<T>& _future)
+        {
+            while (!is_future_ready(_future)) {
+                if (!run_pending_task()) { std::this_thread::yield(); }
+            }
+        }
+
+        /**
+         * Submit a task without a std::future to wait on. It is not run until a thread calls run_pending_task().
+         * @tparam Callable The typename of the function or callable object.
+         * @param _func The function or callable object. It is invoked with no arguments and its result is discarded.
+         */
+        template<typename Callable>
+        void post(Callable&& _func)
+        {
+            std::lock_guard lock{mutex_};
+            // Store a copy of the callable, as it may outlive the caller's.
+            pending_tasks_.emplace_back(std::decay_t<Callable>{std::forward<Callable>(_func)});
+        }
+
+        /**
+         * Submit a task. It is not run until a thread calls run_pending_task().
+         * @tparam Callable The typename of the function or callable object.
+         * @tparam Args The typename of the function arguments.
+         * @param _func The function or callable object.
+         * @param _args The function arguments.
+         * @return A std::future which will contain the result of the function.
+         */
+        template<typename Callable, typename... Args>
+        std::future<std::invoke_result_t<Callable, Args...>> submit(Callable&& _func, Args&& ... _args)
+        {
+            typedef std::invoke_result_t<Callable, Args...> result_t;
+
+            std::packaged_task<result_t(void)> p_task{
+                    [func = std::forward<Callable>(_func),
+                            ...args = std::forward<Args>(_args)]() {
+                        return std::invoke(func, args...);
+                    }};
+            std::future<result_t> result = p_task.get_future();
+            post(std::move(p_task));
+            return result;
+        }
+    };
+
+    static_assert(executor<manual_executor>);
+}
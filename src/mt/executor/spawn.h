@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../util/concepts.h"
+
+namespace mkr {
+    /**
+     * Spawn the child task of a fork-join algorithm. If the executor supports leapfrogging joins (such as mkr::thread_pool::fork),
+     * they are used, otherwise the task is submitted.
+     * The result is joined with _executor.run_pending_tasks(handle) followed by handle.get().
+     * @tparam Executor The typename of the executor.
+     * @tparam Callable The typename of the function or callable object.
+     * @param _executor The executor to run on.
+     * @param _func The function or callable object.
+     * @return A handle to the task, which is a std::future if the executor does not support leapfrogging.
+     */
+    template<executor Executor, typename Callable>
+    auto spawn(Executor& _executor, Callable&& _func)
+    {
+        if constexpr (requires { _executor.fork(std::forward<Callable>(_func)); }) {
+            return _executor.fork(std::forward<Callable>(_func));
+        }
+        else {
+            return _executor.submit(std::forward<Callable>(_func));
+        }
+    }
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "../thread_pool/task.h"
+#include "../util/concepts.h"
+#include "../util/future.h"
+
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace mkr {
+    namespace detail {
+        /// The strand whose tasks the calling thread is running, or nullptr.
+        inline thread_local const void* current_strand = nullptr;
+    }
+
+    /**
+     * An executor which runs functions one at a time, in submission order, on an underlying executor.
+     * Functions submitted to the same strand never run concurrently, so state that is only touched by them needs no lock.
+     * Functions submitted to different strands still run concurrently.
+     *
+     * Additional Notes:
+     * - At most one task which runs the strand's functions is in the underlying executor at a time. It runs every pending
+     *   function before it finishes.
+     * - A function running on the strand may wait for another function of the same strand with run_pending_tasks(),
+     *   which runs the strand's pending functions in order on the waiting thread.
+     * - Functions passed to post() must not throw.
+     * - strand is non-copyable AND non-movable.
+     *
+     * @tparam Executor The typename of the underlying executor.
+     */
+    template<executor Executor>
+    class strand {
+    private:
+        /// The executor which runs the strand's functions.
+        Executor& executor_;
+        /// Protects pending_tasks_ and running_.
+        std::mutex mutex_;
+        /// The tasks which have been submitted but not run, in submission order.
+        std::deque<task> pending_tasks_;
+        /// True while a task running the strand's functions has been posted to the underlying executor and has not finished.
+        bool running_ = false;
+
+        /**
+         * Remove the oldest pending task.
+         * @return The oldest pending task. If there are no pending tasks, running_ is set to false and std::nullopt is returned.
+         */
+        std::optional<task> pop_task()
+        {
+            std::lock_guard lock{mutex_};
+            if (pending_tasks_.empty()) {
+                running_ = false;
+                return std::nullopt;
+            }
+            task t = std::move(pending_tasks_.front());
+            pending_tasks_.pop_front();
+            return t;
+        }
+
+        /**
+         * Run pending tasks until there are none left.
+         */
+        void run_tasks()
+        {
+            const void* previous_strand = detail::current_strand;
+            detail::current_strand = this;
+            for (std::optional<task> t = pop_task(); t; t = pop_task()) {
+                (*t)();
+            }
+            detail::current_strand = previous_strand;
+        }
+
+        /**
+         * Add a task to the pending tasks, and make sure that the underlying executor will run it.
+         */
+        void push_task(task&& _task)
+        {
+            bool start;
+            {
+                std::lock_guard lock{mutex_};
+                pending_tasks_.push_back(std::move(_task));
+                start = !running_;
+                running_ = true;
+            }
+            if (start) { executor_.post([this]() { run_tasks(); }); }
+        }
+
+    public:
+        /**
+         * Constructs the strand.
+         * @param _executor The executor which runs the strand's functions. It must outlive the strand.
+         */
+        explicit strand(Executor& _executor)
+                :executor_{_executor} { }
+
+        /**
+         * Destructs the strand after its pending functions have run.
+         */
+        ~strand()
+        {
+            while (true) {
+                {
+                    std::lock_guard lock{mutex_};
+                    if (!running_) { break; }
+                }
+                if (!executor_.run_pending_task()) { std::this_thread::yield(); }
+            }
+        }
+
+        strand(const strand&) = delete;
+        strand(strand&&) = delete;
+        strand& operator=(const strand&) = delete;
+        strand& operator=(strand&&) = delete;
+
+        /**
+         * @return 1, as the strand's functions run one at a time.
+         */
+        inline size_t num_threads() const { return 1; }
+
+        /**
+         * Checks if the calling thread is running one of the strand's functions.
+         * @return Returns true if the calling thread is running one of the strand's functions. Else, returns false.
+         */
+        inline bool running_in_this_thread() const { return detail::current_strand==this; }
+
+        /**
+         * Run a pending task. If the calling thread is running one of the strand's functions, the strand's next function is run.
+         * Otherwise, a pending task of the underlying executor is run.
+         * @return Returns true if a task was run. Else, return false.
+         */
+        bool run_pending_task()
+        {
+            if (running_in_this_thread()) {
+                std::unique_lock lock{mutex_};
+                if (!pending_tasks_.empty()) {
+                    task t = std::move(pending_tasks_.front());
+                    pending_tasks_.pop_front();
+                    lock.unlock();
+                    t();
+                    return true;
+                }
+            }
+            return executor_.run_pending_task();
+        }
+
+        /**
+         * While a std::future is not ready, run pending tasks.
+         * @tparam T The std::future type.
+         * @param _future The std::future to check if it is ready.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::future<T>& _future)
+        {
+            while (!is_future_ready(_future)) {
+                if (!run_pending_task()) { std::this_thread::yield(); }
+            }
+        }
+
+        /**
+         * While a std::shared_future is not ready, run pending tasks.
+         * @tparam T The std::shared_future type.
+         * @param _future The std::shared_future to check if it is ready.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::shared_future<T>& _future)
+        {
+            while (!is_future_ready(_future)) {
+                if (!run_pending_task()) { std::this_thread::yield(); }
+            }
+        }
+
+        /**
+         * Submit a function to the strand without a std::future to wait on.
+         * @tparam Callable The typename of the function or callable object.
+         * @param _func The function or callable object. It is invoked with no arguments and its result is discarded.
+         */
+        template<typename Callable>
+        void post(Callable&& _func)
+        {
+            // Store a copy of the callable, as it may outlive the caller's.
+            push_task(task{std::decay_t<Callable>{std::forward<Callable>(_func)}});
+        }
+
+        /**
+         * Submit a function to the strand.
+         * @tparam Callable The typename of the function or callable object.
+         * @tparam Args The typename of the function arguments.
+         * @param _func The function or callable object.
+         * @param _args The function arguments.
+         * @return A std::future which will contain the result of the function.
+         */
+        template<typename Callable, typename... Args>
+        std::future<std::invoke_result_t<Callable, Args...>> submit(Callable&& _func, Args&& ... _args)
+        {
+            typedef std::invoke_result_t<Callable, Args...> result_t;
+
+            std::packaged_task<result_t(void)> p_task{
+                    [func = std::forward<Callable>(_func),
+                            ...args = std::forward<Args>(_args)]() {
+                        return std::invoke(func, args...);
+                    }};
+            std::future<result_t> result = p_task.get_future();
+            push_task(task{std::move(p_task)});
+            return result;
+        }
+    };
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "csr_graph.h"
+#include "../algorithm/parallel_reduce.h"
+#include "../container/atomic_bitmap.h"
+
+#include <numeric>
+#include <utility>
+
+namespace mkr {
+    /**
+     * The direction of a step of mkr::parallel_bfs.
+     */
+    enum class bfs_direction {
+        /// The frontier's outgoing edges were expanded.
+        top_down,
+        /// Every unvisited vertex searched its incoming edges for a parent in the frontier.
+        bottom_up,
+    };
+
+    /**
+     * Direction-optimizing parallel breadth-first search. [Beamer, Asanović & Patterson, "Direction-Optimizing Breadth-First Search", SC 2012]
+     *
+     * While the frontier is small, a top-down step expands the frontier's outgoing edges, and each task collects the vertices it
+     * discovers in its own buffer. The buffers are then merged into the next frontier with a prefix scan of their sizes.
+     * Once the frontier's outgoing edges outnumber the unexplored edges by _alpha, a bottom-up step is used instead,
+     * where every unvisited vertex searches its incoming edges for a parent in the frontier, which is held in a bitmap.
+     * It switches back to top-down once the frontier shrinks below 1/_beta of the vertices.
+     *
+     * @tparam V The typename of the vertex ids.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _graph The graph.
+     * @param _transpose The transpose of the graph. For undirected graphs, this is the graph itself.
+     * @param _source The vertex to start the search from.
+     * @param _alpha Switch to bottom-up when the frontier's edges exceed the unexplored edges divided by _alpha.
+     * @param _beta Switch to top-down when the frontier is smaller than the number of vertices divided by _beta.
+     * @param _directions If not null, the direction of every step, one per level of the search, is appended to it.
+     * @return The parent of every vertex in the search tree. The parent of _source is itself, and unreachable vertices have csr_graph<V>::invalid_vertex.
+     */
+    template<executor Executor, std::unsigned_integral V>
+    std::vector<V> parallel_bfs(Executor& _executor, const csr_graph<V>& _graph, const csr_graph<V>& _transpose,
+                                std::type_identity_t<V> _source, std::size_t _alpha = 15, std::size_t _beta = 18,
+                                std::vector<bfs_direction>* _directions = nullptr)
+    {
+        constexpr V invalid_vertex = csr_graph<V>::invalid_vertex;
+        constexpr std::size_t grain_size = 1024;
+        const std::size_t num_vertices = _graph.num_vertices();
+        const std::size_t num_tasks = 4*(_executor.num_threads()+1);
+
+        std::vector<V> parents(num_vertices, invalid_vertex);
+        parents[_source] = _source;
+
+        std::vector<V> frontier{_source};
+        atomic_bitmap current_bitmap{num_vertices};
+        atomic_bitmap next_bitmap{num_vertices};
+
+        // Number of edges leaving the frontier, and number of edges leaving unvisited vertices.
+        std::size_t frontier_edges = _graph.degree(_source);
+        std::size_t unexplored_edges = _graph.num_edges();
+
+        while (!frontier.empty()) {
+            if (frontier_edges>unexplored_edges/_alpha) {
+                // Convert the frontier into a bitmap.
+                current_bitmap.clear();
+                parallel_for(_executor, blocked_range<std::size_t>{0, frontier.size(), grain_size}, [&](const blocked_range<std::size_t>& _range) {
+                    for (std::size_t i = _range.begin(); i<_range.end(); ++i) { current_bitmap.set(frontier[i]); }
+                });
+
+                // Bottom-up steps. Every vertex is owned by exactly one task, so parents can be written without atomics.
+                // Each step counts the vertices it discovers and their edges, so that the switch back to top-down, and a later
+                // switch to bottom-up, see the same inputs as after a top-down step.
+                typedef std::pair<std::size_t, std::size_t> count_t;
+                std::size_t previous_frontier_size;
+                std::size_t frontier_size = frontier.size();
+                do {
+                    if (_directions) { _directions->push_back(bfs_direction::bottom_up); }
+                    unexplored_edges -= std::min(frontier_edges, unexplored_edges);
+                    previous_frontier_size = frontier_size;
+                    next_bitmap.clear();
+                    const count_t discovered = parallel_reduce(_executor, blocked_range<std::size_t>{0, num_vertices, grain_size}, count_t{0, 0},
+                            [&](const blocked_range<std::size_t>& _range, count_t _count) {
+                                for (std::size_t v = _range.begin(); v<_range.end(); ++v) {
+                                    if (parents[v]!=invalid_vertex) { continue; }
+                                    for (V u : _transpose.neighbours(static_cast<V>(v))) {
+                                        if (current_bitmap.test(u)) {
+                                            parents[v] = u;
+                                            next_bitmap.set(v);
+                                            ++_count.first;
+                                            _count.second += _graph.degree(static_cast<V>(v));
+                                            break;
+                                        }
+                                    }
+                                }
+                                return _count;
+                            }, [](const count_t& _a, const count_t& _b) { return count_t{_a.first+_b.first, _a.second+_b.second}; });
+                    frontier_size = discovered.first;
+                    frontier_edges = discovered.second;
+                    current_bitmap.swap(next_bitmap);
+                } while (frontier_size>0 && (frontier_size>=previous_frontier_size || frontier_size>num_vertices/_beta));
+
+                // Convert the bitmap back into a frontier.
+                std::vector<std::vector<V>> buffers(num_tasks);
+                parallel_for(_executor, blocked_range<std::size_t>{0, num_tasks}, [&](const blocked_range<std::size_t>& _tasks) {
+                    for (std::size_t t = _tasks.begin(); t<_tasks.end(); ++t) {
+                        for (std::size_t v = t*num_vertices/num_tasks; v<(t+1)*num_vertices/num_tasks; ++v) {
+                            if (current_bitmap.test(v)) { buffers[t].push_back(static_cast<V>(v)); }
+                        }
+                    }
+                });
+                frontier = parallel_concatenate(_executor, buffers);
+            }
+            else {
+                // Top-down step. A vertex is claimed by whichever task first swaps its parent from invalid_vertex.
+                if (_directions) { _directions->push_back(bfs_direction::top_down); }
+                unexplored_edges -= std::min(frontier_edges, unexplored_edges);
+                std::vector<std::vector<V>> buffers(num_tasks);
+                std::vector<std::size_t> buffer_edges(num_tasks, 0);
+                parallel_for(_executor, blocked_range<std::size_t>{0, num_tasks}, [&](const blocked_range<std::size_t>& _tasks) {
+                    for (std::size_t t = _tasks.begin(); t<_tasks.end(); ++t) {
+                        for (std::size_t i = t*frontier.size()/num_tasks; i<(t+1)*frontier.size()/num_tasks; ++i) {
+                            const V u = frontier[i];
+                            for (V v : _graph.neighbours(u)) {
+                                std::atomic_ref<V> parent{parents[v]};
+                                V expected = invalid_vertex;
+                                if (parent.load(std::memory_order_relaxed)==invalid_vertex &&
+                                        parent.compare_exchange_strong(expected, u, std::memory_order_relaxed)) {
+                                    buffers[t].push_back(v);
+                                    buffer_edges[t] += _graph.degree(v);
+                                }
+                            }
+                        }
+                    }
+                });
+                frontier = parallel_concatenate(_executor, buffers);
+                frontier_edges = std::accumulate(buffer_edges.begin(), buffer_edges.end(), std::size_t{0});
+            }
+        }
+
+        return parents;
+    }
+
+    /**
+     * Direction-optimizing parallel breadth-first search on an undirected graph.
+     * @tparam V The typename of the vertex ids.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _graph The graph. Every edge must be stored in both directions.
+     * @param _source The vertex to start the search from.
+     * @return The parent of every vertex in the search tree. The parent of _source is itself, and unreachable vertices have csr_graph<V>::invalid_vertex.
+     */
+    template<executor Executor, std::unsigned_integral V>
+    std::vector<V> parallel_bfs(Executor& _executor, const csr_graph<V>& _graph, std::type_identity_t<V> _source)
+    {
+        return parallel_bfs(_executor, _graph, _graph, _source);
+    }
+}
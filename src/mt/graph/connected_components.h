@@ -0,0 +1,87 @@
+#pragma once
+
+#include "csr_graph.h"
+
+#include <numeric>
+
+namespace mkr {
+    namespace detail {
+        /**
+         * Find the root of a vertex in a concurrent union-find forest, halving the path along the way.
+         * @param _parents The union-find forest.
+         * @param _vertex The vertex.
+         * @return The root of the vertex.
+         */
+        template<std::unsigned_integral V>
+        V union_find_root(std::vector<V>& _parents, V _vertex)
+        {
+            while (true) {
+                V parent = std::atomic_ref<V>{_parents[_vertex]}.load(std::memory_order_relaxed);
+                if (parent==_vertex) { return _vertex; }
+                V grandparent = std::atomic_ref<V>{_parents[parent]}.load(std::memory_order_relaxed);
+                // Path halving. If another thread has already changed the parent, the compare_exchange simply fails.
+                if (parent!=grandparent) {
+                    std::atomic_ref<V>{_parents[_vertex]}.compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+                }
+                _vertex = grandparent;
+            }
+        }
+
+        /**
+         * Merge the sets of two vertices in a concurrent union-find forest. The root with the larger id is always hooked
+         * onto the root with the smaller id, so that the root of every set is its smallest vertex and no cycles can form.
+         * @param _parents The union-find forest.
+         * @param _u The first vertex.
+         * @param _v The second vertex.
+         */
+        template<std::unsigned_integral V>
+        void union_find_unite(std::vector<V>& _parents, V _u, V _v)
+        {
+            while (true) {
+                _u = union_find_root(_parents, _u);
+                _v = union_find_root(_parents, _v);
+                if (_u==_v) { return; }
+                if (_u<_v) { std::swap(_u, _v); }
+                // Only a root can be hooked. If _u stopped being a root in the meantime, try again from the new roots.
+                V expected = _u;
+                if (std::atomic_ref<V>{_parents[_u]}.compare_exchange_strong(expected, _v, std::memory_order_acq_rel)) { return; }
+            }
+        }
+    }
+
+    /**
+     * Parallel connected components using a lock-free union-find. Edge directions are ignored, so for directed graphs the result is the weakly connected components.
+     * Every task unites the endpoints of the edges of its vertices, after which every vertex is labelled with the root of its set.
+     * @tparam V The typename of the vertex ids.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _graph The graph.
+     * @return The component label of every vertex, which is the smallest vertex id in its component.
+     */
+    template<executor Executor, std::unsigned_integral V>
+    std::vector<V> parallel_connected_components(Executor& _executor, const csr_graph<V>& _graph)
+    {
+        constexpr std::size_t grain_size = 1024;
+        const std::size_t num_vertices = _graph.num_vertices();
+
+        std::vector<V> labels(num_vertices);
+        std::iota(labels.begin(), labels.end(), V{0});
+
+        parallel_for(_executor, blocked_range<std::size_t>{0, num_vertices, grain_size}, [&](const blocked_range<std::size_t>& _range) {
+            for (std::size_t u = _range.begin(); u<_range.end(); ++u) {
+                for (V v : _graph.neighbours(static_cast<V>(u))) {
+                    detail::union_find_unite(labels, static_cast<V>(u), v);
+                }
+            }
+        });
+
+        // Flatten the forest so that every vertex points directly to its root. Other tasks may still be walking through this vertex.
+        parallel_for(_executor, blocked_range<std::size_t>{0, num_vertices, grain_size}, [&](const blocked_range<std::size_t>& _range) {
+            for (std::size_t v = _range.begin(); v<_range.end(); ++v) {
+                std::atomic_ref<V>{labels[v]}.store(detail::union_find_root(labels, static_cast<V>(v)), std::memory_order_relaxed);
+            }
+        });
+
+        return labels;
+    }
+}
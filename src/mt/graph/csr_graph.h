@@ -0,0 +1,138 @@
+#pragma once
+
+#include "../algorithm/parallel_scan.h"
+
+#include <atomic>
+#include <concepts>
+#include <limits>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace mkr {
+    /**
+     * A directed graph in compressed sparse row (CSR) format.
+     * The neighbours of vertex v are neighbours_[offsets_[v]..offsets_[v+1]).
+     * An undirected graph is represented by storing every edge in both directions.
+     *
+     * Invariants:
+     * - offsets_.size() == num_vertices()+1
+     * - offsets_.front() == 0, offsets_.back() == neighbours_.size(), and offsets_ is non-decreasing.
+     * - Every neighbour is less than num_vertices().
+     *
+     * @tparam V The typename of the vertex ids. std::numeric_limits<V>::max() is reserved as an invalid vertex id.
+     */
+    template<std::unsigned_integral V = std::uint32_t>
+    class csr_graph {
+    public:
+        typedef V vertex_type;
+        /// A vertex id that does not belong to any vertex.
+        static constexpr V invalid_vertex = std::numeric_limits<V>::max();
+
+    private:
+        /// The offset of each vertex's neighbours.
+        std::vector<std::size_t> offsets_;
+        /// The neighbours of all the vertices.
+        std::vector<V> neighbours_;
+
+        /**
+         * Internal function to build a graph from an edge list with a parallel counting sort.
+         * @tparam EdgeFn The typename of the function which returns the (source, target) of an edge.
+         * @tparam Executor The typename of the executor.
+         * @param _executor The executor to run on.
+         * @param _num_vertices The number of vertices.
+         * @param _num_edges The number of edges.
+         * @param _edge_fn The function which returns the (source, target) of edge i.
+         * @return The graph. The order of each vertex's neighbours is unspecified.
+         */
+        template<executor Executor, typename EdgeFn>
+        static csr_graph build(Executor& _executor, std::size_t _num_vertices, std::size_t _num_edges, const EdgeFn& _edge_fn)
+        {
+            constexpr std::size_t grain_size = 4096;
+            std::vector<std::size_t> offsets(_num_vertices+1, 0);
+
+            // Count the degree of every vertex.
+            parallel_for(_executor, blocked_range<std::size_t>{0, _num_edges, grain_size}, [&](const blocked_range<std::size_t>& _range) {
+                for (std::size_t i = _range.begin(); i<_range.end(); ++i) {
+                    std::atomic_ref<std::size_t>{offsets[_edge_fn(i).first]}.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+            parallel_exclusive_scan(_executor, offsets.begin(), offsets.end(), offsets.begin(), std::size_t{0});
+
+            // Scatter the edges. Each edge claims the next free position of its source vertex.
+            std::vector<std::size_t> cursors(offsets.begin(), offsets.end()-1);
+            std::vector<V> neighbours(_num_edges);
+            parallel_for(_executor, blocked_range<std::size_t>{0, _num_edges, grain_size}, [&](const blocked_range<std::size_t>& _range) {
+                for (std::size_t i = _range.begin(); i<_range.end(); ++i) {
+                    const std::pair<V, V> edge = _edge_fn(i);
+                    neighbours[std::atomic_ref<std::size_t>{cursors[edge.first]}.fetch_add(1, std::memory_order_relaxed)] = edge.second;
+                }
+            });
+
+            return csr_graph{std::move(offsets), std::move(neighbours)};
+        }
+
+    public:
+        /**
+         * Constructs an empty graph.
+         */
+        csr_graph()
+                :offsets_(1, 0) { }
+
+        /**
+         * Constructs the graph from its CSR arrays.
+         * @param _offsets The offset of each vertex's neighbours, followed by the number of edges.
+         * @param _neighbours The neighbours of all the vertices.
+         */
+        csr_graph(std::vector<std::size_t> _offsets, std::vector<V> _neighbours)
+                :offsets_{std::move(_offsets)}, neighbours_{std::move(_neighbours)} { }
+
+        /**
+         * Build a graph from an edge list.
+         * @tparam Executor The typename of the executor.
+         * @param _executor The executor to run on.
+         * @param _num_vertices The number of vertices.
+         * @param _edges The (source, target) of every edge.
+         * @return The graph.
+         */
+        template<executor Executor>
+        static csr_graph from_edges(Executor& _executor, std::size_t _num_vertices, const std::vector<std::pair<V, V>>& _edges)
+        {
+            return build(_executor, _num_vertices, _edges.size(), [&_edges](std::size_t _i) { return _edges[_i]; });
+        }
+
+        /**
+         * Build the transpose of this graph, where every edge is reversed. It holds the incoming edges of every vertex.
+         * @tparam Executor The typename of the executor.
+         * @param _executor The executor to run on.
+         * @return The transpose of this graph.
+         */
+        template<executor Executor>
+        csr_graph transpose(Executor& _executor) const
+        {
+            // Finding the source of edge i requires a search of the offsets, so lay out the sources first.
+            std::vector<V> sources(num_edges());
+            parallel_for(_executor, blocked_range<std::size_t>{0, num_vertices(), 1024}, [&](const blocked_range<std::size_t>& _range) {
+                for (std::size_t v = _range.begin(); v<_range.end(); ++v) {
+                    std::fill(sources.begin()+offsets_[v], sources.begin()+offsets_[v+1], static_cast<V>(v));
+                }
+            });
+            return build(_executor, num_vertices(), num_edges(), [&](std::size_t _i) {
+                return std::pair<V, V>{neighbours_[_i], sources[_i]};
+            });
+        }
+
+        inline std::size_t num_vertices() const { return offsets_.size()-1; }
+        inline std::size_t num_edges() const { return neighbours_.size(); }
+        inline std::size_t degree(V _vertex) const { return offsets_[_vertex+1]-offsets_[_vertex]; }
+
+        /**
+         * @param _vertex The vertex.
+         * @return The neighbours of the vertex.
+         */
+        inline std::span<const V> neighbours(V _vertex) const
+        {
+            return {neighbours_.data()+offsets_[_vertex], degree(_vertex)};
+        }
+    };
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "csr_graph.h"
+#include "../algorithm/parallel_reduce.h"
+
+#include <cmath>
+
+namespace mkr {
+    /**
+     * Parallel pull-based PageRank. Every vertex sums the contributions of its incoming edges, so each rank is written by exactly
+     * one task and no atomics are needed. The rank of vertices without outgoing edges is spread evenly over all vertices.
+     * @tparam V The typename of the vertex ids.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _graph The graph.
+     * @param _transpose The transpose of the graph. For undirected graphs, this is the graph itself.
+     * @param _damping The damping factor.
+     * @param _tolerance Stop once the L1 norm of the change in ranks is below this value.
+     * @param _max_iterations The maximum number of iterations.
+     * @return The rank of every vertex. The ranks sum to 1.
+     */
+    template<executor Executor, std::unsigned_integral V>
+    std::vector<double> parallel_pagerank(Executor& _executor, const csr_graph<V>& _graph, const csr_graph<V>& _transpose,
+                                          double _damping = 0.85, double _tolerance = 1e-6, std::size_t _max_iterations = 100)
+    {
+        constexpr std::size_t grain_size = 1024;
+        const std::size_t num_vertices = _graph.num_vertices();
+        if (num_vertices==0) { return {}; }
+
+        std::vector<double> ranks(num_vertices, 1.0/static_cast<double>(num_vertices));
+        std::vector<double> contributions(num_vertices);
+
+        for (std::size_t iteration = 0; iteration<_max_iterations; ++iteration) {
+            // Compute the contribution of every vertex to each of its neighbours, and sum the rank of the dangling vertices.
+            double dangling_rank = parallel_reduce(_executor, blocked_range<std::size_t>{0, num_vertices, grain_size}, 0.0,
+                    [&](const blocked_range<std::size_t>& _range, double _sum) {
+                        for (std::size_t u = _range.begin(); u<_range.end(); ++u) {
+                            std::size_t degree = _graph.degree(static_cast<V>(u));
+                            contributions[u] = degree==0 ? 0.0 : ranks[u]/static_cast<double>(degree);
+                            if (degree==0) { _sum += ranks[u]; }
+                        }
+                        return _sum;
+                    }, std::plus<double>{});
+
+            // Pull the contributions and measure the change.
+            const double base_rank = (1.0-_damping+_damping*dangling_rank)/static_cast<double>(num_vertices);
+            double error = parallel_reduce(_executor, blocked_range<std::size_t>{0, num_vertices, grain_size}, 0.0,
+                    [&](const blocked_range<std::size_t>& _range, double _error) {
+                        for (std::size_t v = _range.begin(); v<_range.end(); ++v) {
+                            double incoming = 0.0;
+                            for (V u : _transpose.neighbours(static_cast<V>(v))) { incoming += contributions[u]; }
+                            double new_rank = base_rank+_damping*incoming;
+                            _error += std::abs(new_rank-ranks[v]);
+                            ranks[v] = new_rank;
+                        }
+                        return _error;
+                    }, std::plus<double>{});
+
+            if (error<_tolerance) { break; }
+        }
+
+        return ranks;
+    }
+}
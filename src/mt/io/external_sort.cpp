@@ -0,0 +1,432 @@
+#include "external_sort.h"
+#include "mapped_file.h"
+#include "parallel_for_each_line.h"
+#include "../algorithm/loser_tree.h"
+#include "../algorithm/parallel_scan.h"
+#include "../algorithm/parallel_sort.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace mkr {
+    namespace {
+        /**
+         * An anonymous temporary file. It is unlinked as soon as it is created, so it is deleted when it is closed, even if the process crashes.
+         */
+        class temp_file {
+        private:
+            int fd_;
+            std::uint64_t size_;
+
+        public:
+            explicit temp_file(const std::string& _directory)
+                    :fd_{-1}, size_{0}
+            {
+                std::string path = (std::filesystem::path{_directory}/"mkr_mt_sort_XXXXXX").string();
+                fd_ = ::mkstemp(path.data());
+                if (fd_<0) { throw std::system_error(errno, std::generic_category(), "mkstemp " + path); }
+                ::unlink(path.c_str());
+            }
+
+            temp_file(temp_file&& _other) noexcept
+                    :fd_{_other.fd_}, size_{_other.size_}
+            {
+                _other.fd_ = -1;
+            }
+
+            ~temp_file()
+            {
+                if (fd_>=0) { ::close(fd_); }
+            }
+
+            temp_file(const temp_file&) = delete;
+            temp_file& operator=(const temp_file&) = delete;
+            temp_file& operator=(temp_file&&) = delete;
+
+            inline int fd() const { return fd_; }
+            inline std::uint64_t size() const { return size_; }
+            inline void set_size(std::uint64_t _size) { size_ = _size; }
+        };
+
+        /**
+         * Wait for an asynchronous write and check that it wrote everything.
+         */
+        void finish_write(thread_pool& _thread_pool, std::future<std::int64_t>& _write, std::size_t _expected_size)
+        {
+            _thread_pool.run_pending_tasks(_write);
+            std::int64_t result = _write.get();
+            if (result<0) { throw std::system_error(static_cast<int>(-result), std::generic_category(), "external_sort write"); }
+            if (static_cast<std::size_t>(result)!=_expected_size) { throw std::system_error(EIO, std::generic_category(), "external_sort short write"); }
+        }
+
+        /**
+         * A sorted run being spilled to a temporary file in blocks.
+         */
+        struct spill {
+            thread_pool& thread_pool_;
+            temp_file file_;
+            std::vector<char> buffer_;
+            std::vector<std::future<std::int64_t>> writes_;
+            std::vector<std::size_t> write_sizes_;
+
+            spill(thread_pool& _thread_pool, io_executor& _io_executor, const std::string& _directory, std::vector<char> _buffer, std::size_t _block_size)
+                    :thread_pool_{_thread_pool}, file_{_directory}, buffer_{std::move(_buffer)}
+            {
+                _block_size = std::max<std::size_t>(_block_size, 1);
+                for (std::size_t offset = 0; offset<buffer_.size(); offset += _block_size) {
+                    std::size_t size = std::min(_block_size, buffer_.size()-offset);
+                    writes_.push_back(_io_executor.write(file_.fd(), buffer_.data()+offset, size, offset));
+                    write_sizes_.push_back(size);
+                }
+                file_.set_size(buffer_.size());
+            }
+
+            ~spill()
+            {
+                // The buffer must outlive the writes, even if finish() was never called.
+                for (std::future<std::int64_t>& write : writes_) {
+                    if (write.valid()) { thread_pool_.run_pending_tasks(write); }
+                }
+            }
+
+            spill(const spill&) = delete;
+            spill& operator=(const spill&) = delete;
+
+            /**
+             * Wait for every write to finish.
+             * @return The file holding the run.
+             */
+            temp_file finish()
+            {
+                for (std::size_t i = 0; i<writes_.size(); ++i) { finish_write(thread_pool_, writes_[i], write_sizes_[i]); }
+                return std::move(file_);
+            }
+        };
+
+        /**
+         * Reads the records of a run in order, reading ahead asynchronously.
+         */
+        class run_reader {
+        private:
+            thread_pool& thread_pool_;
+            io_executor& io_executor_;
+            const temp_file& file_;
+            const std::size_t block_size_;
+            /// The file offset of the next read to issue.
+            std::uint64_t next_offset_;
+
+            /// Bytes [position_, end_) of buffer_ have been read but not consumed.
+            std::vector<char> buffer_;
+            std::size_t position_;
+            std::size_t end_;
+
+            /// The block being read ahead.
+            std::vector<char> read_ahead_;
+            std::future<std::int64_t> read_ahead_result_;
+            std::size_t read_ahead_size_;
+
+            void read_ahead()
+            {
+                if (next_offset_>=file_.size()) { return; }
+                read_ahead_size_ = static_cast<std::size_t>(std::min<std::uint64_t>(block_size_, file_.size()-next_offset_));
+                read_ahead_result_ = io_executor_.read(file_.fd(), read_ahead_.data(), read_ahead_size_, next_offset_);
+                next_offset_ += read_ahead_size_;
+            }
+
+            /**
+             * Append the block being read ahead to the unconsumed bytes, and start reading the next block.
+             * @return Returns false if the run has been read completely.
+             */
+            bool refill()
+            {
+                if (!read_ahead_result_.valid()) { return false; }
+                thread_pool_.run_pending_tasks(read_ahead_result_);
+                std::int64_t result = read_ahead_result_.get();
+                if (result<0) { throw std::system_error(static_cast<int>(-result), std::generic_category(), "external_sort read"); }
+                if (static_cast<std::size_t>(result)!=read_ahead_size_) { throw std::system_error(EIO, std::generic_category(), "external_sort short read"); }
+
+                // Move the partial record to the front. A record longer than a block grows the buffer.
+                std::size_t remaining = end_-position_;
+                std::memmove(buffer_.data(), buffer_.data()+position_, remaining);
+                if (buffer_.size()<remaining+read_ahead_size_) { buffer_.resize(remaining+read_ahead_size_); }
+                std::memcpy(buffer_.data()+remaining, read_ahead_.data(), read_ahead_size_);
+                position_ = 0;
+                end_ = remaining+read_ahead_size_;
+
+                read_ahead();
+                return true;
+            }
+
+        public:
+            run_reader(thread_pool& _thread_pool, io_executor& _io_executor, const temp_file& _file, std::size_t _block_size)
+                    :thread_pool_{_thread_pool}, io_executor_{_io_executor}, file_{_file}, block_size_{_block_size}, next_offset_{0},
+                     buffer_(_block_size), position_{0}, end_{0}, read_ahead_(_block_size), read_ahead_size_{0}
+            {
+                read_ahead();
+            }
+
+            ~run_reader()
+            {
+                // The read ahead buffer must outlive the read.
+                if (read_ahead_result_.valid()) { thread_pool_.run_pending_tasks(read_ahead_result_); }
+            }
+
+            run_reader(const run_reader&) = delete;
+            run_reader& operator=(const run_reader&) = delete;
+
+            /**
+             * Read the next record. The previous record returned by this reader is invalidated.
+             * @return The next record without its newline, or std::nullopt if the run has been read completely.
+             */
+            std::optional<std::string_view> next()
+            {
+                while (true) {
+                    const char* begin = buffer_.data()+position_;
+                    const void* newline = std::memchr(begin, '\n', end_-position_);
+                    if (newline) {
+                        std::size_t length = static_cast<std::size_t>(static_cast<const char*>(newline)-begin);
+                        position_ += length+1;
+                        return std::string_view{begin, length};
+                    }
+                    // Every record of a run ends with a newline, so any bytes left at the end of the run are not a record.
+                    if (!refill()) { return std::nullopt; }
+                }
+            }
+        };
+
+        /**
+         * Writes records to a file, writing one buffer asynchronously while filling the other.
+         */
+        class output_writer {
+        private:
+            thread_pool& thread_pool_;
+            io_executor& io_executor_;
+            const int fd_;
+            const std::size_t block_size_;
+            std::uint64_t offset_;
+
+            std::vector<char> buffer_;
+            std::vector<char> writing_buffer_;
+            std::future<std::int64_t> write_result_;
+
+            void flush()
+            {
+                if (write_result_.valid()) { finish_write(thread_pool_, write_result_, writing_buffer_.size()); }
+                buffer_.swap(writing_buffer_);
+                buffer_.clear();
+                write_result_ = io_executor_.write(fd_, writing_buffer_.data(), writing_buffer_.size(), offset_);
+                offset_ += writing_buffer_.size();
+            }
+
+        public:
+            output_writer(thread_pool& _thread_pool, io_executor& _io_executor, int _fd, std::size_t _block_size)
+                    :thread_pool_{_thread_pool}, io_executor_{_io_executor}, fd_{_fd}, block_size_{_block_size}, offset_{0}
+            {
+                buffer_.reserve(block_size_);
+                writing_buffer_.reserve(block_size_);
+            }
+
+            ~output_writer()
+            {
+                // The writing buffer must outlive the write.
+                if (write_result_.valid()) { thread_pool_.run_pending_tasks(write_result_); }
+            }
+
+            output_writer(const output_writer&) = delete;
+            output_writer& operator=(const output_writer&) = delete;
+
+            void append(std::string_view _record)
+            {
+                if (!buffer_.empty() && buffer_.size()+_record.size()+1>block_size_) { flush(); }
+                buffer_.insert(buffer_.end(), _record.begin(), _record.end());
+                buffer_.push_back('\n');
+            }
+
+            /**
+             * Write the remaining records and wait for every write to finish.
+             * @return The number of bytes written.
+             */
+            std::uint64_t finish()
+            {
+                if (!buffer_.empty()) { flush(); }
+                if (write_result_.valid()) { finish_write(thread_pool_, write_result_, writing_buffer_.size()); }
+                return offset_;
+            }
+        };
+
+        /// The bytes which merging a run needs besides its buffers, for its reader, its head and its read in flight.
+        constexpr std::size_t merge_bytes_per_run = 1024;
+
+        /**
+         * The part of the memory budget, in tenths, which runs and merge buffers are sized from. The rest is headroom for what the model
+         * does not count: the thread pool's tasks and futures, the growth of the vectors of runs, and the loser tree.
+         */
+        constexpr std::size_t modelled_budget_tenths = 9;
+
+        /**
+         * Merge sorted runs into a file.
+         * @return The number of bytes written.
+         */
+        std::uint64_t merge_runs(thread_pool& _thread_pool, io_executor& _io_executor, const std::vector<temp_file>& _runs,
+                                 std::size_t _first, std::size_t _last, int _output_fd, std::size_t _block_size)
+        {
+            std::vector<std::unique_ptr<run_reader>> readers;
+            std::vector<std::optional<std::string_view>> heads;
+            for (std::size_t i = _first; i<_last; ++i) {
+                readers.push_back(std::make_unique<run_reader>(_thread_pool, _io_executor, _runs[i], _block_size));
+                heads.push_back(readers.back()->next());
+            }
+
+            // Each head stays valid until its own reader is advanced, which only happens after the head has been written.
+            loser_tree<std::string_view> tree{std::move(heads)};
+            output_writer writer{_thread_pool, _io_executor, _output_fd, _block_size};
+            while (!tree.empty()) {
+                writer.append(tree.top());
+                tree.replace_top(readers[tree.top_index()]->next());
+            }
+            return writer.finish();
+        }
+
+        /**
+         * Find the records of a run and sort them.
+         */
+        std::vector<std::string_view> sort_run(thread_pool& _thread_pool, std::string_view _run)
+        {
+            // Find the records of each piece of the run in parallel, then join them.
+            const std::size_t num_pieces = 4*(_thread_pool.num_threads()+1);
+            std::vector<std::string_view> pieces = split_at_newlines(_run, _run.size()/num_pieces+1);
+            std::vector<std::vector<std::string_view>> piece_records(pieces.size());
+            parallel_for(_thread_pool, blocked_range<std::size_t>{0, pieces.size()}, [&](const blocked_range<std::size_t>& _range) {
+                for (std::size_t i = _range.begin(); i<_range.end(); ++i) {
+                    for_each_line(pieces[i], [&](std::string_view _record) { piece_records[i].push_back(_record); });
+                }
+            });
+            std::vector<std::string_view> records = parallel_concatenate(_thread_pool, piece_records);
+            // Free the pieces' records before parallel_sort allocates its scratch buffer.
+            piece_records.clear();
+
+            parallel_sort(_thread_pool, records.begin(), records.end());
+            return records;
+        }
+
+        /**
+         * The most bytes per record, besides the text, which sorting and serializing a run holds at once. That is while the pieces' record
+         * vectors, which grow by doubling and so take up to 32 bytes per record, are joined into a vector of 16 bytes per record.
+         * parallel_sort's scratch buffer and serialize_run's offsets and newlines later take the pieces' place, and need less.
+         */
+        constexpr std::size_t run_bytes_per_record = 3*sizeof(std::string_view);
+
+        /**
+         * Split the input into runs whose text, serialized copy and per record bytes together take at most _max_run_bytes each.
+         * Every run holds at least one record, however long.
+         */
+        std::vector<std::string_view> split_into_runs(std::string_view _input, std::size_t _max_run_bytes)
+        {
+            std::vector<std::string_view> runs;
+            std::size_t run_begin = 0;
+            std::size_t run_bytes = 0;
+            for (std::size_t position = 0; position<_input.size();) {
+                const void* newline = std::memchr(_input.data()+position, '\n', _input.size()-position);
+                const std::size_t record_end = newline ? static_cast<std::size_t>(static_cast<const char*>(newline)-_input.data())+1 : _input.size();
+                const std::size_t record_bytes = 2*(record_end-position)+run_bytes_per_record;
+                if (run_bytes!=0 && run_bytes+record_bytes>_max_run_bytes) {
+                    runs.push_back(_input.substr(run_begin, position-run_begin));
+                    run_begin = position;
+                    run_bytes = 0;
+                }
+                run_bytes += record_bytes;
+                position = record_end;
+            }
+            if (run_begin<_input.size()) { runs.push_back(_input.substr(run_begin)); }
+            return runs;
+        }
+
+        /**
+         * Lay the sorted records of a run out in a buffer, each followed by a newline.
+         */
+        std::vector<char> serialize_run(thread_pool& _thread_pool, const std::vector<std::string_view>& _records)
+        {
+            std::vector<std::size_t> offsets(_records.size());
+            for (std::size_t i = 0; i<_records.size(); ++i) { offsets[i] = _records[i].size()+1; }
+            std::size_t total = parallel_exclusive_scan(_thread_pool, offsets.begin(), offsets.end(), offsets.begin(), std::size_t{0});
+
+            std::vector<char> buffer(total);
+            parallel_for(_thread_pool, blocked_range<std::size_t>{0, _records.size(), 4096}, [&](const blocked_range<std::size_t>& _range) {
+                for (std::size_t i = _range.begin(); i<_range.end(); ++i) {
+                    std::memcpy(buffer.data()+offsets[i], _records[i].data(), _records[i].size());
+                    buffer[offsets[i]+_records[i].size()] = '\n';
+                }
+            });
+            return buffer;
+        }
+    }
+
+    external_sort_stats external_sort(thread_pool& _thread_pool, io_executor& _io_executor, const std::string& _input_path,
+                                      const std::string& _output_path, const external_sort_options& _options)
+    {
+        const std::string temp_directory = _options.temp_directory_.empty() ?
+                std::filesystem::temp_directory_path().string() : _options.temp_directory_;
+        const std::size_t modelled_budget = std::max<std::size_t>(_options.memory_budget_, 4096)/10*modelled_budget_tenths;
+        external_sort_stats stats;
+
+        // Run generation. While a run is being spilled, the next one is sorted. A run may take two thirds of the budget, which leaves
+        // the other third for the serialized copy of the previous run, which is at most half as big.
+        std::vector<temp_file> runs;
+        {
+            mapped_file input{_input_path, mapped_file::access_pattern::sequential};
+            std::optional<spill> spilling;
+            for (std::string_view run : split_into_runs(input.view(), modelled_budget/3*2)) {
+                std::vector<std::string_view> records = sort_run(_thread_pool, run);
+                stats.num_records_ += records.size();
+                std::vector<char> buffer = serialize_run(_thread_pool, records);
+                input.release(run);
+
+                if (spilling) { runs.push_back(spilling->finish()); }
+                spilling.emplace(_thread_pool, _io_executor, temp_directory, std::move(buffer), _options.write_block_size_);
+            }
+            if (spilling) { runs.push_back(spilling->finish()); }
+        }
+        stats.num_runs_ = runs.size();
+
+        // Every run being merged, and the output, needs two buffers, and merge_bytes_per_run for its reader and pending read.
+        const std::size_t min_read_ahead = std::max<std::size_t>(_options.min_read_ahead_, 4096);
+        const std::size_t max_fan_in = std::max<std::size_t>(modelled_budget/(2*min_read_ahead+merge_bytes_per_run)-1, 2);
+        auto block_size_for = [modelled_budget, min_read_ahead](std::size_t _fan_in) {
+            return std::max((modelled_budget/(_fan_in+1)-std::min(modelled_budget/(_fan_in+1), merge_bytes_per_run))/2, min_read_ahead);
+        };
+
+        // Intermediate merge passes.
+        while (runs.size()>max_fan_in) {
+            std::vector<temp_file> merged_runs;
+            for (std::size_t first = 0; first<runs.size(); first += max_fan_in) {
+                std::size_t last = std::min(first+max_fan_in, runs.size());
+                temp_file merged{temp_directory};
+                merged.set_size(merge_runs(_thread_pool, _io_executor, runs, first, last, merged.fd(), block_size_for(last-first)));
+                merged_runs.push_back(std::move(merged));
+            }
+            runs = std::move(merged_runs);
+            ++stats.num_merge_passes_;
+        }
+
+        // Final merge into the output.
+        int output_fd = ::open(_output_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (output_fd<0) { throw std::system_error(errno, std::generic_category(), "open " + _output_path); }
+        try {
+            if (!runs.empty()) {
+                merge_runs(_thread_pool, _io_executor, runs, 0, runs.size(), output_fd, block_size_for(runs.size()));
+                if (runs.size()>1) { ++stats.num_merge_passes_; }
+            }
+        }
+        catch (...) {
+            ::close(output_fd);
+            throw;
+        }
+        ::close(output_fd);
+
+        return stats;
+    }
+}
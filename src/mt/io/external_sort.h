@@ -0,0 +1,62 @@
+#pragma once
+
+#include "io_executor.h"
+
+#include <string>
+
+namespace mkr {
+    /**
+     * Options of mkr::external_sort.
+     */
+    struct external_sort_options {
+        /**
+         * The most bytes of memory to use, counting the mapped text of the input being sorted.
+         * A tenth of it is kept as headroom for bookkeeping, such as the thread pool's tasks, and the rest is what runs and buffers are
+         * sized from. Each run is sized so that its text, its sorted copy and 48 bytes per record take at most two thirds of that, and the
+         * previous run's sorted copy, which is still being written, at most the other third. A record longer than a third of it is a run
+         * of its own, which exceeds it. When merging, it is split between two read-ahead buffers per run and two output buffers.
+         */
+        std::size_t memory_budget_ = std::size_t{1} << 30;
+        /// The directory to spill the sorted runs to. If empty, the system temporary directory is used.
+        std::string temp_directory_;
+        /// The smallest read-ahead buffer of a run during a merge. If merging every run at once would need smaller buffers, the runs are merged in several passes.
+        std::size_t min_read_ahead_ = 256*1024;
+        /// The size of each write when spilling a run.
+        std::size_t write_block_size_ = 8*1024*1024;
+    };
+
+    /**
+     * Statistics of a call to mkr::external_sort.
+     */
+    struct external_sort_stats {
+        /// The number of records sorted.
+        std::size_t num_records_ = 0;
+        /// The number of sorted runs spilled to disk.
+        std::size_t num_runs_ = 0;
+        /// The number of merge passes. 0 if the input fit in a single run.
+        std::size_t num_merge_passes_ = 0;
+    };
+
+    /**
+     * Sort the newline-delimited records of a file that may be larger than memory, in byte order (like LC_ALL=C sort).
+     *
+     * 1. Run generation: The input is memory mapped and split into runs that fit in the memory budget. The records of each run are
+     *    found and sorted in parallel on the thread pool, and the sorted run is spilled to a temporary file with asynchronous writes,
+     *    while the next run is being sorted.
+     * 2. Merge: The runs are merged with a loser tree. Every run is read through a double buffer, so the next block of a run is
+     *    already being read while the current one is consumed, and the output is written asynchronously in the same way.
+     *    If there are too many runs to give each a read-ahead buffer of at least min_read_ahead_, they are merged in several passes.
+     *
+     * Every output record ends with a newline, even if the last input record did not.
+     *
+     * @param _thread_pool The thread pool to sort on.
+     * @param _io_executor The I/O executor used to spill and read back the runs. It must deliver continuations to _thread_pool.
+     * @param _input_path The path of the input file.
+     * @param _output_path The path of the output file. It is created or truncated. It must not be the input file.
+     * @param _options The options.
+     * @return Statistics of the sort.
+     * @throws std::system_error If a file cannot be opened, read or written.
+     */
+    external_sort_stats external_sort(thread_pool& _thread_pool, io_executor& _io_executor, const std::string& _input_path,
+                                      const std::string& _output_path, const external_sort_options& _options = {});
+}
@@ -0,0 +1,451 @@
+#include "io_executor.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <semaphore>
+#include <system_error>
+#include <unordered_set>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define MKR_HAS_IO_URING 1
+#else
+#define MKR_HAS_IO_URING 0
+#endif
+
+namespace mkr {
+    /**
+     * Interface of the I/O backends.
+     */
+    class io_executor::backend {
+    public:
+        backend() = default;
+        virtual ~backend() = default;
+        virtual void submit(std::unique_ptr<io_request> _request) = 0;
+        virtual bool is_io_uring() const = 0;
+    };
+
+#if MKR_HAS_IO_URING
+    /**
+     * io_uring backend. Requests are written directly into the submission ring, and a single reaper thread waits on the completion ring.
+     * The system calls are used directly, so that there is no dependency on liburing.
+     */
+    class io_executor::uring_backend : public io_executor::backend {
+    private:
+        /// Linux limits a single read or write to this many bytes.
+        static constexpr std::size_t max_transfer_size = 0x7ffff000;
+        /// The longest wait before retrying a submission which the kernel could not accept yet.
+        static constexpr std::chrono::microseconds max_backoff{1000};
+
+        io_executor& owner_;
+        int ring_fd_;
+
+        void* sq_ring_;
+        std::size_t sq_ring_size_;
+        void* cq_ring_;
+        std::size_t cq_ring_size_;
+        io_uring_sqe* sqes_;
+        std::size_t sqes_size_;
+
+        unsigned* sq_head_;
+        unsigned* sq_tail_;
+        unsigned* sq_mask_;
+        unsigned* sq_array_;
+        unsigned* cq_head_;
+        unsigned* cq_tail_;
+        unsigned* cq_mask_;
+        io_uring_cqe* cqes_;
+
+        /// Serialises writers of the submission ring, and guards outstanding_ and ring_error_.
+        std::mutex submit_mutex_;
+        /// The requests submitted to the kernel which have not been reaped yet, so that they can be failed if the ring breaks.
+        std::unordered_set<io_request*> outstanding_;
+        /// The error which made the reaper thread give up on the ring, or 0. Once it is set, requests fail at once.
+        int ring_error_;
+        /// An eventfd which the ring polls from the start, so that writing to it wakes the reaper thread up without a submission.
+        int wake_fd_;
+        /// Limits the requests in flight, so that the completion ring can never overflow.
+        std::counting_semaphore<> slots_;
+        /// The number of requests in flight.
+        std::atomic_size_t in_flight_;
+        /// A flag to signal the reaper thread to stop once there are no requests in flight.
+        std::atomic_bool end_flag_;
+        /// The thread reaping the completion ring.
+        std::thread reaper_thread_;
+
+        static int io_uring_setup(unsigned _entries, io_uring_params* _params)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_setup, _entries, _params));
+        }
+
+        static int io_uring_enter(int _fd, unsigned _to_submit, unsigned _min_complete, unsigned _flags)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_enter, _fd, _to_submit, _min_complete, _flags, nullptr, 0));
+        }
+
+        static int io_uring_register(int _fd, unsigned _opcode, void* _arg, unsigned _num_args)
+        {
+            return static_cast<int>(::syscall(__NR_io_uring_register, _fd, _opcode, _arg, _num_args));
+        }
+
+        /**
+         * Checks that the kernel supports IORING_OP_READ, IORING_OP_WRITE (Linux 5.6) and IORING_OP_POLL_ADD.
+         * @return Returns true if both are supported.
+         */
+        bool probe_operations() const
+        {
+            constexpr unsigned num_ops = 256;
+            std::vector<unsigned char> storage(sizeof(io_uring_probe)+num_ops*sizeof(io_uring_probe_op), 0);
+            io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+            if (io_uring_register(ring_fd_, IORING_REGISTER_PROBE, probe, num_ops)<0) { return false; }
+
+            auto supported = [probe](unsigned _op) {
+                return _op<=probe->last_op && (probe->ops[_op].flags & IO_URING_OP_SUPPORTED);
+            };
+            return supported(IORING_OP_READ) && supported(IORING_OP_WRITE) && supported(IORING_OP_POLL_ADD);
+        }
+
+        void release_ring()
+        {
+            if (sqes_) { ::munmap(sqes_, sqes_size_); }
+            if (cq_ring_ && cq_ring_!=sq_ring_) { ::munmap(cq_ring_, cq_ring_size_); }
+            if (sq_ring_) { ::munmap(sq_ring_, sq_ring_size_); }
+            if (wake_fd_>=0) { ::close(wake_fd_); }
+            ::close(ring_fd_);
+        }
+
+        /**
+         * Write a submission queue entry and submit it to the kernel.
+         * @param _opcode The operation.
+         * @param _request The request, or nullptr for a wake-up: a no-op, or a poll of wake_fd_.
+         * @return 0 if the entry was submitted. Else, the negated errno value of the failure, in which case the entry was withdrawn.
+         */
+        int push_sqe(unsigned char _opcode, io_request* _request)
+        {
+            std::lock_guard<std::mutex> lock(submit_mutex_);
+            if (ring_error_!=0) { return -ring_error_; }
+            if (_request) {
+                try { outstanding_.insert(_request); }
+                catch (const std::bad_alloc&) { return -ENOMEM; }
+            }
+
+            // The kernel consumes every entry during io_uring_enter, so the submission ring is never full here.
+            const unsigned tail = std::atomic_ref<unsigned>{*sq_tail_}.load(std::memory_order_relaxed);
+            const unsigned index = tail & *sq_mask_;
+            io_uring_sqe& sqe = sqes_[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = _opcode;
+            sqe.fd = _request ? _request->fd_ : -1;
+            if (_opcode==IORING_OP_POLL_ADD) {
+                sqe.fd = wake_fd_;
+                sqe.poll32_events = POLLIN;
+            }
+            if (_request) {
+                sqe.addr = reinterpret_cast<std::uint64_t>(_request->buffer_);
+                sqe.len = static_cast<std::uint32_t>(std::min(_request->size_, max_transfer_size));
+                sqe.off = _request->offset_;
+            }
+            sqe.user_data = reinterpret_cast<std::uint64_t>(_request);
+            sq_array_[index] = index;
+            std::atomic_ref<unsigned>{*sq_tail_}.store(tail+1, std::memory_order_release);
+
+            // EAGAIN and EBUSY mean that the kernel is short of resources, or that completions must be reaped first, which the reaper
+            // thread is doing, so back off before retrying rather than spinning.
+            std::chrono::microseconds backoff{1};
+            while (io_uring_enter(ring_fd_, 1, 0, 0)<0) {
+                if (errno==EINTR) { continue; }
+                if (errno==EAGAIN || errno==EBUSY) {
+                    std::this_thread::sleep_for(backoff);
+                    backoff = std::min(backoff*2, max_backoff);
+                    continue;
+                }
+                // A failed io_uring_enter consumes no entry, so withdraw it, or a later call would submit it.
+                const int error = errno;
+                std::atomic_ref<unsigned>{*sq_tail_}.store(tail, std::memory_order_release);
+                if (_request) { outstanding_.erase(_request); }
+                return -error;
+            }
+            return 0;
+        }
+
+        /**
+         * Complete a request and free its slot.
+         * @param _request The request, with its result set.
+         */
+        void complete(std::unique_ptr<io_request> _request)
+        {
+            owner_.do_complete(std::move(_request));
+            slots_.release();
+            --in_flight_;
+        }
+
+        /**
+         * Complete the requests in the completion ring.
+         */
+        void reap_completions()
+        {
+            unsigned head = std::atomic_ref<unsigned>{*cq_head_}.load(std::memory_order_relaxed);
+            const unsigned tail = std::atomic_ref<unsigned>{*cq_tail_}.load(std::memory_order_acquire);
+            if (head==tail) { return; }
+            {
+                std::lock_guard<std::mutex> lock(submit_mutex_);
+                for (unsigned i = head; i!=tail; ++i) { outstanding_.erase(reinterpret_cast<io_request*>(cqes_[i & *cq_mask_].user_data)); }
+            }
+            for (; head!=tail; ++head) {
+                const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+                // A user_data of 0 is a wake-up from the destructor.
+                if (cqe.user_data==0) { continue; }
+
+                std::unique_ptr<io_request> request{reinterpret_cast<io_request*>(cqe.user_data)};
+                request->result_ = cqe.res;
+                complete(std::move(request));
+            }
+            std::atomic_ref<unsigned>{*cq_head_}.store(head, std::memory_order_release);
+        }
+
+        /**
+         * Reaper thread function.
+         */
+        void reaper_thread_func()
+        {
+            while (true) {
+                const int error = io_uring_enter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS)<0 && errno!=EINTR && errno!=EAGAIN ? errno : 0;
+                reap_completions();
+
+                if (error!=0) {
+                    // The ring cannot be waited on any more, so fail the requests still in it, and every later request, with the error,
+                    // rather than leaving their continuations, and the destructor, waiting forever.
+                    std::unordered_set<io_request*> outstanding;
+                    {
+                        std::lock_guard<std::mutex> lock(submit_mutex_);
+                        ring_error_ = error;
+                        outstanding.swap(outstanding_);
+                    }
+                    for (io_request* request : outstanding) {
+                        request->result_ = -error;
+                        complete(std::unique_ptr<io_request>{request});
+                    }
+                    return;
+                }
+                if (end_flag_.load() && in_flight_.load()==0) { return; }
+            }
+        }
+
+    public:
+        /**
+         * Sets up the rings and starts the reaper thread.
+         * @throws std::system_error If io_uring is not available.
+         */
+        uring_backend(io_executor& _owner, unsigned _queue_depth)
+                :owner_{_owner}, ring_fd_{-1}, sq_ring_{nullptr}, sq_ring_size_{0}, cq_ring_{nullptr}, cq_ring_size_{0},
+                 sqes_{nullptr}, sqes_size_{0}, ring_error_{0}, wake_fd_{-1}, slots_{std::max<unsigned>(_queue_depth, 1)}, in_flight_{0},
+                 end_flag_{false}
+        {
+            io_uring_params params{};
+            ring_fd_ = io_uring_setup(std::max<unsigned>(_queue_depth, 1), &params);
+            if (ring_fd_<0) { throw std::system_error(errno, std::generic_category(), "io_uring_setup"); }
+
+            // The kernel may round the number of entries up, and the completion ring is at least as large as the submission ring.
+            sq_ring_size_ = params.sq_off.array+params.sq_entries*sizeof(unsigned);
+            cq_ring_size_ = params.cq_off.cqes+params.cq_entries*sizeof(io_uring_cqe);
+            const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (single_mmap) { sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_); }
+
+            sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+            if (sq_ring_==MAP_FAILED) { sq_ring_ = nullptr; }
+            cq_ring_ = single_mmap ? sq_ring_ :
+                    ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+            if (cq_ring_==MAP_FAILED) { cq_ring_ = nullptr; }
+            sqes_size_ = params.sq_entries*sizeof(io_uring_sqe);
+            void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+            sqes_ = sqes==MAP_FAILED ? nullptr : static_cast<io_uring_sqe*>(sqes);
+
+            if (!sq_ring_ || !cq_ring_ || !sqes_) {
+                int error = errno;
+                release_ring();
+                throw std::system_error(error, std::generic_category(), "io_uring mmap");
+            }
+            if (!probe_operations()) {
+                release_ring();
+                throw std::system_error(ENOSYS, std::generic_category(), "io_uring read/write not supported");
+            }
+
+            char* sq = static_cast<char*>(sq_ring_);
+            char* cq = static_cast<char*>(cq_ring_);
+            sq_head_ = reinterpret_cast<unsigned*>(sq+params.sq_off.head);
+            sq_tail_ = reinterpret_cast<unsigned*>(sq+params.sq_off.tail);
+            sq_mask_ = reinterpret_cast<unsigned*>(sq+params.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned*>(sq+params.sq_off.array);
+            cq_head_ = reinterpret_cast<unsigned*>(cq+params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned*>(cq+params.cq_off.tail);
+            cq_mask_ = reinterpret_cast<unsigned*>(cq+params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(cq+params.cq_off.cqes);
+
+            wake_fd_ = ::eventfd(0, EFD_CLOEXEC);
+            if (wake_fd_<0) {
+                int error = errno;
+                release_ring();
+                throw std::system_error(error, std::generic_category(), "eventfd");
+            }
+            if (const int error = push_sqe(IORING_OP_POLL_ADD, nullptr); error<0) {
+                release_ring();
+                throw std::system_error(-error, std::generic_category(), "io_uring poll");
+            }
+
+            reaper_thread_ = std::thread{&uring_backend::reaper_thread_func, this};
+        }
+
+        virtual ~uring_backend()
+        {
+            end_flag_ = true;
+            // Wake the reaper thread up, in case it is waiting with no requests in flight. If the no-op cannot be submitted, write to the
+            // eventfd the ring polls instead, which cannot fail, as its counter is far from overflowing.
+            if (push_sqe(IORING_OP_NOP, nullptr)<0) { ::eventfd_write(wake_fd_, 1); }
+            reaper_thread_.join();
+            release_ring();
+        }
+
+        virtual void submit(std::unique_ptr<io_request> _request)
+        {
+            slots_.acquire();
+            ++in_flight_;
+            io_request* request = _request.release();
+            if (const int error = push_sqe(request->write_ ? IORING_OP_WRITE : IORING_OP_READ, request); error<0) {
+                // The kernel never saw the request, so complete it with the error here, as the reaper would have.
+                std::unique_ptr<io_request> failed_request{request};
+                failed_request->result_ = error;
+                complete(std::move(failed_request));
+            }
+        }
+
+        virtual bool is_io_uring() const { return true; }
+    };
+#endif
+
+    /**
+     * Fallback backend. A small set of dedicated threads block in pread() and pwrite().
+     */
+    class io_executor::thread_backend : public io_executor::backend {
+    private:
+        io_executor& owner_;
+        /// Pending requests. A nullptr signals a thread to stop.
+        threadsafe_queue<std::unique_ptr<io_request>> requests_;
+        std::vector<std::thread> io_threads_;
+
+        /**
+         * I/O thread function.
+         */
+        void io_thread_func()
+        {
+            while (true) {
+                std::unique_ptr<io_request> request = std::move(*requests_.wait_and_pop());
+                if (!request) { return; }
+
+                ssize_t result;
+                do {
+                    result = request->write_ ?
+                            ::pwrite(request->fd_, request->buffer_, request->size_, static_cast<off_t>(request->offset_)) :
+                            ::pread(request->fd_, request->buffer_, request->size_, static_cast<off_t>(request->offset_));
+                } while (result<0 && errno==EINTR);
+                request->result_ = result<0 ? -errno : result;
+
+                owner_.do_complete(std::move(request));
+            }
+        }
+
+    public:
+        thread_backend(io_executor& _owner, size_t _num_threads)
+                :owner_{_owner}
+        {
+            for (size_t i = 0; i<std::max<size_t>(_num_threads, 1); ++i) {
+                io_threads_.emplace_back(&thread_backend::io_thread_func, this);
+            }
+        }
+
+        virtual ~thread_backend()
+        {
+            // The queue is FIFO, so every request submitted before now is handled before the threads stop.
+            for (size_t i = 0; i<io_threads_.size(); ++i) { requests_.push(nullptr); }
+            for (std::thread& io_thread : io_threads_) { io_thread.join(); }
+        }
+
+        virtual void submit(std::unique_ptr<io_request> _request)
+        {
+            requests_.push(std::move(_request));
+        }
+
+        virtual bool is_io_uring() const { return false; }
+    };
+
+    io_executor::io_executor(thread_pool& _thread_pool, size_t _num_threads, bool _use_io_uring, unsigned _queue_depth)
+            :thread_pool_{_thread_pool}
+    {
+#if MKR_HAS_IO_URING
+        if (_use_io_uring) {
+            try {
+                backend_ = std::make_unique<uring_backend>(*this, _queue_depth);
+            }
+            catch (const std::system_error&) {
+                // io_uring is not supported by the kernel, or is blocked (e.g. by seccomp in a container). Use the fallback.
+            }
+        }
+#endif
+        if (!backend_) {
+            backend_ = std::make_unique<thread_backend>(*this, _num_threads);
+        }
+    }
+
+    io_executor::~io_executor()
+    {
+        backend_.reset();
+    }
+
+    bool io_executor::uses_io_uring() const
+    {
+        return backend_->is_io_uring();
+    }
+
+    void io_executor::do_submit(std::unique_ptr<io_request> _request)
+    {
+        backend_->submit(std::move(_request));
+    }
+
+    void io_executor::do_complete(std::unique_ptr<io_request> _request)
+    {
+        std::optional<size_t> worker_index = _request->worker_index_;
+        auto continuation = [request = std::move(_request)]() { request->complete(); };
+        if (worker_index) {
+            thread_pool_.post(*worker_index, std::move(continuation));
+        }
+        else {
+            thread_pool_.post(std::move(continuation));
+        }
+    }
+
+    std::future<std::int64_t> io_executor::read(int _fd, void* _buffer, std::size_t _size, std::uint64_t _offset)
+    {
+        std::promise<std::int64_t> promise;
+        std::future<std::int64_t> result = promise.get_future();
+        async_read(_fd, _buffer, _size, _offset, [promise = std::move(promise)](std::int64_t _result) mutable {
+            promise.set_value(_result);
+        });
+        return result;
+    }
+
+    std::future<std::int64_t> io_executor::write(int _fd, const void* _buffer, std::size_t _size, std::uint64_t _offset)
+    {
+        std::promise<std::int64_t> promise;
+        std::future<std::int64_t> result = promise.get_future();
+        async_write(_fd, _buffer, _size, _offset, [promise = std::move(promise)](std::int64_t _result) mutable {
+            promise.set_value(_result);
+        });
+        return result;
+    }
+}
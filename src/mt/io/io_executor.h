@@ -0,0 +1,160 @@
+#pragma once
+
+#include "../thread_pool/thread_pool.h"
+
+#include <cstdint>
+
+namespace mkr {
+    /**
+     * An executor for positional file reads and writes. The I/O is performed away from the thread pool, so that workers are never
+     * blocked in read() or write(), and each completion is delivered as a continuation task to the thread pool.
+     * If the I/O was requested from a worker thread, the continuation is pushed to that worker's local task queue, where the
+     * buffers it uses are most likely to still be in the cache.
+     *
+     * Two backends are available:
+     * - io_uring, used when the kernel supports it. A single thread reaps the completions.
+     * - A fallback of a small set of dedicated threads that block in pread() and pwrite().
+     *
+     * The io_executor must be destroyed before the thread pool. Destroying the io_executor waits for all requests to complete
+     * and their continuations to be submitted to the thread pool.
+     */
+    class io_executor {
+    private:
+        /**
+         * A pending read or write.
+         */
+        struct io_request {
+            /// The file descriptor.
+            int fd_ = -1;
+            /// The buffer to read into or write from.
+            void* buffer_ = nullptr;
+            /// The number of bytes to read or write.
+            std::size_t size_ = 0;
+            /// The offset in the file.
+            std::uint64_t offset_ = 0;
+            /// True for a write, false for a read.
+            bool write_ = false;
+            /// The worker thread which made the request, if any.
+            std::optional<size_t> worker_index_;
+            /// The number of bytes transferred, or a negated errno value.
+            std::int64_t result_ = 0;
+
+            virtual ~io_request() = default;
+            /// Invoke the continuation with the result.
+            virtual void complete() = 0;
+        };
+
+        template<typename Callback>
+        struct templated_request : public io_request {
+            Callback callback_;
+
+            template<typename F>
+            explicit templated_request(F&& _callback)
+                    :callback_(std::forward<F>(_callback)) { }
+            virtual void complete() { std::invoke(callback_, result_); }
+        };
+
+        class backend;
+        class uring_backend;
+        class thread_backend;
+
+        /// The thread pool that continuations are delivered to.
+        thread_pool& thread_pool_;
+        /// The backend performing the I/O.
+        std::unique_ptr<backend> backend_;
+
+        /**
+         * Hand a request to the backend.
+         * @param _request The request.
+         */
+        void do_submit(std::unique_ptr<io_request> _request);
+
+        /**
+         * Submit the continuation of a completed request to the thread pool. Called by the backend.
+         * @param _request The completed request.
+         */
+        void do_complete(std::unique_ptr<io_request> _request);
+
+        template<typename Callback>
+        void do_async_io(bool _write, int _fd, void* _buffer, std::size_t _size, std::uint64_t _offset, Callback&& _callback)
+        {
+            auto request = std::make_unique<templated_request<std::decay_t<Callback>>>(std::forward<Callback>(_callback));
+            request->fd_ = _fd;
+            request->buffer_ = _buffer;
+            request->size_ = _size;
+            request->offset_ = _offset;
+            request->write_ = _write;
+            request->worker_index_ = thread_pool_.worker_index();
+            do_submit(std::move(request));
+        }
+
+    public:
+        /**
+         * Constructs the I/O executor.
+         * @param _thread_pool The thread pool that continuations are delivered to.
+         * @param _num_threads The number of blocking threads used by the fallback backend. Must be 1 or greater.
+         * @param _use_io_uring If true, io_uring is used when the kernel supports it. If false, the fallback backend is always used.
+         * @param _queue_depth The maximum number of requests in flight in io_uring at once. Further requests wait for a free slot.
+         */
+        io_executor(thread_pool& _thread_pool, size_t _num_threads = 2, bool _use_io_uring = true, unsigned _queue_depth = 256);
+
+        /**
+         * Destructs the I/O executor after waiting for all requests to complete.
+         */
+        ~io_executor();
+
+        io_executor(const io_executor&) = delete;
+        io_executor(io_executor&&) = delete;
+        io_executor& operator=(const io_executor&) = delete;
+        io_executor& operator=(io_executor&&) = delete;
+
+        /**
+         * @return Returns true if io_uring is used, false if the fallback backend is used.
+         */
+        bool uses_io_uring() const;
+
+        /**
+         * Read from a file at an offset, without changing the file offset. Like pread(), fewer bytes than requested may be read.
+         * @tparam Callback The typename of the continuation.
+         * @param _fd The file descriptor.
+         * @param _buffer The buffer to read into. It must remain valid until the continuation is invoked.
+         * @param _size The number of bytes to read.
+         * @param _offset The offset in the file.
+         * @param _callback The continuation. It is invoked on the thread pool with the number of bytes read, or a negated errno value.
+         */
+        template<typename Callback>
+        void async_read(int _fd, void* _buffer, std::size_t _size, std::uint64_t _offset, Callback&& _callback)
+            requires mkr::is_consumer<Callback, std::int64_t>
+        {
+            do_async_io(false, _fd, _buffer, _size, _offset, std::forward<Callback>(_callback));
+        }
+
+        /**
+         * Write to a file at an offset, without changing the file offset. Like pwrite(), fewer bytes than requested may be written.
+         * @tparam Callback The typename of the continuation.
+         * @param _fd The file descriptor.
+         * @param _buffer The buffer to write from. It must remain valid until the continuation is invoked.
+         * @param _size The number of bytes to write.
+         * @param _offset The offset in the file.
+         * @param _callback The continuation. It is invoked on the thread pool with the number of bytes written, or a negated errno value.
+         */
+        template<typename Callback>
+        void async_write(int _fd, const void* _buffer, std::size_t _size, std::uint64_t _offset, Callback&& _callback)
+            requires mkr::is_consumer<Callback, std::int64_t>
+        {
+            do_async_io(true, _fd, const_cast<void*>(_buffer), _size, _offset, std::forward<Callback>(_callback));
+        }
+
+        /**
+         * Read from a file at an offset. Wait on the result with thread_pool::run_pending_tasks.
+         * @return A std::future which will contain the number of bytes read, or a negated errno value.
+         */
+        std::future<std::int64_t> read(int _fd, void* _buffer, std::size_t _size, std::uint64_t _offset);
+
+        /**
+         * Write to a file at an offset. Wait on the result with thread_pool::run_pending_tasks.
+         * @return A std::future which will contain the number of bytes written, or a negated errno value.
+         */
+        std::future<std::int64_t> write(int _fd, const void* _buffer, std::size_t _size, std::uint64_t _offset);
+    };
+}
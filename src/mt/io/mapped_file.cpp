@@ -0,0 +1,66 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mkr {
+    mapped_file::mapped_file(const std::string& _path, access_pattern _access_pattern)
+            :fd_{-1}, data_{nullptr}, size_{0}
+    {
+        fd_ = ::open(_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd_<0) {
+            throw std::system_error(errno, std::generic_category(), "open " + _path);
+        }
+
+        struct stat file_stat{};
+        if (::fstat(fd_, &file_stat)!=0) {
+            int error = errno;
+            ::close(fd_);
+            throw std::system_error(error, std::generic_category(), "fstat " + _path);
+        }
+        size_ = static_cast<std::size_t>(file_stat.st_size);
+
+        // mmap does not accept a length of 0.
+        if (size_==0) { return; }
+
+        void* address = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (address==MAP_FAILED) {
+            int error = errno;
+            ::close(fd_);
+            throw std::system_error(error, std::generic_category(), "mmap " + _path);
+        }
+        data_ = static_cast<const char*>(address);
+
+        // The hints are only advice. Failing to apply them is not an error.
+        switch (_access_pattern) {
+        case access_pattern::sequential:
+            ::madvise(address, size_, MADV_SEQUENTIAL);
+            break;
+        case access_pattern::random:
+            ::madvise(address, size_, MADV_RANDOM);
+            break;
+        default:
+            break;
+        }
+        ::madvise(address, size_, MADV_WILLNEED);
+    }
+
+    mapped_file::~mapped_file()
+    {
+        if (data_) { ::munmap(const_cast<char*>(data_), size_); }
+        if (fd_>=0) { ::close(fd_); }
+    }
+
+    void mapped_file::release(std::string_view _range) const
+    {
+        const std::uintptr_t page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+        const std::uintptr_t begin = (reinterpret_cast<std::uintptr_t>(_range.data())+page_size-1) & ~(page_size-1);
+        const std::uintptr_t end = (reinterpret_cast<std::uintptr_t>(_range.data())+_range.size()) & ~(page_size-1);
+        if (begin<end) { ::madvise(reinterpret_cast<void*>(begin), end-begin, MADV_DONTNEED); }
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace mkr {
+    /**
+     * A read-only memory mapping of a whole file. The contents can be read directly from the page cache without being copied.
+     *
+     * Additional Notes:
+     * - mapped_file is non-copyable AND non-movable.
+     */
+    class mapped_file {
+    private:
+        /// The file descriptor of the mapped file.
+        int fd_;
+        /// The start of the mapping. nullptr if the file is empty.
+        const char* data_;
+        /// The size of the file in bytes.
+        std::size_t size_;
+
+    public:
+        /**
+         * Access patterns used to hint the kernel how the mapping will be read.
+         */
+        enum class access_pattern {
+            /// No hint.
+            normal,
+            /// The file is read front to back, so the kernel can read ahead aggressively and drop pages behind the reader.
+            sequential,
+            /// The file is read in no particular order, so read-ahead would be wasted.
+            random,
+        };
+
+        /**
+         * Opens and maps the file.
+         * @param _path The path of the file.
+         * @param _access_pattern The access pattern hint. The whole file is also marked as needed soon, so the kernel starts reading it in immediately.
+         * @throws std::system_error If the file cannot be opened or mapped.
+         */
+        explicit mapped_file(const std::string& _path, access_pattern _access_pattern = access_pattern::sequential);
+
+        /**
+         * Unmaps and closes the file.
+         */
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file(mapped_file&&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        mapped_file& operator=(mapped_file&&) = delete;
+
+        /**
+         * Tell the kernel that a range of the mapping will not be read again, so its pages can be dropped from this process.
+         * Only the whole pages inside the range are released. Reading the range again afterwards is still valid, but will fault the pages back in.
+         * @param _range The range to release. It must be within view().
+         */
+        void release(std::string_view _range) const;
+
+        inline const char* data() const { return data_; }
+        inline std::size_t size() const { return size_; }
+        inline std::string_view view() const { return {data_, size_}; }
+    };
+}
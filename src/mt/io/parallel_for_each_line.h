@@ -0,0 +1,91 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "../algorithm/parallel_for.h"
+
+#include <cstring>
+#include <vector>
+
+namespace mkr {
+    /**
+     * Split a buffer into chunks of roughly _chunk_size bytes. Every chunk boundary is moved forward to just after the next newline,
+     * so no newline-delimited record is split between two chunks.
+     * @param _buffer The buffer to split.
+     * @param _chunk_size The approximate size of each chunk in bytes.
+     * @return The chunks, in order. Their concatenation is the buffer.
+     */
+    inline std::vector<std::string_view> split_at_newlines(std::string_view _buffer, std::size_t _chunk_size)
+    {
+        std::vector<std::string_view> chunks;
+        _chunk_size = std::max<std::size_t>(_chunk_size, 1);
+        while (_buffer.size()>_chunk_size) {
+            std::size_t newline = _buffer.find('\n', _chunk_size);
+            if (newline==std::string_view::npos || newline+1==_buffer.size()) { break; }
+            chunks.push_back(_buffer.substr(0, newline+1));
+            _buffer.remove_prefix(newline+1);
+        }
+        if (!_buffer.empty()) { chunks.push_back(_buffer); }
+        return chunks;
+    }
+
+    /**
+     * Invoke a function on every newline-delimited record of a chunk, in order.
+     * @tparam Func The typename of the function. It is invoked with a std::string_view of every record, without the newline.
+     * @param _chunk The chunk.
+     * @param _func The function to invoke on every record.
+     */
+    template<typename Func>
+    void for_each_line(std::string_view _chunk, Func&& _func)
+        requires mkr::is_consumer<Func, std::string_view>
+    {
+        const char* record = _chunk.data();
+        const char* const chunk_end = record+_chunk.size();
+        while (record<chunk_end) {
+            const char* newline = static_cast<const char*>(std::memchr(record, '\n', static_cast<std::size_t>(chunk_end-record)));
+            // The last record of the buffer may not end with a newline.
+            const char* record_end = newline ? newline : chunk_end;
+            std::invoke(_func, std::string_view{record, static_cast<std::size_t>(record_end-record)});
+            record = record_end+1;
+        }
+    }
+
+    /**
+     * Invoke a function on every newline-delimited record of a buffer in parallel.
+     * The buffer is split into chunks with split_at_newlines, and each chunk is handed to a task which walks its records.
+     * @tparam Func The typename of the function. It is invoked with a std::string_view of every record, without the newline.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _buffer The buffer to split.
+     * @param _func The function to invoke on every record. It is invoked concurrently, and the order of the records is unspecified.
+     * @param _chunk_size The approximate size of each chunk in bytes.
+     */
+    template<executor Executor, typename Func>
+    void parallel_for_each_line_in_buffer(Executor& _executor, std::string_view _buffer, const Func& _func, std::size_t _chunk_size = 4*1024*1024)
+        requires mkr::is_consumer<const Func&, std::string_view>
+    {
+        const std::vector<std::string_view> chunks = split_at_newlines(_buffer, _chunk_size);
+        parallel_for(_executor, blocked_range<std::size_t>{0, chunks.size()}, [&](const blocked_range<std::size_t>& _chunks) {
+            for (std::size_t c = _chunks.begin(); c<_chunks.end(); ++c) { for_each_line(chunks[c], _func); }
+        });
+    }
+
+    /**
+     * Invoke a function on every newline-delimited record of a file in parallel.
+     * The file is memory mapped, so the records are std::string_views directly into the page cache and are never copied.
+     * @tparam Func The typename of the function. It is invoked with a std::string_view of every record, without the newline.
+     * @tparam Executor The typename of the executor.
+     * @param _executor The executor to run on.
+     * @param _path The path of the file.
+     * @param _func The function to invoke on every record. It is invoked concurrently, and the order of the records is unspecified.
+     *              The std::string_view is only valid for the duration of the call.
+     * @param _chunk_size The approximate size of each chunk in bytes.
+     * @throws std::system_error If the file cannot be opened or mapped.
+     */
+    template<executor Executor, typename Func>
+    void parallel_for_each_line(Executor& _executor, const std::string& _path, const Func& _func, std::size_t _chunk_size = 4*1024*1024)
+        requires mkr::is_consumer<const Func&, std::string_view>
+    {
+        mapped_file file{_path, mapped_file::access_pattern::sequential};
+        parallel_for_each_line_in_buffer(_executor, file.view(), _func, _chunk_size);
+    }
+}
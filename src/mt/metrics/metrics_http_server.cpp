@@ -0,0 +1,124 @@
+#include "metrics_http_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+#include <system_error>
+
+namespace mkr {
+    namespace {
+        /// The largest request header read. Scrapers send a few hundred bytes.
+        constexpr std::size_t max_request_size = 8192;
+
+        /**
+         * Write the whole of a buffer to a socket.
+         */
+        void send_all(int _fd, const std::string& _data)
+        {
+            std::size_t sent = 0;
+            while (sent<_data.size()) {
+                const ssize_t result = ::send(_fd, _data.data()+sent, _data.size()-sent, MSG_NOSIGNAL);
+                if (result<0 && errno==EINTR) { continue; }
+                if (result<=0) { return; }
+                sent += static_cast<std::size_t>(result);
+            }
+        }
+
+        std::string make_response(const std::string& _status, const std::string& _content_type, const std::string& _body)
+        {
+            return "HTTP/1.1 "+_status+"\r\nContent-Type: "+_content_type+"\r\nContent-Length: "+std::to_string(_body.size())+
+                   "\r\nConnection: close\r\n\r\n"+_body;
+        }
+    }
+
+    metrics_http_server::metrics_http_server(const metrics_registry& _registry, std::uint16_t _port)
+            :registry_{_registry}
+    {
+        listen_fd_ = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listen_fd_<0) { throw std::system_error(errno, std::generic_category(), "metrics_http_server socket"); }
+
+        const int reuse = 1;
+        ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(_port);
+        socklen_t address_size = sizeof(address);
+        if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), address_size)<0 ||
+                ::listen(listen_fd_, 16)<0 ||
+                ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &address_size)<0) {
+            const int error = errno;
+            ::close(listen_fd_);
+            throw std::system_error(error, std::generic_category(), "metrics_http_server bind");
+        }
+        port_ = ntohs(address.sin_port);
+
+        server_thread_ = std::thread{&metrics_http_server::server_thread_func, this};
+    }
+
+    metrics_http_server::~metrics_http_server()
+    {
+        end_flag_ = true;
+        server_thread_.join();
+        ::close(listen_fd_);
+    }
+
+    void metrics_http_server::server_thread_func()
+    {
+        while (!end_flag_.load()) {
+            // Poll with a timeout, so that the thread notices end_flag_ without another thread having to wake it up.
+            pollfd listen_poll{listen_fd_, POLLIN, 0};
+            if (::poll(&listen_poll, 1, 100)<=0) { continue; }
+
+            const int fd = ::accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd<0) { continue; }
+            serve(fd);
+            ::close(fd);
+        }
+    }
+
+    void metrics_http_server::serve(int _fd) const
+    {
+        // Read until the end of the request header. A client which stops sending is dropped, so it cannot stall the server.
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n")==std::string::npos && request.size()<max_request_size) {
+            pollfd client_poll{_fd, POLLIN, 0};
+            if (::poll(&client_poll, 1, 1000)<=0) { return; }
+            const ssize_t result = ::recv(_fd, buffer, sizeof(buffer), 0);
+            if (result<0 && errno==EINTR) { continue; }
+            if (result<=0) { return; }
+            request.append(buffer, static_cast<std::size_t>(result));
+        }
+
+        // The request line is "METHOD PATH VERSION".
+        const std::size_t method_end = request.find(' ');
+        const std::size_t path_end = method_end==std::string::npos ? std::string::npos : request.find(' ', method_end+1);
+        if (path_end==std::string::npos) {
+            send_all(_fd, make_response("400 Bad Request", "text/plain", "Bad Request\n"));
+            return;
+        }
+        const std::string method = request.substr(0, method_end);
+        std::string path = request.substr(method_end+1, path_end-method_end-1);
+        path = path.substr(0, path.find('?'));
+
+        if (method!="GET") {
+            send_all(_fd, make_response("405 Method Not Allowed", "text/plain", "Method Not Allowed\n"));
+        }
+        else if (path=="/metrics") {
+            send_all(_fd, make_response("200 OK", "text/plain; version=0.0.4; charset=utf-8", registry_.render_prometheus()));
+        }
+        else if (path=="/metrics.json") {
+            send_all(_fd, make_response("200 OK", "application/json", registry_.render_json()));
+        }
+        else {
+            send_all(_fd, make_response("404 Not Found", "text/plain", "Not Found\n"));
+        }
+    }
+}
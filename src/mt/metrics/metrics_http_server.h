@@ -0,0 +1,67 @@
+#pragma once
+
+#include "metrics_registry.h"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace mkr {
+    /**
+     * A tiny HTTP server on localhost which serves the metrics of a registry for scraping.
+     * - GET /metrics serves the Prometheus text exposition format.
+     * - GET /metrics.json serves JSON.
+     *
+     * It listens on 127.0.0.1 only, serves one request per connection on a single thread, and is meant for a scraper on the same host
+     * or a sidecar, not for the open network.
+     *
+     * Additional Notes:
+     * - The server must be destroyed before the registry.
+     * - metrics_http_server is non-copyable AND non-movable.
+     */
+    class metrics_http_server {
+    private:
+        /// The registry whose metrics are served.
+        const metrics_registry& registry_;
+        /// The listening socket.
+        int listen_fd_ = -1;
+        /// The port the server listens on.
+        std::uint16_t port_ = 0;
+        /// A flag to signal the server thread to stop.
+        std::atomic_bool end_flag_{false};
+        /// The thread which accepts and serves connections.
+        std::thread server_thread_;
+
+        /**
+         * Serve one connection.
+         * @param _fd The socket of the connection.
+         */
+        void serve(int _fd) const;
+
+        /**
+         * Server thread function.
+         */
+        void server_thread_func();
+
+    public:
+        /**
+         * Constructs the server, and starts listening.
+         * @param _registry The registry whose metrics are served.
+         * @param _port The port to listen on. If 0, the operating system picks a free port, which port() returns.
+         * @throws std::system_error If the socket cannot be created or bound.
+         */
+        explicit metrics_http_server(const metrics_registry& _registry, std::uint16_t _port = 0);
+
+        /**
+         * Destructs the server. Stops listening, and waits for the request being served, if any.
+         */
+        ~metrics_http_server();
+
+        metrics_http_server(const metrics_http_server&) = delete;
+        metrics_http_server(metrics_http_server&&) = delete;
+        metrics_http_server& operator=(const metrics_http_server&) = delete;
+        metrics_http_server& operator=(metrics_http_server&&) = delete;
+
+        inline std::uint16_t port() const { return port_; }
+    };
+}
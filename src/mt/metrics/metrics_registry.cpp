@@ -0,0 +1,183 @@
+#include "metrics_registry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace mkr {
+    namespace {
+        const char* type_name(metric_type _type)
+        {
+            switch (_type) {
+            case metric_type::counter: return "counter";
+            case metric_type::histogram: return "histogram";
+            default: return "gauge";
+            }
+        }
+
+        /**
+         * Format a value so that whole numbers, such as counters, are printed without an exponent.
+         */
+        std::string format_value(double _value)
+        {
+            if (std::isinf(_value)) { return _value>0.0 ? "+Inf" : "-Inf"; }
+            if (std::isnan(_value)) { return "NaN"; }
+            char buffer[32];
+            if (_value==std::floor(_value) && std::fabs(_value)<1e15) {
+                std::snprintf(buffer, sizeof(buffer), "%.0f", _value);
+            }
+            else {
+                std::snprintf(buffer, sizeof(buffer), "%.17g", _value);
+            }
+            return buffer;
+        }
+
+        /**
+         * Escape a string with backslashes. Both label values and JSON strings escape backslashes, quotes and newlines this way.
+         */
+        std::string escape(const std::string& _string)
+        {
+            std::string escaped;
+            escaped.reserve(_string.size());
+            for (char c : _string) {
+                switch (c) {
+                case '\\': escaped += "\\\\"; break;
+                case '"': escaped += "\\\""; break;
+                case '\n': escaped += "\\n"; break;
+                default: escaped += c; break;
+                }
+            }
+            return escaped;
+        }
+    }
+
+    void metrics_snapshot::add(const std::string& _name, const std::string& _help, metric_type _type,
+                               std::vector<std::pair<std::string, std::string>> _labels, double _value, const std::string& _suffix)
+    {
+        auto family = std::find_if(families_.begin(), families_.end(), [&](const metric_family& _family) { return _family.name_==_name; });
+        if (family==families_.end()) {
+            families_.push_back(metric_family{_name, _help, _type, {}});
+            family = std::prev(families_.end());
+        }
+        family->samples_.push_back(metric_sample{_suffix, std::move(_labels), _value});
+    }
+
+    std::string metrics_snapshot::render_prometheus() const
+    {
+        std::string text;
+        for (const metric_family& family : families_) {
+            text += "# HELP "+family.name_+" "+family.help_+"\n";
+            text += "# TYPE "+family.name_+" "+type_name(family.type_)+"\n";
+            for (const metric_sample& sample : family.samples_) {
+                text += family.name_+sample.suffix_;
+                if (!sample.labels_.empty()) {
+                    text += "{";
+                    for (size_t i = 0; i<sample.labels_.size(); ++i) {
+                        if (i!=0) { text += ","; }
+                        text += sample.labels_[i].first+"=\""+escape(sample.labels_[i].second)+"\"";
+                    }
+                    text += "}";
+                }
+                text += " "+format_value(sample.value_)+"\n";
+            }
+        }
+        return text;
+    }
+
+    std::string metrics_snapshot::render_json() const
+    {
+        std::string json = "{\"metrics\":[";
+        for (size_t f = 0; f<families_.size(); ++f) {
+            const metric_family& family = families_[f];
+            if (f!=0) { json += ","; }
+            json += "{\"name\":\""+escape(family.name_)+"\",\"help\":\""+escape(family.help_)+"\",\"type\":\""+type_name(family.type_)+"\",\"samples\":[";
+            for (size_t s = 0; s<family.samples_.size(); ++s) {
+                const metric_sample& sample = family.samples_[s];
+                if (s!=0) { json += ","; }
+                json += "{\"name\":\""+escape(family.name_+sample.suffix_)+"\",\"labels\":{";
+                for (size_t i = 0; i<sample.labels_.size(); ++i) {
+                    if (i!=0) { json += ","; }
+                    json += "\""+escape(sample.labels_[i].first)+"\":\""+escape(sample.labels_[i].second)+"\"";
+                }
+                // JSON has no infinity, and the values of these metrics are always finite.
+                json += "},\"value\":"+format_value(sample.value_)+"}";
+            }
+            json += "]}";
+        }
+        json += "]}";
+        return json;
+    }
+
+    void metrics_registry::add(const std::string& _name, collector _collector)
+    {
+        std::lock_guard lock{mutex_};
+        sources_.emplace_back(_name, std::move(_collector));
+    }
+
+    void metrics_registry::add_thread_pool(const std::string& _name, const thread_pool& _thread_pool)
+    {
+        add(_name, [&_thread_pool](metrics_snapshot& _snapshot, const std::string& _source) {
+            const thread_pool_stats stats = _thread_pool.get_stats();
+
+            _snapshot.add("mkr_thread_pool_threads", "The number of worker threads.", metric_type::gauge,
+                          {{"pool", _source}}, static_cast<double>(stats.num_threads_));
+
+            const char* queue_depth_help = "The number of tasks waiting in a queue.";
+            _snapshot.add("mkr_thread_pool_queue_depth", queue_depth_help, metric_type::gauge,
+                          {{"pool", _source}, {"queue", "global"}}, static_cast<double>(stats.global_queue_depth_));
+            _snapshot.add("mkr_thread_pool_queue_depth", queue_depth_help, metric_type::gauge,
+                          {{"pool", _source}, {"queue", "operations"}}, static_cast<double>(stats.num_operations_));
+            _snapshot.add("mkr_thread_pool_queue_depth", queue_depth_help, metric_type::gauge,
+                          {{"pool", _source}, {"queue", "arenas"}}, static_cast<double>(stats.arena_queue_depth_));
+            for (size_t i = 0; i<stats.local_queue_depths_.size(); ++i) {
+                _snapshot.add("mkr_thread_pool_queue_depth", queue_depth_help, metric_type::gauge,
+                              {{"pool", _source}, {"queue", "local"}, {"worker", std::to_string(i)}}, static_cast<double>(stats.local_queue_depths_[i]));
+            }
+
+            _snapshot.add("mkr_thread_pool_tasks_run_total", "The number of tasks run.", metric_type::counter,
+                          {{"pool", _source}}, static_cast<double>(stats.num_tasks_run_));
+            for (const task_tag_stats& tag_stats : _thread_pool.get_tag_stats()) {
+                const std::vector<std::pair<std::string, std::string>> labels{{"pool", _source}, {"tag", tag_stats.tag_.name()}};
+                _snapshot.add("mkr_thread_pool_tag_tasks_total", "The number of tasks run per task tag.", metric_type::counter,
+                              labels, static_cast<double>(tag_stats.num_tasks_));
+                _snapshot.add("mkr_thread_pool_tag_wall_seconds_total", "The wall time of the tasks per task tag.", metric_type::counter,
+                              labels, std::chrono::duration<double>(tag_stats.wall_time_).count());
+                _snapshot.add("mkr_thread_pool_tag_cpu_seconds_total", "The thread CPU time of the tasks per task tag.", metric_type::counter,
+                              labels, std::chrono::duration<double>(tag_stats.cpu_time_).count());
+            }
+            _snapshot.add("mkr_thread_pool_tasks_stolen_total", "The number of tasks taken from another worker's local task queue.",
+                          metric_type::counter, {{"pool", _source}}, static_cast<double>(stats.num_tasks_stolen_));
+            _snapshot.add("mkr_thread_pool_idle_ratio", "The fraction of the worker threads' time spent idle.", metric_type::gauge,
+                          {{"pool", _source}}, stats.idle_fraction_);
+
+            // Prometheus histogram buckets are cumulative.
+            const char* latency_help = "The time tasks waited in a queue before they started.";
+            uint64_t cumulative = 0;
+            for (size_t b = 0; b<stats.latency_buckets_.size(); ++b) {
+                cumulative += stats.latency_buckets_[b];
+                _snapshot.add("mkr_thread_pool_task_latency_seconds", latency_help, metric_type::histogram,
+                              {{"pool", _source}, {"le", format_value(thread_pool_stats::latency_bucket_bound(b))}},
+                              static_cast<double>(cumulative), "_bucket");
+            }
+            _snapshot.add("mkr_thread_pool_task_latency_seconds", latency_help, metric_type::histogram,
+                          {{"pool", _source}}, stats.latency_sum_, "_sum");
+            _snapshot.add("mkr_thread_pool_task_latency_seconds", latency_help, metric_type::histogram,
+                          {{"pool", _source}}, static_cast<double>(stats.latency_count_), "_count");
+        });
+    }
+
+    void metrics_registry::remove(const std::string& _name)
+    {
+        std::lock_guard lock{mutex_};
+        std::erase_if(sources_, [&](const std::pair<std::string, collector>& _source) { return _source.first==_name; });
+    }
+
+    metrics_snapshot metrics_registry::collect() const
+    {
+        // The collectors run under the lock, so that a source which has been removed is never read.
+        metrics_snapshot snapshot;
+        std::lock_guard lock{mutex_};
+        for (const auto& [name, source_collector] : sources_) { source_collector(snapshot, name); }
+        return snapshot;
+    }
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "../thread_pool/thread_pool.h"
+
+#include <concepts>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace mkr {
+    /**
+     * The type of a metric, as in the Prometheus exposition format.
+     */
+    enum class metric_type {
+        counter,
+        gauge,
+        histogram,
+    };
+
+    /**
+     * A sample of a metric.
+     */
+    struct metric_sample {
+        /// The suffix appended to the name of the metric, such as "_bucket" for a histogram bucket. Empty for most metrics.
+        std::string suffix_;
+        /// The labels of the sample, as name-value pairs.
+        std::vector<std::pair<std::string, std::string>> labels_;
+        /// The value of the sample.
+        double value_ = 0.0;
+    };
+
+    /**
+     * A metric and its samples.
+     */
+    struct metric_family {
+        /// The name of the metric.
+        std::string name_;
+        /// A description of the metric.
+        std::string help_;
+        /// The type of the metric.
+        metric_type type_ = metric_type::gauge;
+        /// The samples of the metric.
+        std::vector<metric_sample> samples_;
+    };
+
+    /**
+     * The metrics collected from the sources of a mkr::metrics_registry at one point in time.
+     */
+    class metrics_snapshot {
+    private:
+        /// The metrics, in the order they were first added.
+        std::vector<metric_family> families_;
+
+    public:
+        /**
+         * Add a sample. Samples of the same metric from different sources are grouped together.
+         * @param _name The name of the metric.
+         * @param _help A description of the metric.
+         * @param _type The type of the metric.
+         * @param _labels The labels of the sample.
+         * @param _value The value of the sample.
+         * @param _suffix The suffix appended to the name of the metric for this sample.
+         */
+        void add(const std::string& _name, const std::string& _help, metric_type _type,
+                 std::vector<std::pair<std::string, std::string>> _labels, double _value, const std::string& _suffix = "");
+
+        inline const std::vector<metric_family>& families() const { return families_; }
+
+        /**
+         * @return The metrics in the Prometheus text exposition format, version 0.0.4.
+         */
+        std::string render_prometheus() const;
+
+        /**
+         * @return The metrics as a JSON document of the form {"metrics":[{"name", "help", "type", "samples":[{"name", "labels", "value"}]}]}.
+         */
+        std::string render_json() const;
+    };
+
+    /**
+     * A container which reports its size and lock contention, such as mkr::threadsafe_queue or mkr::threadsafe_hashtable.
+     */
+    template<typename C>
+    concept contention_reporting_container = requires(const C& _container) {
+        { _container.size() } -> std::convertible_to<std::size_t>;
+        { _container.num_contentions() } -> std::convertible_to<std::size_t>;
+    };
+
+    /**
+     * A registry of metric sources, such as thread pools and containers, which renders their metrics for dashboards.
+     *
+     * Collecting only reads the sources' counters, which are written by the workers with relaxed atomics on their own cache lines,
+     * so the workers are never stopped or slowed down by a scrape.
+     *
+     * Additional Notes:
+     * - The registry keeps references to the sources. A source must be removed before it is destroyed.
+     * - metrics_registry is non-copyable AND non-movable.
+     */
+    class metrics_registry {
+    public:
+        /// A function which adds the metrics of a source to a snapshot. It is invoked with the snapshot and the name of the source.
+        typedef std::function<void(metrics_snapshot&, const std::string&)> collector;
+
+    private:
+        /// Protects sources_.
+        mutable std::mutex mutex_;
+        /// The name and collector of each source.
+        std::vector<std::pair<std::string, collector>> sources_;
+
+    public:
+        metrics_registry() = default;
+        metrics_registry(const metrics_registry&) = delete;
+        metrics_registry(metrics_registry&&) = delete;
+        metrics_registry& operator=(const metrics_registry&) = delete;
+        metrics_registry& operator=(metrics_registry&&) = delete;
+
+        /**
+         * Add a source of metrics.
+         * @param _name The name of the source. It labels the source's samples.
+         * @param _collector The function which adds the source's metrics to a snapshot.
+         */
+        void add(const std::string& _name, collector _collector);
+
+        /**
+         * Add a thread pool's queue depths, task counts, steals, idle fraction, task latency histogram and per-tag times, labelled pool="_name".
+         * @param _name The name of the thread pool.
+         * @param _thread_pool The thread pool.
+         */
+        void add_thread_pool(const std::string& _name, const thread_pool& _thread_pool);
+
+        /**
+         * Add a container's size and lock contention counter, labelled container="_name".
+         * @tparam C The typename of the container.
+         * @param _name The name of the container.
+         * @param _container The container.
+         */
+        template<contention_reporting_container C>
+        void add_container(const std::string& _name, const C& _container)
+        {
+            add(_name, [&_container](metrics_snapshot& _snapshot, const std::string& _source) {
+                _snapshot.add("mkr_container_size", "The number of elements in the container.", metric_type::gauge,
+                              {{"container", _source}}, static_cast<double>(_container.size()));
+                _snapshot.add("mkr_container_contentions_total", "The number of times a thread waited for a lock of the container.",
+                              metric_type::counter, {{"container", _source}}, static_cast<double>(_container.num_contentions()));
+            });
+        }
+
+        /**
+         * Remove a source of metrics.
+         * @param _name The name of the source.
+         */
+        void remove(const std::string& _name);
+
+        /**
+         * Collect the metrics of every source.
+         * @return The metrics.
+         */
+        metrics_snapshot collect() const;
+
+        /**
+         * @return The metrics of every source in the Prometheus text exposition format.
+         */
+        std::string render_prometheus() const { return collect().render_prometheus(); }
+
+        /**
+         * @return The metrics of every source as JSON.
+         */
+        std::string render_json() const { return collect().render_json(); }
+    };
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../util/tracepoints.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace mkr {
+    /**
+     * A mutex which counts how often a thread had to wait for it. It first tries to lock the underlying mutex, and only counts and
+     * blocks if that fails, so an uncontended lock costs the same as before, and the counter is only written under contention.
+     * It can be used with std::lock_guard, std::unique_lock, std::shared_lock and std::condition_variable_any.
+     * @tparam Mutex The typename of the underlying mutex.
+     */
+    template<typename Mutex>
+    class contention_counting_mutex {
+    private:
+        /// The underlying mutex.
+        Mutex mutex_;
+        /// The number of times a lock had to wait.
+        std::atomic_size_t num_contentions_{0};
+
+    public:
+        contention_counting_mutex() = default;
+        contention_counting_mutex(const contention_counting_mutex&) = delete;
+        contention_counting_mutex& operator=(const contention_counting_mutex&) = delete;
+
+        /**
+         * @return The number of times a lock had to wait for another thread to unlock.
+         */
+        inline std::size_t num_contentions() const { return num_contentions_.load(std::memory_order_relaxed); }
+
+        void lock()
+        {
+            if (!mutex_.try_lock()) {
+                num_contentions_.fetch_add(1, std::memory_order_relaxed);
+                MKR_TRACE(lock_contended, this);
+                mutex_.lock();
+                MKR_TRACE(lock_acquired, this);
+            }
+        }
+
+        bool try_lock() { return mutex_.try_lock(); }
+        void unlock() { mutex_.unlock(); }
+
+        void lock_shared() requires requires(Mutex _mutex) { _mutex.lock_shared(); }
+        {
+            if (!mutex_.try_lock_shared()) {
+                num_contentions_.fetch_add(1, std::memory_order_relaxed);
+                MKR_TRACE(lock_contended, this);
+                mutex_.lock_shared();
+                MKR_TRACE(lock_acquired, this);
+            }
+        }
+
+        bool try_lock_shared() requires requires(Mutex _mutex) { _mutex.try_lock_shared(); } { return mutex_.try_lock_shared(); }
+        void unlock_shared() requires requires(Mutex _mutex) { _mutex.unlock_shared(); } { mutex_.unlock_shared(); }
+    };
+}
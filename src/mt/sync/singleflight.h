@@ -0,0 +1,144 @@
+#pragma once
+
+#include "../container/threadsafe_hashtable.h"
+#include "../executor/inline_executor.h"
+#include "../thread_pool/thread_pool.h"
+
+namespace mkr {
+    /**
+     * Coalesces concurrent computations of the same key. The first caller for a key computes the value, and every caller that arrives
+     * while that computation is in flight waits for its result instead of computing the value again.
+     * Once the computation finishes, the key is forgotten, so a later caller computes a fresh value.
+     *
+     * This prevents a thundering herd when a popular cache entry expires:
+     * @code
+     * std::shared_ptr<V> value = cache.get(key);
+     * if (!value) {
+     *     value = std::const_pointer_cast<V>(flight.call(pool, key, [&]() {
+     *         V v = compute(key);
+     *         cache.insert_or_replace(key, v);
+     *         return v;
+     *     }));
+     * }
+     * @endcode
+     *
+     * If the computation throws, the exception is rethrown to the caller that computed it and to every caller waiting for it.
+     *
+     * The supplier must not call the singleflight with the key it is computing, directly or through a task it waits for. That call
+     * would wait for the computation it is part of, and deadlock.
+     *
+     * @tparam K The typename of the key.
+     * @tparam V The typename of the value.
+     * @tparam N The number of buckets in the hashtable of in-flight computations. Prime numbers are highly recommended.
+     */
+    template<typename K, typename V, std::size_t N = 61>
+    class singleflight {
+    private:
+        typedef std::shared_future<std::shared_ptr<const V>> future_type;
+
+        /// The computations in flight.
+        threadsafe_hashtable<K, future_type, N> in_flight_;
+        /// The number of callers waiting for a computation in flight.
+        std::atomic_size_t num_waiting_{0};
+
+        /**
+         * Internal function to compute the value or wait for the computation in flight.
+         * @param _executor The executor to run pending tasks on while waiting.
+         */
+        template<typename Executor, typename Supplier>
+        std::shared_ptr<const V> do_call(Executor& _executor, const K& _key, Supplier&& _supplier)
+        {
+            while (true) {
+                // Most callers during a herd find the computation already in flight, so look before allocating a promise.
+                std::shared_ptr<future_type> existing = in_flight_.get(_key);
+                if (!existing) {
+                    std::promise<std::shared_ptr<const V>> promise;
+                    future_type future = promise.get_future().share();
+                    if (in_flight_.insert(_key, future)) {
+                        // This caller is the leader.
+                        try {
+                            std::shared_ptr<const V> value = std::make_shared<const V>(std::invoke(std::forward<Supplier>(_supplier)));
+                            promise.set_value(value);
+                            in_flight_.remove(_key);
+                            return value;
+                        }
+                        catch (...) {
+                            promise.set_exception(std::current_exception());
+                            in_flight_.remove(_key);
+                            throw;
+                        }
+                    }
+                    existing = in_flight_.get(_key);
+                    // The leader finished between our insert and get. Try again.
+                    if (!existing) { continue; }
+                }
+
+                ++num_waiting_;
+                _executor.run_pending_tasks(*existing);
+                --num_waiting_;
+                return existing->get();
+            }
+        }
+
+    public:
+        /**
+         * Constructs the singleflight.
+         */
+        singleflight() = default;
+        /**
+         * Destructs the singleflight.
+         */
+        ~singleflight() = default;
+
+        singleflight(const singleflight&) = delete;
+        singleflight(singleflight&&) = delete;
+        singleflight& operator=(const singleflight&) = delete;
+        singleflight& operator=(singleflight&&) = delete;
+
+        /**
+         * Compute the value of a key, or wait for the computation already in flight. Waiting callers block.
+         * @tparam Supplier The typename of the supplier.
+         * @param _key The key.
+         * @param _supplier The supplier which computes the value. It is only invoked if no computation of the key is in flight. It must not call
+         *                  this singleflight with _key.
+         * @return The value.
+         */
+        template<typename Supplier>
+        std::shared_ptr<const V> call(const K& _key, Supplier&& _supplier)
+            requires mkr::is_supplier<Supplier, V>
+        {
+            // An inline executor has no pending tasks, so waiting on it simply blocks.
+            inline_executor executor;
+            return do_call(executor, _key, std::forward<Supplier>(_supplier));
+        }
+
+        /**
+         * Compute the value of a key, or wait for the computation already in flight. Waiting callers run pending tasks of the
+         * executor, so a waiting worker thread keeps doing useful work, and the computation cannot deadlock a thread pool
+         * by occupying every worker with waiters.
+         * @tparam Executor The typename of the executor.
+         * @tparam Supplier The typename of the supplier.
+         * @param _executor The executor to run pending tasks on while waiting.
+         * @param _key The key.
+         * @param _supplier The supplier which computes the value. It is only invoked if no computation of the key is in flight. It must not call
+         *                  this singleflight with _key.
+         * @return The value.
+         */
+        template<executor Executor, typename Supplier>
+        std::shared_ptr<const V> call(Executor& _executor, const K& _key, Supplier&& _supplier)
+            requires mkr::is_supplier<Supplier, V>
+        {
+            return do_call(_executor, _key, std::forward<Supplier>(_supplier));
+        }
+
+        /**
+         * @return The number of computations in flight.
+         */
+        std::size_t num_in_flight() const { return in_flight_.size(); }
+
+        /**
+         * @return The number of callers waiting for a computation in flight.
+         */
+        std::size_t num_waiting() const { return num_waiting_.load(); }
+    };
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "../util/hardware.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace mkr {
+    /**
+     * A process-wide budget of CPU slots, shared by every mkr::thread_pool.
+     *
+     * A worker thread must hold a slot while it runs tasks, and gives it back as soon as it finds no work, so the total number of
+     * active workers across all thread pools never exceeds the budget, however many thread pools the libraries in the process create.
+     * An idle thread pool holds no slots, which lends its share to the busy ones. When workers are waiting for a slot, a worker
+     * hands its slot over after each task, so that one busy thread pool cannot starve another.
+     *
+     * Additional Notes:
+     * - Threads which are not worker threads, such as a thread running pending tasks while it waits, do not need a slot.
+     * - A worker thread which waits in another thread pool's run_pending_tasks() lends its slot to that thread pool's workers, and takes it
+     *   back afterwards even above the limit. A task which blocks in any other way keeps its slot while it blocks.
+     * - cpu_budget is non-copyable AND non-movable.
+     */
+    class cpu_budget {
+    private:
+        /// The maximum number of worker threads which may run tasks at once.
+        std::atomic_size_t limit_;
+        /// The number of slots held.
+        std::atomic_size_t num_active_{0};
+        /// The number of worker threads which have work but no slot.
+        std::atomic_size_t num_waiting_{0};
+
+        cpu_budget()
+                :limit_{available_concurrency()} { }
+
+    public:
+        cpu_budget(const cpu_budget&) = delete;
+        cpu_budget(cpu_budget&&) = delete;
+        cpu_budget& operator=(const cpu_budget&) = delete;
+        cpu_budget& operator=(cpu_budget&&) = delete;
+
+        /**
+         * Get the process-wide budget. Its limit starts at available_concurrency().
+         * @return The process-wide budget.
+         */
+        static cpu_budget& get_instance()
+        {
+            static cpu_budget budget;
+            return budget;
+        }
+
+        inline size_t limit() const { return limit_.load(); }
+        inline size_t num_active() const { return num_active_.load(); }
+        inline size_t num_waiting() const { return num_waiting_.load(); }
+
+        /**
+         * Set the maximum number of worker threads which may run tasks at once. Slots already held above a lower limit are
+         * given back as their workers go idle.
+         * @param _limit The limit. Must be 1 or greater.
+         */
+        void set_limit(size_t _limit) { limit_.store(std::max<size_t>(_limit, 1)); }
+
+        /**
+         * Try to take a slot.
+         * @return Returns true if a slot was taken. Else, return false.
+         */
+        bool try_acquire()
+        {
+            size_t num_active = num_active_.load();
+            while (num_active<limit_.load()) {
+                if (num_active_.compare_exchange_weak(num_active, num_active+1)) { return true; }
+            }
+            return false;
+        }
+
+        /**
+         * Take a slot even if the limit has been reached. Slots above the limit are given back between tasks.
+         */
+        void acquire() { ++num_active_; }
+
+        /**
+         * Give back a slot.
+         */
+        void release() { --num_active_; }
+
+        /**
+         * Register or unregister the calling worker as waiting for a slot.
+         * @param _waiting True if the worker has started waiting, false if it has stopped.
+         */
+        void set_waiting(bool _waiting)
+        {
+            if (_waiting) { ++num_waiting_; }
+            else { --num_waiting_; }
+        }
+    };
+}
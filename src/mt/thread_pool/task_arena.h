@@ -0,0 +1,211 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+#include <type_traits>
+
+namespace mkr {
+    /**
+     * A region of a thread pool with its own task queue.
+     *
+     * Tasks submitted from inside the arena, whether to the arena or to its thread pool, go to the arena's queue, and a thread inside
+     * the arena which runs pending tasks while it waits only runs the arena's tasks. A nested wait therefore never picks up
+     * outer work, which could otherwise block the waiting frame for as long as the unrelated task takes, or deadlock on a lock the
+     * waiting frame holds.
+     *
+     * The arena also caps the number of worker threads of the thread pool that run its tasks at once, so that one tenant
+     * cannot occupy the whole thread pool. Threads which enter the arena with execute(), or run its tasks while waiting,
+     * are not counted against the cap.
+     *
+     * Arenas can be used as tenants. The workers pick between busy arenas by weighted deficit round robin on the CPU time their tasks
+     * use, so an arena of weight 7 and an arena of weight 3 get about 70% and 30% of the workers' time while both are busy, and either
+     * gets all of it while the other is idle. As tasks submitted inside an arena never go to the workers' local task queues, stealing
+     * never moves a task from one tenant to another. The CPU time used by each arena is recorded.
+     *
+     * Additional Notes:
+     * - A task inside the arena must not block on a std::future of another task of the arena without running pending tasks,
+     *   as the cap may leave no worker to run it.
+     * - The destructor runs the arena's remaining tasks, and waits for the workers to finish its running tasks.
+     * - task_arena is non-copyable AND non-movable.
+     */
+    class task_arena {
+    private:
+        /// The task queue and worker count of the arena, shared with the thread pool.
+        detail::arena_state state_;
+
+        /**
+         * Makes the calling thread enter the arena, and leave it when destroyed.
+         */
+        class scope {
+        private:
+            /// The arena the thread was in before entering.
+            detail::arena_state* outer_arena_;
+
+        public:
+            explicit scope(detail::arena_state& _arena)
+                    :outer_arena_{thread_pool::current_arena_}
+            {
+                thread_pool::current_arena_ = &_arena;
+            }
+
+            ~scope() { thread_pool::current_arena_ = outer_arena_; }
+
+            scope(const scope&) = delete;
+            scope& operator=(const scope&) = delete;
+        };
+
+    public:
+        /**
+         * Constructs the arena.
+         * @param _thread_pool The thread pool whose workers run the arena's tasks.
+         * @param _max_concurrency The maximum number of worker threads which may run the arena's tasks at once.
+         *                         If 0, or greater than the number of worker threads, every worker thread may.
+         * @param _weight The share of the workers' time the arena gets while other arenas are busy, relative to their weights. Must be 1 or greater.
+         */
+        explicit task_arena(thread_pool& _thread_pool, size_t _max_concurrency = 0, size_t _weight = 1)
+                :state_{&_thread_pool, _max_concurrency==0 ? _thread_pool.num_threads() : std::min(_max_concurrency, _thread_pool.num_threads()),
+                        std::max<size_t>(_weight, 1)}
+        {
+            _thread_pool.attach(&state_);
+        }
+
+        /**
+         * Destructs the arena. Pending tasks are run on the calling thread.
+         */
+        ~task_arena()
+        {
+            state_.thread_pool_->detach(&state_);
+            // A running task may still submit more tasks, so keep going until no worker is inside.
+            while (state_.num_active_workers_.load()!=0 || !state_.task_queue_.empty()) {
+                if (!thread_pool::run_task_in(state_)) { std::this_thread::yield(); }
+            }
+        }
+
+        task_arena(const task_arena&) = delete;
+        task_arena(task_arena&&) = delete;
+        task_arena& operator=(const task_arena&) = delete;
+        task_arena& operator=(task_arena&&) = delete;
+
+        inline thread_pool& get_thread_pool() const { return *state_.thread_pool_; }
+        inline size_t max_concurrency() const { return state_.max_concurrency_; }
+        inline size_t num_threads() const { return state_.max_concurrency_; }
+        inline size_t weight() const { return state_.weight_; }
+
+        /**
+         * @return The CPU time used by the arena's tasks so far. The time a task spends running other tasks of the arena while it waits
+         *         is counted once, for those tasks.
+         */
+        inline std::chrono::nanoseconds cpu_time() const { return std::chrono::nanoseconds{state_.cpu_time_.load()}; }
+
+        /**
+         * @return The number of the arena's tasks which have run so far.
+         */
+        inline size_t num_tasks_run() const { return state_.num_tasks_run_.load(); }
+
+        /**
+         * Run a function on the calling thread inside the arena.
+         * @tparam Callable The typename of the function or callable object.
+         * @param _func The function or callable object.
+         * @return The result of the function.
+         * @throws The exception thrown by the function, if any.
+         */
+        template<typename Callable>
+        std::invoke_result_t<Callable> execute(Callable&& _func)
+        {
+            scope s{state_};
+            return std::invoke(std::forward<Callable>(_func));
+        }
+
+        /**
+         * Submit a task to the arena without a std::future to wait on.
+         * @tparam Callable The typename of the function or callable object.
+         * @param _func The function or callable object. It is invoked with no arguments and its result is discarded.
+         */
+        template<typename Callable>
+        void post(Callable&& _func)
+        {
+            state_.task_queue_.push(state_.thread_pool_->make_task(std::forward<Callable>(_func)));
+            state_.thread_pool_->request_worker(state_.task_queue_.size());
+        }
+
+        /**
+         * Submit a task to the arena.
+         * @tparam Callable The typename of the function or callable object.
+         * @tparam Args The typename of the function arguments.
+         * @param _func The function or callable object.
+         * @param _args The function arguments.
+         * @return A std::future which will contain the result of the function.
+         */
+        template<typename Callable, typename... Args>
+        std::future<std::invoke_result_t<Callable, Args...>> submit(Callable&& _func, Args&& ... _args)
+        {
+            typedef std::invoke_result_t<Callable, Args...> result_t;
+
+            std::packaged_task<result_t(void)> p_task{
+                    [func = std::forward<Callable>(_func),
+                            ...args = std::forward<Args>(_args)]() {
+                        return std::invoke(func, args...);
+                    }};
+            std::future<result_t> result = p_task.get_future();
+            post(std::move(p_task));
+            return result;
+        }
+
+        /**
+         * Run one of the arena's pending tasks on the calling thread, inside the arena.
+         * @return Returns true if a task was run. Else, return false.
+         */
+        bool run_pending_task() { return thread_pool::run_task_in(state_); }
+
+        /**
+         * While a std::future is not ready, run the arena's pending tasks.
+         * @tparam T The std::future type.
+         * @param _future The std::future to check if it is ready.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::future<T>& _future)
+        {
+            while (!is_future_ready(_future)) {
+                if (!run_pending_task()) { std::this_thread::yield(); }
+            }
+        }
+
+        /**
+         * While a std::shared_future is not ready, run the arena's pending tasks.
+         * @tparam T The std::shared_future type.
+         * @param _future The std::shared_future to check if it is ready.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::shared_future<T>& _future)
+        {
+            while (!is_future_ready(_future)) {
+                if (!run_pending_task()) { std::this_thread::yield(); }
+            }
+        }
+    };
+
+    static_assert(executor<task_arena>);
+
+    /**
+     * Run a function in a new arena of a thread pool, so that waits inside it only run tasks spawned inside it.
+     * The function returns once every task spawned inside the arena has finished.
+     * @tparam Callable The typename of the function or callable object.
+     * @param _thread_pool The thread pool.
+     * @param _func The function or callable object.
+     * @return The result of the function.
+     * @throws The exception thrown by the function, if any.
+     */
+    template<typename Callable>
+    std::invoke_result_t<Callable> isolate(thread_pool& _thread_pool, Callable&& _func)
+    {
+        task_arena arena{_thread_pool};
+        return arena.execute(std::forward<Callable>(_func));
+    }
+}
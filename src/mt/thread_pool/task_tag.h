@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace mkr {
+    /**
+     * A lightweight tag which attributes the tasks submitted to a mkr::thread_pool to the feature that submitted them.
+     * The name is interned once, and the tag is a small integer id after that, so tagging a task costs no more than passing an int.
+     * The default tag is the untagged tag, whose id is 0 and whose name is empty.
+     * @code
+     * static const mkr::task_tag search_tag = mkr::task_tag::intern("search");
+     * pool.submit(search_tag, [&]() { return search(query); });
+     * @endcode
+     */
+    class task_tag {
+    public:
+        /// The maximum number of distinct tags, including the untagged tag.
+        static constexpr std::size_t max_tags = 256;
+
+    private:
+        /// The index of the tag's name.
+        std::uint16_t id_ = 0;
+
+        explicit task_tag(std::uint16_t _id)
+                :id_{_id} { }
+
+        /**
+         * The interned names. A std::deque does not move its elements when it grows, so references to the names stay valid.
+         */
+        struct name_table {
+            std::mutex mutex_;
+            std::deque<std::string> names_{std::string{}};
+            std::unordered_map<std::string_view, std::uint16_t> ids_{{std::string_view{names_.front()}, 0}};
+        };
+
+        static name_table& get_name_table()
+        {
+            static name_table table;
+            return table;
+        }
+
+    public:
+        task_tag() = default;
+
+        /**
+         * Get the tag of a name, creating it if it does not exist yet.
+         * @param _name The name of the tag.
+         * @return The tag. Interning the same name again returns an equal tag.
+         * @throws std::length_error If there are already max_tags tags.
+         */
+        static task_tag intern(std::string_view _name)
+        {
+            name_table& table = get_name_table();
+            std::lock_guard lock{table.mutex_};
+            auto iter = table.ids_.find(_name);
+            if (iter!=table.ids_.end()) { return task_tag{iter->second}; }
+
+            if (table.names_.size()>=max_tags) { throw std::length_error{"mkr::task_tag: too many tags"}; }
+            const std::uint16_t id = static_cast<std::uint16_t>(table.names_.size());
+            table.names_.emplace_back(_name);
+            table.ids_.emplace(std::string_view{table.names_.back()}, id);
+            return task_tag{id};
+        }
+
+        /**
+         * Get a tag from its id.
+         * @param _id The id of the tag. Must be an id returned by id() of an interned tag.
+         * @return The tag.
+         */
+        static task_tag from_id(std::size_t _id) { return task_tag{static_cast<std::uint16_t>(_id)}; }
+
+        inline std::size_t id() const { return id_; }
+        inline bool empty() const { return id_==0; }
+
+        /**
+         * @return The name of the tag. The reference stays valid for the lifetime of the program.
+         */
+        const std::string& name() const
+        {
+            name_table& table = get_name_table();
+            std::lock_guard lock{table.mutex_};
+            return table.names_[id_];
+        }
+
+        bool operator==(const task_tag&) const = default;
+    };
+}
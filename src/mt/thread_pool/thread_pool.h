@@ -1,33 +1,420 @@
 #pragma once
 
 #include "task.h"
-#include "../container/threadsafe_hashtable.h"
-#include "../container/threadsafe_queue.h"
-#include "../container/threadsafe_stack.h"
+#include "cpu_budget.h"
+#include "task_tag.h"
+#include "thread_pool_policies.h"
+#include "../util/concepts.h"
+#include "../util/future.h"
+#include "../util/hardware.h"
+#include "../util/tracepoints.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <limits>
 #include <thread>
 #include <future>
 #include <latch>
+#include <mutex>
+#include <optional>
 
 namespace mkr {
+    template<typename Policies = thread_pool_policies>
+    class basic_thread_pool;
+    /// A thread pool with the default policies.
+    typedef basic_thread_pool<> thread_pool;
+    class task_arena;
+
+    namespace detail {
+        /**
+         * The task queue, worker count and CPU time of a mkr::task_arena, which the thread pool's workers take tasks from.
+         */
+        struct arena_state {
+            /// The CPU time, in nanoseconds, an arena of weight 1 may use each round of the deficit round robin.
+            static constexpr long long quantum = 1000000;
+
+            /// The thread pool of the arena.
+            thread_pool* thread_pool_ = nullptr;
+            /// The maximum number of worker threads which may run the arena's tasks at once.
+            size_t max_concurrency_ = 0;
+            /// The share of the workers the arena gets, relative to the weights of the other busy arenas.
+            size_t weight_ = 1;
+            /// The tasks submitted from within the arena. It is a FIFO queue.
+            threadsafe_queue<task> task_queue_{};
+            /// The number of worker threads running the arena's tasks.
+            std::atomic_size_t num_active_workers_{0};
+            /// The CPU time, in nanoseconds, the arena may still use this round. Charged after each task.
+            std::atomic<long long> deficit_{0};
+            /// The CPU time, in nanoseconds, used by the arena's tasks, not including the tasks they ran while waiting.
+            std::atomic<long long> cpu_time_{0};
+            /// The number of the arena's tasks which have run.
+            std::atomic_size_t num_tasks_run_{0};
+        };
+
+        /// The number of buckets of the task latency histogram. The last bucket has no upper bound.
+        constexpr size_t num_latency_buckets = 22;
+
+        /**
+         * The counters of a worker thread. Each worker only writes its own counters, which sit on their own cache lines,
+         * so they can be read at any time without stopping or slowing down the workers.
+         */
+        struct alignas(cache_line_size) worker_counters {
+            /// The number of tasks run.
+            std::atomic_uint64_t num_tasks_run_{0};
+            /// The number of tasks taken from another worker's local task queue.
+            std::atomic_uint64_t num_tasks_stolen_{0};
+            /// The time spent idle, in nanoseconds, not including the current idle period.
+            std::atomic_uint64_t idle_time_{0};
+            /// The steady clock time, in nanoseconds, when the current idle period started, or 0 if the worker is busy.
+            std::atomic_uint64_t idle_since_{0};
+            /**
+             * The task the worker is running, or 0 if it is not running one. The microseconds since the thread pool was constructed
+             * when the task started, plus 1, are in the upper 48 bits, and the id of the task's tag is in the lower 16 bits,
+             * so that starting a task publishes both with a single store.
+             */
+            std::atomic_uint64_t running_task_{0};
+            /// The sum of the time tasks waited in a queue before they started, in nanoseconds.
+            std::atomic_uint64_t latency_sum_{0};
+            /// The number of tasks per latency bucket. Bucket i counts the tasks which waited less than 2^i microseconds.
+            std::array<std::atomic_uint64_t, num_latency_buckets> latency_buckets_{};
+        };
+
+        /**
+         * The number of tasks, wall time and CPU time of a task tag.
+         */
+        struct tag_counters {
+            /// The number of tasks run.
+            std::atomic_uint64_t num_tasks_{0};
+            /// The wall time of the tasks, in nanoseconds, not including the tasks they ran while waiting.
+            std::atomic_uint64_t wall_time_{0};
+            /// The thread CPU time of the tasks, in nanoseconds, not including the tasks they ran while waiting.
+            std::atomic_uint64_t cpu_time_{0};
+        };
+
+        /**
+         * The counters of every task tag for one worker thread.
+         */
+        struct alignas(cache_line_size) tag_table {
+            std::array<tag_counters, task_tag::max_tags> tags_{};
+        };
+
+        /**
+         * A fixed size array which is allocated when an element is first accessed, so that a thread pool which never runs a task
+         * does not pay for its counters. Threads which access it first at the same time race to allocate it, and the losers free theirs.
+         * @tparam T The type of the elements. It must be default constructible.
+         */
+        template<typename T>
+        class lazy_array {
+        private:
+            const size_t size_;
+            std::atomic<T*> data_{nullptr};
+
+        public:
+            explicit lazy_array(size_t _size)
+                    :size_{_size} { }
+
+            ~lazy_array() { delete[] data_.load(std::memory_order_relaxed); }
+
+            lazy_array(const lazy_array&) = delete;
+            lazy_array(lazy_array&&) = delete;
+            lazy_array& operator=(const lazy_array&) = delete;
+            lazy_array& operator=(lazy_array&&) = delete;
+
+            inline size_t size() const { return size_; }
+
+            /**
+             * @return The elements, or nullptr if none has been accessed yet.
+             */
+            inline const T* allocated() const { return data_.load(std::memory_order_acquire); }
+
+            /**
+             * Get an element, allocating the array if it has not been allocated yet.
+             * @param _index The index of the element. Must be less than size().
+             * @return The element.
+             */
+            T& operator[](size_t _index)
+            {
+                T* data = data_.load(std::memory_order_acquire);
+                if (!data) {
+                    T* allocated = new T[size_]{};
+                    if (data_.compare_exchange_strong(data, allocated, std::memory_order_acq_rel)) { data = allocated; }
+                    else { delete[] allocated; }
+                }
+                return data[_index];
+            }
+        };
+
+        /**
+         * @return The CPU time consumed by the calling thread, in nanoseconds.
+         */
+        inline uint64_t thread_cpu_time()
+        {
+            timespec time{};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+            return static_cast<uint64_t>(time.tv_sec)*1000000000ULL+static_cast<uint64_t>(time.tv_nsec);
+        }
+
+        /**
+         * @return The steady clock time in nanoseconds.
+         */
+        inline uint64_t steady_time()
+        {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+    }
+
+    /**
+     * A snapshot of the statistics of a mkr::thread_pool.
+     */
+    struct thread_pool_stats {
+        /// The number of worker threads.
+        size_t num_threads_ = 0;
+        /// The number of tasks in the global task queue.
+        size_t global_queue_depth_ = 0;
+        /// The number of tasks in each worker thread's local task queue.
+        std::vector<size_t> local_queue_depths_;
+        /// The number of queued operations.
+        size_t num_operations_ = 0;
+        /// The number of tasks in the queues of the task arenas.
+        size_t arena_queue_depth_ = 0;
+        /// The number of tasks and operations run, including by threads which are not worker threads.
+        uint64_t num_tasks_run_ = 0;
+        /// The number of tasks taken from another worker's local task queue.
+        uint64_t num_tasks_stolen_ = 0;
+        /// The fraction of the worker threads' time spent idle since the thread pool was constructed.
+        double idle_fraction_ = 0.0;
+        /// The number of tasks which waited in a queue for at most latency_bucket_bound(i) seconds, per bucket. It is not cumulative.
+        std::array<uint64_t, detail::num_latency_buckets> latency_buckets_{};
+        /// The number of tasks whose latency was measured.
+        uint64_t latency_count_ = 0;
+        /// The sum of the time tasks waited in a queue before they started, in seconds.
+        double latency_sum_ = 0.0;
+
+        /**
+         * @param _bucket The index of the latency bucket.
+         * @return The upper bound of the latency bucket, in seconds. The bound of the last bucket is infinite.
+         */
+        static double latency_bucket_bound(size_t _bucket)
+        {
+            if (_bucket+1>=detail::num_latency_buckets) { return std::numeric_limits<double>::infinity(); }
+            return static_cast<double>(uint64_t{1} << _bucket)*1e-6;
+        }
+    };
+
+    /**
+     * The task tag statistics of a mkr::thread_pool.
+     */
+    struct task_tag_stats {
+        /// The tag.
+        task_tag tag_;
+        /// The number of tasks with the tag which have run.
+        uint64_t num_tasks_ = 0;
+        /// The wall time of the tasks, not including other tasks they ran while waiting.
+        std::chrono::nanoseconds wall_time_{0};
+        /// The thread CPU time of the tasks, not including other tasks they ran while waiting.
+        std::chrono::nanoseconds cpu_time_{0};
+    };
+
+    /**
+     * The task a worker thread of a mkr::thread_pool is running.
+     */
+    struct running_task_info {
+        /// The steady clock time in nanoseconds when the task started, with a resolution of a microsecond.
+        uint64_t start_time_ = 0;
+        /// The tag of the task.
+        task_tag tag_;
+    };
+
+    namespace detail {
+        /**
+         * Records which thread runs a forked task, so that a worker joining the task knows whom to help.
+         */
+        struct fork_record {
+            /// The value of runner_ before the task has started.
+            static constexpr size_t not_started = static_cast<size_t>(-1);
+            /// The value of runner_ if the task is run by a thread which is not a worker of the thread pool.
+            static constexpr size_t external = static_cast<size_t>(-2);
+
+            /// The worker index of the thread running the task, not_started, or external.
+            std::atomic_size_t runner_{not_started};
+            /// The size of the runner's local task queue when the task started. Tasks above it were pushed by the task or its descendants.
+            std::atomic_size_t runner_base_{0};
+            /// The position of the task in the forking worker's local task queue, counted from the bottom. 0 if it was not pushed to one.
+            size_t position_ = 0;
+            /// The task, if it was forked from outside the thread pool. Whoever claims it first runs it: a worker, or the joining thread.
+            std::optional<task> claimable_;
+            /// Whether claimable_ has been claimed.
+            std::atomic_bool claimed_{false};
+
+            /**
+             * Run claimable_ if nobody has claimed it yet.
+             * @return Returns true if the task was run. Else, return false.
+             */
+            bool try_run()
+            {
+                if (!claimable_ || claimed_.exchange(true, std::memory_order_acq_rel)) { return false; }
+                (*claimable_)();
+                return true;
+            }
+        };
+    }
+
     /**
-     * Checks if a std::future is ready.
-     * @tparam T The data type of the std::future.
-     * @param _future The std::future to check.
-     * @return Returns true if the std::future is ready. Else, returns false.
-     * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+     * A handle to a task forked with mkr::thread_pool::fork. Joining it with mkr::thread_pool::run_pending_tasks leapfrogs:
+     * while the task is running on another worker, the joining worker only runs tasks from that worker's local task queue.
+     * @tparam T The result type of the task.
      */
     template<typename T>
-    bool is_future_ready(const std::future<T>& _future)
-    {
-        return _future.wait_for(std::chrono::milliseconds(0))==std::future_status::ready;
+    class fork_handle {
+    private:
+        template<typename Policies>
+        friend class basic_thread_pool;
+
+        /// The result of the task.
+        std::future<T> future_;
+        /// Which thread runs the task.
+        std::shared_ptr<detail::fork_record> record_;
+
+        fork_handle(std::future<T>&& _future, std::shared_ptr<detail::fork_record> _record)
+                :future_{std::move(_future)}, record_{std::move(_record)} { }
+
+    public:
+        fork_handle() = default;
+
+        inline bool valid() const { return future_.valid(); }
+        inline bool is_ready() const { return is_future_ready(future_); }
+
+        /**
+         * Wait for the result of the task.
+         * @return The result of the task.
+         * @throws The exception thrown by the task, if any.
+         */
+        T get() { return future_.get(); }
+    };
+
+    /**
+     * When the worker threads of a mkr::thread_pool are created.
+     */
+    enum class worker_startup {
+        /// All the worker threads are created by the constructor.
+        eager,
+        /**
+         * No worker thread is created by the constructor, so constructing the thread pool costs a few allocations.
+         * A worker is created when a task is submitted while no worker has been created, or while an earlier task in the same queue
+         * is still waiting, so the thread pool grows as load appears, up to num_threads(). Workers are not stopped when the load goes away.
+         */
+        lazy,
+    };
+
+    namespace detail {
+        /**
+         * @return The number of worker threads of a thread pool constructed without a size. See mkr::basic_thread_pool::default_num_threads.
+         */
+        size_t default_num_threads();
+
+        /**
+         * The state of the calling thread, shared by every mkr::basic_thread_pool. It is kept out of the class template, as GCC does not
+         * emit the thread_local members of an explicitly instantiated class template for the other translation units to use.
+         */
+        class thread_pool_thread_state {
+        protected:
+            /// The thread pool which the calling thread is a worker of, or nullptr.
+            inline static thread_local const void* current_thread_pool_ = nullptr;
+            /// The worker index of the calling thread in current_thread_pool_.
+            inline static thread_local size_t current_worker_index_ = 0;
+            /// The task arena which the calling thread is running in, or nullptr.
+            inline static thread_local arena_state* current_arena_ = nullptr;
+            /// The wall time of the tagged tasks which ran nested inside the tagged task the calling thread is running.
+            inline static thread_local uint64_t nested_tag_wall_time_ = 0;
+            /// The CPU time of the tagged tasks which ran nested inside the tagged task the calling thread is running.
+            inline static thread_local uint64_t nested_tag_cpu_time_ = 0;
+            /// The CPU time of the arena tasks which ran nested inside the arena task the calling thread is running, so that it is not charged twice.
+            inline static thread_local long long nested_arena_cpu_time_ = 0;
+            /// Whether the calling worker thread holds a mkr::cpu_budget slot, or nullptr if the calling thread is not a worker thread.
+            inline static thread_local bool* holds_budget_slot_ = nullptr;
+
+            /**
+             * Lends the calling worker thread's mkr::cpu_budget slot while it waits for another thread pool, whose workers may need the
+             * slot to finish what it waits for. The slot is taken back afterwards, even above the limit.
+             */
+            class budget_slot_loan {
+            private:
+                bool lent_;
+
+            public:
+                explicit budget_slot_loan(const void* _thread_pool)
+                        :lent_{current_thread_pool_!=_thread_pool && holds_budget_slot_ && *holds_budget_slot_}
+                {
+                    if (lent_) {
+                        cpu_budget::get_instance().release();
+                        *holds_budget_slot_ = false;
+                    }
+                }
+
+                ~budget_slot_loan()
+                {
+                    if (lent_) {
+                        cpu_budget::get_instance().acquire();
+                        *holds_budget_slot_ = true;
+                    }
+                }
+
+                budget_slot_loan(const budget_slot_loan&) = delete;
+                budget_slot_loan(budget_slot_loan&&) = delete;
+                budget_slot_loan& operator=(const budget_slot_loan&) = delete;
+                budget_slot_loan& operator=(budget_slot_loan&&) = delete;
+            };
+        };
     }
 
     /**
      * A work stealing thread pool. Tasks can be submitted to it to be done concurrently.
      * Once a thread is working on a task, it is not interruptable until the task is complete.
+     * The number of worker threads running tasks at once, across every thread pool in the process, is capped by mkr::cpu_budget.
+     *
+     * The queues, idle strategy, steal order and instrumentation are policies fixed at compile time, so each is compiled into the
+     * workers' loop without any runtime branching. mkr::thread_pool uses the default mkr::thread_pool_policies.
+     * mkr::task_arena, mkr::thread_pool_watchdog and mkr::metrics_registry work with mkr::thread_pool.
+     * @tparam Policies The scheduling policies. See mkr::thread_pool_policies.
      */
-    class thread_pool {
+    template<typename Policies>
+    class basic_thread_pool : private detail::thread_pool_thread_state {
+    private:
+        friend class task_arena;
+
+        /// The type of the worker threads' local task queues.
+        typedef typename Policies::template local_queue<task> local_queue_type;
+        /// The type of the global task queue.
+        typedef typename Policies::template global_queue<task> global_queue_type;
+        /// The idle strategy of the worker threads.
+        typedef typename Policies::idle_policy idle_policy;
+        /// The steal policy of the worker threads.
+        typedef typename Policies::steal_policy steal_policy;
+        /// Whether the thread pool keeps statistics.
+        static constexpr bool enable_stats = Policies::enable_stats;
+
+        static_assert(local_task_queue<local_queue_type>);
+        static_assert(global_task_queue<global_queue_type>);
+
+    public:
+        /**
+         * An operation which can be queued on the thread pool without allocating. Operation states of senders derive from it,
+         * so that a sender pipeline can run on the thread pool without any heap allocations.
+         * The owner of the operation must keep it alive until it has been executed.
+         */
+        struct operation {
+            /// The function which executes the operation. It is invoked exactly once, on a thread of the thread pool or a thread running pending tasks.
+            void (*execute_)(operation*) noexcept;
+            /// The next operation in the queue.
+            operation* next_ = nullptr;
+        };
+
+        class scheduler;
+
     private:
         /// The number of threads in the thread pool. The number of threads must be >= 1.
         const size_t num_threads_;
@@ -36,10 +423,24 @@ namespace mkr {
         /// A flag to signal the threads to stop after completing their current task.
         std::atomic_bool end_flag_;
 
-        /// A hashtable mapping the std::thread::id of a thread to the local array index.
-        threadsafe_hashtable<std::thread::id, size_t> worker_index_lookup_;
         /// The global task queue shared by all threads. It is a FIFO queue.
-        threadsafe_queue<task> global_task_queue_;
+        global_queue_type global_task_queue_;
+        /// Protects operation_head_ and operation_tail_.
+        std::mutex operation_mutex_;
+        /// The oldest queued operation. Operations are intrusively linked, so queueing them does not allocate. It is a FIFO queue.
+        operation* operation_head_ = nullptr;
+        /// The newest queued operation.
+        operation* operation_tail_ = nullptr;
+        /// The number of queued operations, so that idle threads do not need to lock operation_mutex_ to find out that there are none.
+        std::atomic_size_t num_operations_{0};
+        /// Protects arenas_ and next_arena_.
+        mutable std::mutex arena_mutex_;
+        /// The task arenas of the thread pool.
+        std::vector<detail::arena_state*> arenas_;
+        /// The arena being served by the deficit round robin.
+        size_t next_arena_ = 0;
+        /// The number of arenas, so that idle threads do not need to lock arena_mutex_ to find out that there are none.
+        std::atomic_size_t num_arenas_{0};
         /**
          * An array of local task queues of the worker threads. It is a LIFO stack.
          * It is best that each worker thread adds the task to it's own stack.
@@ -48,9 +449,161 @@ namespace mkr {
          * access is still warm in the thread's cache. Therefore there is the least
          * chance of a cache miss. That's why a stack which is LIFO is preferred.
          */
-        std::vector<std::shared_ptr<threadsafe_stack<task>>> local_task_queues_;
-        /// An array of worker threads.
+        std::vector<std::shared_ptr<local_queue_type>> local_task_queues_;
+        /// An array of worker threads. Under lazy startup, the threads which have not been created yet are not joinable.
         std::vector<std::thread> worker_threads_;
+        /// Protects the creation of worker threads, so that they are created in order, and none after destruction begins.
+        std::mutex start_mutex_;
+        /// The number of worker threads created. The first num_started_threads_ elements of worker_threads_ have been created.
+        std::atomic_size_t num_started_threads_{0};
+        /// The number of worker threads created which are idle, counting those which have not reached their loop yet.
+        std::atomic_size_t num_idle_threads_{0};
+        /// The counters of each worker thread, followed by the counters shared by the threads which are not worker threads.
+        detail::lazy_array<detail::worker_counters> counters_;
+        /// The steady clock time, in nanoseconds, when the thread pool was constructed.
+        const uint64_t start_time_;
+        /// The task tag counters of each worker thread, followed by those shared by the threads which are not worker threads. Empty without stats.
+        detail::lazy_array<detail::tag_table> tag_tables_;
+
+        /**
+         * Publishes the task a worker is running for the whole of the task, and restores the task it interrupted afterwards.
+         */
+        class running_task_scope {
+        private:
+            std::atomic_uint64_t& running_task_;
+            const uint64_t outer_task_;
+
+        public:
+            running_task_scope(std::atomic_uint64_t& _running_task, uint64_t _task)
+                    :running_task_{_running_task}, outer_task_{_running_task.load(std::memory_order_relaxed)}
+            {
+                running_task_.store(_task, std::memory_order_relaxed);
+            }
+
+            ~running_task_scope() { running_task_.store(outer_task_, std::memory_order_relaxed); }
+        };
+
+        /**
+         * Measures the wall time and CPU time of a tagged task, excluding the tagged tasks it runs while waiting, and charges it to the tag.
+         */
+        class tag_scope {
+        private:
+            detail::tag_counters& counters_;
+            const uint64_t start_wall_time_;
+            const uint64_t start_cpu_time_;
+            const uint64_t outer_nested_wall_time_;
+            const uint64_t outer_nested_cpu_time_;
+
+        public:
+            tag_scope(detail::tag_counters& _counters, uint64_t _start_wall_time)
+                    :counters_{_counters}, start_wall_time_{_start_wall_time}, start_cpu_time_{detail::thread_cpu_time()},
+                     outer_nested_wall_time_{nested_tag_wall_time_}, outer_nested_cpu_time_{nested_tag_cpu_time_}
+            {
+                nested_tag_wall_time_ = 0;
+                nested_tag_cpu_time_ = 0;
+            }
+
+            ~tag_scope()
+            {
+                const uint64_t wall_time = detail::steady_time()-start_wall_time_;
+                const uint64_t cpu_time = detail::thread_cpu_time()-start_cpu_time_;
+                counters_.num_tasks_.fetch_add(1, std::memory_order_relaxed);
+                counters_.wall_time_.fetch_add(wall_time-std::min(wall_time, nested_tag_wall_time_), std::memory_order_relaxed);
+                counters_.cpu_time_.fetch_add(cpu_time-std::min(cpu_time, nested_tag_cpu_time_), std::memory_order_relaxed);
+                nested_tag_wall_time_ = outer_nested_wall_time_+wall_time;
+                nested_tag_cpu_time_ = outer_nested_cpu_time_+cpu_time;
+            }
+        };
+
+        /**
+         * @return The counters of the calling thread.
+         */
+        detail::worker_counters& counters()
+        {
+            return counters_[current_thread_pool_==this ? current_worker_index_ : num_threads_];
+        }
+
+        /**
+         * Count a task which is starting, and record how long it waited in a queue.
+         * @param _counters The counters of the calling thread.
+         * @param _enqueue_time The steady clock time, in nanoseconds, when the task was queued.
+         * @return The steady clock time, in nanoseconds, when the task started.
+         */
+        static uint64_t record_task_start(detail::worker_counters& _counters, uint64_t _enqueue_time)
+        {
+            const uint64_t start_time = detail::steady_time();
+            const uint64_t latency = start_time-_enqueue_time;
+            _counters.num_tasks_run_.fetch_add(1, std::memory_order_relaxed);
+            _counters.latency_sum_.fetch_add(latency, std::memory_order_relaxed);
+            _counters.latency_buckets_[std::min<size_t>(std::bit_width(latency/1000), detail::num_latency_buckets-1)].fetch_add(1, std::memory_order_relaxed);
+            return start_time;
+        }
+
+        /**
+         * Wrap a function in a task which records its queueing latency when it starts, and charges its time to its tag.
+         * Untagged tasks do not read the CPU time. Without stats, the tag is ignored, and the function is only wrapped to fire the
+         * task_submit, task_start and task_end tracepoints, or not at all if tracepoints are disabled.
+         * @tparam Callable The typename of the function or callable object.
+         * @param _tag The tag of the task.
+         * @param _func The function or callable object.
+         * @return The task.
+         */
+        template<typename Callable>
+        task make_task(task_tag _tag, Callable&& _func)
+        {
+            if constexpr (enable_stats) {
+                const uint64_t enqueue_time = detail::steady_time();
+                MKR_TRACE(task_submit, this, _tag.id(), enqueue_time);
+                return task{[this, _tag, enqueue_time, func = std::forward<Callable>(_func)]() mutable {
+                    const size_t slot = current_thread_pool_==this ? current_worker_index_ : num_threads_;
+                    const uint64_t start_time = record_task_start(counters_[slot], enqueue_time);
+                    MKR_TRACE(task_start, this, slot, _tag.id(), enqueue_time, start_time);
+
+                    // Publish the task for a watchdog with a single relaxed store. A task nested in a waiting task restores the
+                    // waiting task when it finishes. Threads which are not worker threads share a slot, so they are not watched.
+                    std::optional<running_task_scope> running_task;
+                    if (slot!=num_threads_) {
+                        running_task.emplace(counters_[slot].running_task_, ((start_time-start_time_)/1000+1) << 16 | _tag.id());
+                    }
+
+                    if (_tag.empty()) {
+                        std::invoke(func);
+                    }
+                    else {
+                        tag_scope tag{tag_tables_[slot].tags_[_tag.id()], start_time};
+                        std::invoke(func);
+                    }
+                    MKR_TRACE(task_end, this, slot, _tag.id(), start_time);
+                }};
+            }
+            else if constexpr (MKR_TRACEPOINTS_ENABLED) {
+                // The tracepoints do not depend on stats, so they fire with the same arguments, at the cost of reading the clock.
+                const uint64_t enqueue_time = detail::steady_time();
+                MKR_TRACE(task_submit, this, _tag.id(), enqueue_time);
+                return task{[this, _tag, enqueue_time, func = std::forward<Callable>(_func)]() mutable {
+                    const size_t slot = current_thread_pool_==this ? current_worker_index_ : num_threads_;
+                    const uint64_t start_time = detail::steady_time();
+                    MKR_TRACE(task_start, this, slot, _tag.id(), enqueue_time, start_time);
+                    std::invoke(func);
+                    MKR_TRACE(task_end, this, slot, _tag.id(), start_time);
+                }};
+            }
+            else {
+                return task{std::decay_t<Callable>{std::forward<Callable>(_func)}};
+            }
+        }
+
+        /**
+         * Wrap a function in an untagged task which records its queueing latency when it starts.
+         * @tparam Callable The typename of the function or callable object.
+         * @param _func The function or callable object.
+         * @return The task.
+         */
+        template<typename Callable>
+        task make_task(Callable&& _func)
+        {
+            return make_task(task_tag{}, std::forward<Callable>(_func));
+        }
 
         /**
          * Retrieve a task from a worker thread's local task queue.
@@ -68,7 +621,7 @@ namespace mkr {
 
         /**
          * Steal a task from another thread's local task queue.
-         * @param _index The stealing thread's array index.
+         * @param _index The stealing thread's array index, or num_threads_ if it is not a worker thread, which steals from every worker.
          * @return A task from the global task queue. If there are not tasks available, return a nullptr.
          */
         std::shared_ptr<task> steal_task(size_t _index);
@@ -86,6 +639,54 @@ namespace mkr {
          */
         bool run_global_task();
 
+        /**
+         * Run a queued operation.
+         * @return Returns true if an operation was run. Else, return false.
+         */
+        bool run_operation();
+
+        /**
+         * Run a task inside an arena, and charge the CPU time it used to the arena.
+         * @param _arena The arena.
+         * @param _task The task.
+         */
+        static void run_in_arena(detail::arena_state& _arena, task& _task);
+
+        /**
+         * Run a task from one of the arenas whose concurrency limit has not been reached.
+         * The arena is chosen by weighted deficit round robin, so that busy arenas share the workers in proportion to their weights.
+         * @return Returns true if a task was run. Else, return false.
+         */
+        bool run_arena_task();
+
+        /**
+         * Run a task from an arena on the calling thread, inside the arena. The arena's concurrency limit does not apply,
+         * as the calling thread is already in the arena or is the arena's owner.
+         * @param _arena The arena.
+         * @return Returns true if a task was run. Else, return false.
+         */
+        static bool run_task_in(detail::arena_state& _arena);
+
+        /**
+         * Add an arena, so that the workers take tasks from it.
+         * @param _arena The arena.
+         */
+        void attach(detail::arena_state* _arena);
+
+        /**
+         * Remove an arena. The workers may still be running tasks from it.
+         * @param _arena The arena.
+         */
+        void detach(detail::arena_state* _arena);
+
+        /**
+         * @return The arena of this thread pool which the calling thread is running in, or nullptr.
+         */
+        detail::arena_state* current_arena() const
+        {
+            return current_arena_ && static_cast<const void*>(current_arena_->thread_pool_)==this ? current_arena_ : nullptr;
+        }
+
         /**
          * Run a stolen task.
          * @param _index The stealing thread's array index.
@@ -94,23 +695,110 @@ namespace mkr {
         bool run_stolen_task(size_t _index);
 
         /**
-         * Worker thread function.
+         * Run a task from a specific worker thread's local task queue, if the queue has more than a given number of tasks.
+         * @param _victim The array index of the worker thread to take the task from.
+         * @param _size The number of tasks which must remain in the queue.
+         * @return Returns true if a task was run. Else, return false.
+         */
+        bool run_task_from(size_t _victim, size_t _size);
+
+        /**
+         * Check if there may be a task for a worker thread to run, without taking one.
+         * @return Returns true if any queue of the thread pool may have a task. Else, return false.
+         */
+        bool has_pending_task() const;
+
+        /**
+         * Worker thread function. A worker thread holds a slot of the process-wide mkr::cpu_budget while it runs tasks.
+         * @param _index The thread's array index.
+         */
+        void worker_thread_func(size_t _index);
+
+        /**
+         * Create the next worker thread, unless every worker thread has been created, or another thread is creating one.
+         * @throws std::system_error If no worker thread has been created yet, and the thread cannot be created.
          */
-        void worker_thread_func();
+        void start_worker();
+
+        /**
+         * Under lazy startup, create a worker thread if the queue a task was just pushed to holds more tasks than there are idle worker
+         * threads, so that a task is never left waiting behind busy workers, such as one blocked on it, while the thread pool could grow.
+         * Once every worker thread has been created, this is a single relaxed load.
+         * @param _queue_size The size of the queue after the push.
+         */
+        inline void request_worker(size_t _queue_size)
+        {
+            if (num_started_threads_.load(std::memory_order_relaxed)<num_threads_ && _queue_size>num_idle_threads_.load(std::memory_order_relaxed)) {
+                start_worker();
+            }
+        }
 
     public:
         /**
          * Constructs the thread pool.
          * @param _num_threads The number of worker threads the thread pool has. Must be 1 or greater.
+         * @param _startup When the worker threads are created. Short-lived programs which may not submit much work should start lazily.
          */
-        thread_pool(size_t _num_threads = static_cast<size_t>(std::thread::hardware_concurrency()-1));
+        basic_thread_pool(size_t _num_threads = default_num_threads(), worker_startup _startup = worker_startup::eager);
         /**
          * Destructs the thread pool.
          */
-        ~thread_pool();
+        ~basic_thread_pool();
+
+        basic_thread_pool(const basic_thread_pool&) = delete;
+        basic_thread_pool(basic_thread_pool&&) = delete;
+        basic_thread_pool& operator=(const basic_thread_pool&) = delete;
+        basic_thread_pool& operator=(basic_thread_pool&&) = delete;
 
         inline size_t num_threads() const { return num_threads_; }
 
+        /**
+         * @return The number of worker threads created so far. It is num_threads() unless the thread pool starts lazily.
+         */
+        inline size_t num_started_threads() const { return num_started_threads_.load(std::memory_order_relaxed); }
+
+        /**
+         * Get the number of worker threads of a thread pool constructed without a size.
+         * If the environment variable MKR_NUM_THREADS is set to a positive integer, that is used. Else, it is one less than
+         * available_concurrency(), which respects the cgroup CPU quota and cpuset and the affinity mask, leaving a CPU for the thread
+         * which submits the tasks. It is evaluated every time it is called, so it picks up changes to the limits.
+         * @return The default number of worker threads. Always 1 or greater.
+         */
+        static size_t default_num_threads() { return detail::default_num_threads(); }
+
+        /**
+         * Take a snapshot of the statistics of the thread pool. The workers' counters are read while they keep running,
+         * so the snapshot is not atomic, but every counter in it is at least as recent as the call. Without stats, only the queue
+         * depths are filled in.
+         * @return The statistics.
+         */
+        thread_pool_stats get_stats() const;
+
+        /**
+         * Get the task tag statistics, merged from the workers' tables while they keep running. Without stats, it is empty.
+         * @return The statistics of every tag which has run a task, ordered by tag id.
+         */
+        std::vector<task_tag_stats> get_tag_stats() const;
+
+        /**
+         * Get the task a worker thread is running. It is read without synchronising with the worker. Without stats, it is never known.
+         * @param _worker_index The index of the worker thread. Must be less than num_threads().
+         * @return The task, or std::nullopt if the worker is not running a task.
+         */
+        std::optional<running_task_info> running_task(size_t _worker_index) const
+        {
+            if constexpr (enable_stats) {
+                const detail::worker_counters* counters = counters_.allocated();
+                if (!counters) { return std::nullopt; }
+                const uint64_t running_task = counters[_worker_index].running_task_.load(std::memory_order_relaxed);
+                if (running_task==0) { return std::nullopt; }
+                return running_task_info{start_time_+((running_task >> 16)-1)*1000, task_tag::from_id(running_task & 0xFFFF)};
+            }
+            else {
+                return std::nullopt;
+            }
+        }
+
         /**
          * Run a pending task in the thread pool. After submitting a task to the thread pool, make sure
          * run pending tasks in a while loop if the thread is idle and waiting for the submitted task,
@@ -120,6 +808,7 @@ namespace mkr {
          * @return Returns true if a task was run. Else, return false.
          * Just because run_pending_task() returns false now, does not mean that another task won't
          * submitted by another thread soon.
+         * If the calling thread is inside a mkr::task_arena of this thread pool, only tasks of that arena are run.
          */
         bool run_pending_task();
 
@@ -132,11 +821,134 @@ namespace mkr {
         template<typename T>
         void run_pending_tasks(const std::future<T>& _future)
         {
+            budget_slot_loan loan{this};
+            while (!is_future_ready(_future)) {
+                run_pending_task();
+            }
+        }
+
+        /**
+         * While a std::shared_future is not ready, run pending tasks.
+         * @tparam T The std::shared_future type.
+         * @param _future The std::shared_future to check if it is ready.
+         * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const std::shared_future<T>& _future)
+        {
+            budget_slot_loan loan{this};
             while (!is_future_ready(_future)) {
                 run_pending_task();
             }
         }
 
+        /**
+         * Wait for a forked task by leapfrogging. While the task has not started, the calling worker runs tasks from its own local
+         * task queue, where the task was pushed. Once another worker has stolen the task, the calling worker only runs tasks from the
+         * thief's local task queue, which are descendants of the stolen task. A waiting worker therefore never picks up unrelated work,
+         * which keeps the depth of its stack bounded by the depth of the task tree, and helps finish the task it is waiting for.
+         * If the calling thread is not a worker thread, it has no local task queue, so it runs the task itself unless a worker has
+         * already started it. A join from outside therefore finishes even while every worker is busy, without nesting unrelated work
+         * on the calling thread's stack. It does not take tasks from the workers, whose joins would then have to wait for it.
+         * @tparam T The result type of the task.
+         * @param _handle The handle of the task. For leapfrogging, it should be joined by the worker which forked it.
+         * @warning The behavior is undefined if _handle.valid()==false before the call to this function.
+         */
+        template<typename T>
+        void run_pending_tasks(const fork_handle<T>& _handle)
+        {
+            budget_slot_loan loan{this};
+            // Inside an arena, forked tasks go to the arena's queue, so help with the arena's tasks only.
+            if (current_arena()) {
+                while (!_handle.is_ready()) {
+                    if (!run_pending_task()) { std::this_thread::yield(); }
+                }
+                return;
+            }
+
+            detail::fork_record& record = *_handle.record_;
+            if (current_thread_pool_!=this) {
+                while (!_handle.is_ready()) {
+                    if (!record.try_run()) { std::this_thread::yield(); }
+                }
+                return;
+            }
+
+            while (!_handle.is_ready()) {
+                const size_t runner = record.runner_.load(std::memory_order_acquire);
+                bool ran;
+                // Only tasks above the forked task, or above the point where the thief started it, are taken.
+                // Everything below belongs to older frames, and running it here would grow the stack with unrelated work.
+                if (runner==detail::fork_record::not_started) {
+                    ran = run_task_from(current_worker_index_, record.position_==0 ? 0 : record.position_-1);
+                }
+                else if (runner==detail::fork_record::external) { ran = run_pending_task(); }
+                else { ran = run_task_from(runner, record.runner_base_.load(std::memory_order_relaxed)); }
+                if (!ran) { std::this_thread::yield(); }
+            }
+        }
+
+        /**
+         * Get the worker index of the calling thread.
+         * @return The worker index of the calling thread. If the calling thread is not a worker thread of this thread pool, a std::nullopt is returned.
+         */
+        std::optional<size_t> worker_index() const
+        {
+            return current_thread_pool_==this ? std::optional<size_t>{current_worker_index_} : std::nullopt;
+        }
+
+        /**
+         * Submit a task to the thread pool without a std::future to wait on.
+         * @tparam Callable The typename of the function or callable object.
+         * @param _func The function or callable object. It is invoked with no arguments and its result is discarded.
+         */
+        template<typename Callable>
+        void post(Callable&& _func)
+        {
+            post(task_tag{}, std::forward<Callable>(_func));
+        }
+
+        /**
+         * Submit a tagged task to the thread pool without a std::future to wait on.
+         * The number of tagged tasks, and their wall time and CPU time, are accounted to the tag. See get_tag_stats().
+         * @tparam Callable The typename of the function or callable object.
+         * @param _tag The tag of the task.
+         * @param _func The function or callable object. It is invoked with no arguments and its result is discarded.
+         */
+        template<typename Callable>
+        void post(task_tag _tag, Callable&& _func)
+        {
+            // Get the worker index of this thread.
+            // If the task was submitted from a non worker thread, it will not have a worker index.
+            // In that case, add the task to the global queue.
+            // Tasks submitted from inside an arena stay in the arena.
+            if (detail::arena_state* arena = current_arena()) {
+                arena->task_queue_.push(make_task(_tag, std::forward<Callable>(_func)));
+                request_worker(arena->task_queue_.size());
+            }
+            else if (current_thread_pool_==this) {
+                request_worker(local_task_queues_[current_worker_index_]->push(make_task(_tag, std::forward<Callable>(_func))));
+            }
+            else {
+                global_task_queue_.push(make_task(_tag, std::forward<Callable>(_func)));
+                request_worker(global_task_queue_.size());
+            }
+        }
+
+        /**
+         * Submit a task to a specific worker thread's local task queue without a std::future to wait on.
+         * This is useful for continuations, which run best on the worker whose cache holds the data they use.
+         * The task may still be stolen by another worker.
+         * @tparam Callable The typename of the function or callable object.
+         * @param _worker_index The index of the worker thread. Must be less than num_threads().
+         * @param _func The function or callable object. It is invoked with no arguments and its result is discarded.
+         */
+        template<typename Callable>
+        void post(size_t _worker_index, Callable&& _func)
+        {
+            request_worker(local_task_queues_[_worker_index]->push(make_task(std::forward<Callable>(_func))));
+        }
+
         /**
          * Submit a task to the thread pool.
          * @tparam Callable The typename of the function or callable object.
@@ -147,6 +959,23 @@ namespace mkr {
          */
         template<typename Callable, typename... Args>
         std::future<std::invoke_result_t<Callable, Args...>> submit(Callable&& _func, Args&& ... _args)
+            requires (!std::same_as<std::decay_t<Callable>, task_tag>)
+        {
+            return submit(task_tag{}, std::forward<Callable>(_func), std::forward<Args>(_args)...);
+        }
+
+        /**
+         * Submit a tagged task to the thread pool.
+         * The number of tagged tasks, and their wall time and CPU time, are accounted to the tag. See get_tag_stats().
+         * @tparam Callable The typename of the function or callable object.
+         * @tparam Args The typename of the function arguments.
+         * @param _tag The tag of the task.
+         * @param _func The function or callable object.
+         * @param _args The function arguments.
+         * @return A std::future which will contain the result of the function.
+         */
+        template<typename Callable, typename... Args>
+        std::future<std::invoke_result_t<Callable, Args...>> submit(task_tag _tag, Callable&& _func, Args&& ... _args)
         {
             typedef std::invoke_result_t<Callable, Args...> result_t;
 
@@ -157,29 +986,663 @@ namespace mkr {
                         return std::invoke(func, args...);
                     }};
             std::future<result_t> result = p_task.get_future();
+            post(_tag, std::move(p_task));
+            return result;
+        }
 
-            // Get the worker index of this thread.
-            // If the task was submitted from a non worker thread, it will not have a worker index.
-            // In that case, add the task to the global queue.
-            std::shared_ptr<size_t> worker_index = worker_index_lookup_.get(std::this_thread::get_id());
-            if (worker_index) {
-                local_task_queues_[*worker_index]->push(task{std::move(p_task)});
+        /**
+         * Queue an operation to be executed by the thread pool. The operation is not copied, and no memory is allocated.
+         * @param _operation The operation. It must stay alive until it has been executed.
+         */
+        void enqueue(operation* _operation);
+
+        /**
+         * Fork a task, to be joined with run_pending_tasks(). Unlike submit(), the returned handle records which worker runs the task,
+         * so that joining it leapfrogs. Recursive fork-join algorithms should prefer fork() over submit().
+         * @tparam Callable The typename of the function or callable object.
+         * @tparam Args The typename of the function arguments.
+         * @param _func The function or callable object.
+         * @param _args The function arguments.
+         * @return A handle to the task.
+         */
+        template<typename Callable, typename... Args>
+        fork_handle<std::invoke_result_t<Callable, Args...>> fork(Callable&& _func, Args&& ... _args)
+        {
+            typedef std::invoke_result_t<Callable, Args...> result_t;
+
+            std::shared_ptr<detail::fork_record> record = std::make_shared<detail::fork_record>();
+            std::packaged_task<result_t(void)> p_task{
+                    [func = std::forward<Callable>(_func),
+                            ...args = std::forward<Args>(_args)]() {
+                        return std::invoke(func, args...);
+                    }};
+            fork_handle<result_t> handle{p_task.get_future(), record};
+            auto run = [this, p_task = std::move(p_task)](detail::fork_record& _record) mutable {
+                if (current_thread_pool_==this) {
+                    _record.runner_base_.store(local_task_queues_[current_worker_index_]->size(), std::memory_order_relaxed);
+                    _record.runner_.store(current_worker_index_, std::memory_order_release);
+                }
+                else {
+                    _record.runner_.store(detail::fork_record::external, std::memory_order_release);
+                }
+                p_task();
+            };
+
+            // The position is recorded before anyone can run the task, as the task holds a reference to the record.
+            if (detail::arena_state* arena = current_arena()) {
+                arena->task_queue_.push(make_task([record, run = std::move(run)]() mutable { run(*record); }));
+                request_worker(arena->task_queue_.size());
+            }
+            else if (current_thread_pool_==this) {
+                task t = make_task([record, run = std::move(run)]() mutable { run(*record); });
+                record->position_ = local_task_queues_[current_worker_index_]->push(std::move(t));
+                request_worker(record->position_);
             }
             else {
-                global_task_queue_.push(task{std::move(p_task)});
+                // The record owns the task, so the task only points back at it. The global task queue holds a claim on it instead.
+                record->claimable_.emplace(make_task([record = record.get(), run = std::move(run)]() mutable { run(*record); }));
+                global_task_queue_.push(task{[record]() { record->try_run(); }});
+                request_worker(global_task_queue_.size());
             }
-
-            return result;
+            return handle;
         }
 
+        /**
+         * Get a scheduler for the thread pool. Senders produced by the scheduler complete on the thread pool.
+         * @return A scheduler for the thread pool.
+         */
+        scheduler get_scheduler();
+
         /**
          * Get the default thread pool.
          * @return The default thread pool.
          */
-        static thread_pool& get_default_thread_pool()
+        static basic_thread_pool& get_default_thread_pool()
         {
-            static thread_pool tp{};
+            static basic_thread_pool tp{};
             return tp;
         }
     };
-}
\ No newline at end of file
+
+    /**
+     * A P2300-style scheduler for mkr::thread_pool. schedule() returns a sender which completes on a thread of the thread pool.
+     * The operation state of the sender is queued on the thread pool intrusively, so scheduling work does not allocate.
+     * See mt/execution/execution.h for the sender algorithms.
+     */
+    template<typename Policies>
+    class basic_thread_pool<Policies>::scheduler {
+    private:
+        /// The thread pool to schedule on.
+        basic_thread_pool* thread_pool_;
+
+        /**
+         * The operation state of a schedule sender connected to a receiver.
+         * @tparam Receiver The typename of the receiver.
+         */
+        template<typename Receiver>
+        class operation_state : public operation {
+        private:
+            /// The thread pool to run on.
+            basic_thread_pool* thread_pool_;
+            /// The receiver to complete.
+            Receiver receiver_;
+
+            static void execute(operation* _operation) noexcept
+            {
+                operation_state* self = static_cast<operation_state*>(_operation);
+                try {
+                    self->receiver_.set_value();
+                }
+                catch (...) {
+                    self->receiver_.set_error(std::current_exception());
+                }
+            }
+
+        public:
+            operation_state(basic_thread_pool* _thread_pool, Receiver&& _receiver)
+                    :operation{&operation_state::execute}, thread_pool_{_thread_pool}, receiver_{std::move(_receiver)} { }
+
+            operation_state(const operation_state&) = delete;
+            operation_state(operation_state&&) = delete;
+            operation_state& operator=(const operation_state&) = delete;
+            operation_state& operator=(operation_state&&) = delete;
+
+            /**
+             * Queue the operation on the thread pool. The receiver's set_value() is invoked on a thread of the thread pool.
+             */
+            void start() noexcept { thread_pool_->enqueue(this); }
+        };
+
+        /**
+         * A sender which completes with no values on a thread of the thread pool.
+         */
+        class sender {
+        private:
+            /// The thread pool to run on.
+            basic_thread_pool* thread_pool_;
+
+        public:
+            /// The type of the value sent. A schedule sender sends no values.
+            typedef void value_type;
+
+            explicit sender(basic_thread_pool* _thread_pool)
+                    :thread_pool_{_thread_pool} { }
+
+            /**
+             * Connect the sender to a receiver.
+             * @tparam Receiver The typename of the receiver.
+             * @param _receiver The receiver.
+             * @return The operation state. It is not copyable or movable, and must be started to run.
+             */
+            template<typename Receiver>
+            operation_state<std::decay_t<Receiver>> connect(Receiver&& _receiver) const
+            {
+                return operation_state<std::decay_t<Receiver>>{thread_pool_, std::decay_t<Receiver>{std::forward<Receiver>(_receiver)}};
+            }
+
+            /**
+             * @return The scheduler on which the sender completes.
+             */
+            scheduler get_completion_scheduler() const { return scheduler{*thread_pool_}; }
+        };
+
+    public:
+        /**
+         * Constructs the scheduler.
+         * @param _thread_pool The thread pool to schedule on.
+         */
+        explicit scheduler(basic_thread_pool& _thread_pool)
+                :thread_pool_{&_thread_pool} { }
+
+        /**
+         * @return A sender which completes on a thread of the thread pool.
+         */
+        sender schedule() const { return sender{thread_pool_}; }
+
+        /**
+         * @return The thread pool of the scheduler.
+         */
+        basic_thread_pool& get_thread_pool() const { return *thread_pool_; }
+
+        bool operator==(const scheduler&) const = default;
+    };
+
+    template<typename Policies>
+    inline typename basic_thread_pool<Policies>::scheduler basic_thread_pool<Policies>::get_scheduler() { return scheduler{*this}; }
+
+    template<typename Policies>
+    basic_thread_pool<Policies>::basic_thread_pool(size_t _num_threads, worker_startup _startup)
+            :num_threads_{std::max<size_t>(_num_threads, 1)}, end_flag_{false}, start_flag_{1},
+             counters_(num_threads_+1), start_time_{detail::steady_time()}, tag_tables_(enable_stats ? num_threads_+1 : 0)
+    {
+        worker_threads_.resize(num_threads_);
+        try {
+            // Create the worker threads.
+            for (size_t i = 0; i<num_threads_; ++i) {
+                local_task_queues_.push_back(std::make_shared<local_queue_type>());
+                if (_startup==worker_startup::eager) {
+                    ++num_idle_threads_;
+                    worker_threads_[i] = std::thread{&basic_thread_pool::worker_thread_func, this, i};
+                    num_started_threads_.store(i+1, std::memory_order_relaxed);
+                }
+            }
+
+            // Create the local task queues BEFORE starting the threads so that the threads do not try to pop a non-existent queue.
+            start_flag_.count_down();
+        }
+        catch (...) {
+            // Set end_flag_ = true before decreasing the counter on latch, so that the worker threads do not enter the while loop.
+            end_flag_ = true;
+            start_flag_.count_down();
+            // The destructor is not run, so the threads already created must be joined here.
+            for (std::thread& worker_thread : worker_threads_) {
+                if (worker_thread.joinable()) { worker_thread.join(); }
+            }
+            throw;
+        }
+    }
+
+    template<typename Policies>
+    basic_thread_pool<Policies>::~basic_thread_pool()
+    {
+        end_flag_ = true;
+        // Wait for a worker thread being created, after which no more are.
+        std::lock_guard lock{start_mutex_};
+        for (std::thread& worker_thread : worker_threads_) {
+            if (worker_thread.joinable()) { worker_thread.join(); }
+        }
+    }
+
+    template<typename Policies>
+    void basic_thread_pool<Policies>::start_worker()
+    {
+        // If another thread is creating a worker, the next task pushed behind a waiting one asks again.
+        std::unique_lock lock{start_mutex_, std::try_to_lock};
+        if (!lock.owns_lock() || end_flag_.load()) { return; }
+
+        const size_t index = num_started_threads_.load(std::memory_order_relaxed);
+        if (index==num_threads_) { return; }
+        // The new worker counts as idle until it looks for work, so that the tasks queued meanwhile do not create more workers.
+        ++num_idle_threads_;
+        try {
+            worker_threads_[index] = std::thread{&basic_thread_pool::worker_thread_func, this, index};
+        }
+        catch (...) {
+            --num_idle_threads_;
+            // Without any worker thread, the tasks would never run. With some, the thread pool just stays smaller.
+            if (index==0) { throw; }
+            return;
+        }
+        num_started_threads_.store(index+1, std::memory_order_relaxed);
+    }
+
+    template<typename Policies>
+    std::shared_ptr<task> basic_thread_pool<Policies>::get_local_task(size_t _index)
+    {
+        return local_task_queues_[_index]->try_pop();
+    }
+
+    template<typename Policies>
+    std::shared_ptr<task> basic_thread_pool<Policies>::get_global_task()
+    {
+        return global_task_queue_.try_pop();
+    }
+
+    template<typename Policies>
+    std::shared_ptr<task> basic_thread_pool<Policies>::steal_task(size_t _index)
+    {
+        // The victims are the other workers, in order from the one after the thief. The steal policy picks where to start.
+        const bool is_worker = _index<num_threads_;
+        const size_t num_victims = is_worker ? num_threads_-1 : num_threads_;
+        const size_t first_victim = steal_policy::first_victim(_index, num_victims);
+        for (size_t i = 0; i<num_victims; ++i) {
+            const size_t victim = ((is_worker ? _index+1 : 0)+(first_victim+i)%num_victims)%num_threads_;
+            std::shared_ptr<task> stolen_task = local_task_queues_[victim]->try_pop();
+            if (stolen_task) {
+                MKR_TRACE(task_steal, this, _index, victim);
+                return stolen_task;
+            }
+        }
+        return nullptr;
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::run_local_task(size_t _index)
+    {
+        std::shared_ptr<task> local_task = get_local_task(_index);
+        if (local_task) {
+            local_task->operator()();
+            return true;
+        }
+        return false;
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::run_global_task()
+    {
+        std::shared_ptr<task> global_task = get_global_task();
+        if (global_task) {
+            global_task->operator()();
+            return true;
+        }
+        return false;
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::run_operation()
+    {
+        if (num_operations_.load()==0) { return false; }
+
+        operation* op;
+        {
+            std::lock_guard lock{operation_mutex_};
+            op = operation_head_;
+            if (!op) { return false; }
+            operation_head_ = op->next_;
+            if (!operation_head_) { operation_tail_ = nullptr; }
+            --num_operations_;
+        }
+        if constexpr (enable_stats) { counters().num_tasks_run_.fetch_add(1, std::memory_order_relaxed); }
+        op->execute_(op);
+        return true;
+    }
+
+    template<typename Policies>
+    void basic_thread_pool<Policies>::enqueue(operation* _operation)
+    {
+        _operation->next_ = nullptr;
+        std::lock_guard lock{operation_mutex_};
+        if (operation_tail_) { operation_tail_->next_ = _operation; }
+        else { operation_head_ = _operation; }
+        operation_tail_ = _operation;
+        request_worker(++num_operations_);
+    }
+
+    template<typename Policies>
+    void basic_thread_pool<Policies>::run_in_arena(detail::arena_state& _arena, task& _task)
+    {
+        detail::arena_state* outer_arena = current_arena_;
+        const long long outer_nested_arena_cpu_time_ = nested_arena_cpu_time_;
+        current_arena_ = &_arena;
+        nested_arena_cpu_time_ = 0;
+        const long long start_time = static_cast<long long>(detail::thread_cpu_time());
+
+        _task();
+
+        const long long total_time = static_cast<long long>(detail::thread_cpu_time())-start_time;
+        const long long own_time = total_time-nested_arena_cpu_time_;
+        current_arena_ = outer_arena;
+        nested_arena_cpu_time_ = outer_nested_arena_cpu_time_+total_time;
+
+        _arena.cpu_time_ += own_time;
+        _arena.deficit_ -= own_time;
+        ++_arena.num_tasks_run_;
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::run_task_in(detail::arena_state& _arena)
+    {
+        std::shared_ptr<task> arena_task = _arena.task_queue_.try_pop();
+        if (!arena_task) { return false; }
+        run_in_arena(_arena, *arena_task);
+        return true;
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::run_arena_task()
+    {
+        if (num_arenas_.load()==0) { return false; }
+
+        detail::arena_state* arena = nullptr;
+        std::shared_ptr<task> arena_task;
+        {
+            // The slot is taken while holding the lock, so that an arena being detached sees this worker in num_active_workers_.
+            std::lock_guard lock{arena_mutex_};
+
+            // Deficit round robin: the arena at next_arena_ is served while it has credit left, then the next one is.
+            // When no arena with tasks has credit left, every arena with tasks is given credit in proportion to its weight.
+            // An arena without tasks loses its credit, so that an idle arena does not save up a burst, and the busy ones get all the workers.
+            for (int round = 0; round<2 && !arena; ++round) {
+                bool has_tasks = false;
+                for (size_t i = 0; i<arenas_.size() && !arena; ++i) {
+                    const size_t index = (next_arena_+i)%arenas_.size();
+                    detail::arena_state* candidate = arenas_[index];
+                    if (candidate->task_queue_.empty()) {
+                        candidate->deficit_.store(0);
+                        continue;
+                    }
+                    has_tasks = true;
+                    if (candidate->deficit_.load()<=0) { continue; }
+                    if (candidate->num_active_workers_.fetch_add(1)>=candidate->max_concurrency_) {
+                        --candidate->num_active_workers_;
+                        continue;
+                    }
+                    arena_task = candidate->task_queue_.try_pop();
+                    if (!arena_task) {
+                        --candidate->num_active_workers_;
+                        continue;
+                    }
+                    arena = candidate;
+                    next_arena_ = index;
+                }
+
+                if (!arena && has_tasks) {
+                    for (detail::arena_state* candidate : arenas_) {
+                        if (!candidate->task_queue_.empty() && candidate->deficit_.load()<=0) {
+                            candidate->deficit_ += static_cast<long long>(candidate->weight_)*detail::arena_state::quantum;
+                        }
+                    }
+                    next_arena_ = (next_arena_+1)%arenas_.size();
+                }
+            }
+        }
+        if (!arena) { return false; }
+
+        run_in_arena(*arena, *arena_task);
+        --arena->num_active_workers_;
+        return true;
+    }
+
+    template<typename Policies>
+    void basic_thread_pool<Policies>::attach(detail::arena_state* _arena)
+    {
+        std::lock_guard lock{arena_mutex_};
+        arenas_.push_back(_arena);
+        ++num_arenas_;
+    }
+
+    template<typename Policies>
+    void basic_thread_pool<Policies>::detach(detail::arena_state* _arena)
+    {
+        std::lock_guard lock{arena_mutex_};
+        arenas_.erase(std::find(arenas_.begin(), arenas_.end(), _arena));
+        next_arena_ = 0;
+        --num_arenas_;
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::run_task_from(size_t _victim, size_t _size)
+    {
+        std::shared_ptr<task> stolen_task = local_task_queues_[_victim]->try_pop_if_size_above(_size);
+        if (stolen_task) {
+            if (current_thread_pool_!=this || current_worker_index_!=_victim) {
+                if constexpr (enable_stats) { counters().num_tasks_stolen_.fetch_add(1, std::memory_order_relaxed); }
+                MKR_TRACE(task_steal, this, current_thread_pool_==this ? current_worker_index_ : num_threads_, _victim);
+            }
+            stolen_task->operator()();
+            return true;
+        }
+        return false;
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::run_stolen_task(size_t _index)
+    {
+        std::shared_ptr<task> stolen_task = steal_task(_index);
+        if (stolen_task) {
+            if constexpr (enable_stats) { counters().num_tasks_stolen_.fetch_add(1, std::memory_order_relaxed); }
+            stolen_task->operator()();
+            return true;
+        }
+        return false;
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::has_pending_task() const
+    {
+        if (!global_task_queue_.empty() || num_operations_.load()!=0) { return true; }
+        for (const std::shared_ptr<local_queue_type>& local_task_queue : local_task_queues_) {
+            if (!local_task_queue->empty()) { return true; }
+        }
+        // An arena without tasks is not work, or idle workers would spin on CPU budget slots for as long as it exists.
+        if (num_arenas_.load()!=0) {
+            std::lock_guard lock{arena_mutex_};
+            for (const detail::arena_state* arena : arenas_) {
+                if (!arena->task_queue_.empty()) { return true; }
+            }
+        }
+        return false;
+    }
+
+    template<typename Policies>
+    void basic_thread_pool<Policies>::worker_thread_func(size_t _index)
+    {
+        start_flag_.wait();
+
+        current_thread_pool_ = this;
+        current_worker_index_ = _index;
+        const size_t worker_index = _index;
+        cpu_budget& budget = cpu_budget::get_instance();
+        detail::worker_counters& worker_counters = counters_[worker_index];
+        idle_policy idle_strategy{};
+        bool has_slot = false;
+        bool waiting = false;
+        holds_budget_slot_ = &has_slot;
+
+        // The clock is only read when the worker goes idle or becomes busy, not for every task.
+        // The worker was counted as idle when it was created.
+        bool idle = true;
+        if constexpr (enable_stats) { worker_counters.idle_since_.store(detail::steady_time(), std::memory_order_relaxed); }
+        auto set_idle = [&](bool _idle) {
+            if (idle==_idle) { return; }
+            idle = _idle;
+            if (_idle) {
+                ++num_idle_threads_;
+                MKR_TRACE(worker_park, this, worker_index);
+                if constexpr (enable_stats) { worker_counters.idle_since_.store(detail::steady_time(), std::memory_order_relaxed); }
+            }
+            else {
+                --num_idle_threads_;
+                MKR_TRACE(worker_unpark, this, worker_index);
+                if constexpr (enable_stats) {
+                    worker_counters.idle_time_.fetch_add(detail::steady_time()-worker_counters.idle_since_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                    worker_counters.idle_since_.store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        while (!end_flag_.load()) {
+            // Only take a CPU slot when there is something to do, so that an idle thread pool lends its slots to busy ones.
+            if (!has_slot) {
+                if (!has_pending_task()) {
+                    set_idle(true);
+                    idle_strategy.idle();
+                    continue;
+                }
+                if (!budget.try_acquire()) {
+                    if (!waiting) { budget.set_waiting(waiting = true); }
+                    set_idle(true);
+                    idle_strategy.idle();
+                    continue;
+                }
+                has_slot = true;
+                if (waiting) { budget.set_waiting(waiting = false); }
+            }
+
+            set_idle(false);
+            if (!run_local_task(worker_index) &&
+                    !run_global_task() &&
+                    !run_operation() &&
+                    !run_arena_task() &&
+                    !run_stolen_task(worker_index)) {
+                budget.release();
+                has_slot = false;
+                set_idle(true);
+                // If no task was run, let the idle strategy decide whether to give another thread which may have work priority.
+                idle_strategy.idle();
+            }
+            else {
+                idle_strategy.reset();
+                if (budget.num_waiting()!=0 || budget.num_active()>budget.limit()) {
+                    // Hand the slot over between tasks, so that a busy thread pool does not starve the others.
+                    budget.release();
+                    has_slot = false;
+                }
+            }
+        }
+
+        set_idle(false);
+        holds_budget_slot_ = nullptr;
+        if (has_slot) { budget.release(); }
+        if (waiting) { budget.set_waiting(false); }
+    }
+
+    template<typename Policies>
+    bool basic_thread_pool<Policies>::run_pending_task()
+    {
+        // Inside an arena, only the arena's tasks are run, so that a wait inside the arena never picks up outer work.
+        if (detail::arena_state* arena = current_arena()) {
+            return run_task_in(*arena);
+        }
+
+        if (current_thread_pool_==this) {
+            return run_local_task(current_worker_index_) || run_global_task() || run_operation() || run_arena_task() ||
+                   run_stolen_task(current_worker_index_);
+        }
+
+        return run_global_task() || run_operation() || run_arena_task() || run_stolen_task(num_threads_);
+    }
+
+    template<typename Policies>
+    thread_pool_stats basic_thread_pool<Policies>::get_stats() const
+    {
+        thread_pool_stats stats;
+        stats.num_threads_ = num_threads_;
+        stats.global_queue_depth_ = global_task_queue_.size();
+        for (const std::shared_ptr<local_queue_type>& local_task_queue : local_task_queues_) {
+            stats.local_queue_depths_.push_back(local_task_queue->size());
+        }
+        stats.num_operations_ = num_operations_.load();
+        {
+            std::lock_guard lock{arena_mutex_};
+            for (const detail::arena_state* arena : arenas_) { stats.arena_queue_depth_ += arena->task_queue_.size(); }
+        }
+        if constexpr (enable_stats) {
+            const uint64_t now = detail::steady_time();
+            uint64_t idle_time = 0;
+            uint64_t latency_sum = 0;
+            const detail::worker_counters* counters = counters_.allocated();
+            for (size_t i = 0; i<counters_.size(); ++i) {
+                // Until a thread touches the counters, every worker has been idle all along.
+                if (!counters) {
+                    if (i<num_threads_) { idle_time += now-start_time_; }
+                    continue;
+                }
+                const detail::worker_counters& c = counters[i];
+                stats.num_tasks_run_ += c.num_tasks_run_.load(std::memory_order_relaxed);
+                stats.num_tasks_stolen_ += c.num_tasks_stolen_.load(std::memory_order_relaxed);
+                latency_sum += c.latency_sum_.load(std::memory_order_relaxed);
+                for (size_t b = 0; b<detail::num_latency_buckets; ++b) {
+                    const uint64_t count = c.latency_buckets_[b].load(std::memory_order_relaxed);
+                    stats.latency_buckets_[b] += count;
+                    stats.latency_count_ += count;
+                }
+
+                // Only worker threads count towards the idle fraction. A worker which is idle now has not added the current period yet.
+                // A worker which has not been created yet has been idle all along.
+                if (i>=num_started_threads_.load(std::memory_order_relaxed) && i<num_threads_) {
+                    idle_time += now-start_time_;
+                }
+                else if (i<num_threads_) {
+                    idle_time += c.idle_time_.load(std::memory_order_relaxed);
+                    const uint64_t idle_since = c.idle_since_.load(std::memory_order_relaxed);
+                    if (idle_since!=0 && now>idle_since) { idle_time += now-idle_since; }
+                }
+            }
+
+            const double elapsed = static_cast<double>(now-start_time_)*static_cast<double>(num_threads_);
+            stats.idle_fraction_ = elapsed>0.0 ? std::min(static_cast<double>(idle_time)/elapsed, 1.0) : 0.0;
+            stats.latency_sum_ = static_cast<double>(latency_sum)*1e-9;
+        }
+        return stats;
+    }
+
+    template<typename Policies>
+    std::vector<task_tag_stats> basic_thread_pool<Policies>::get_tag_stats() const
+    {
+        std::vector<task_tag_stats> stats;
+        const detail::tag_table* tables = tag_tables_.allocated();
+        if (!tables) { return stats; }
+        for (size_t id = 1; id<task_tag::max_tags; ++id) {
+            task_tag_stats tag_stats{task_tag::from_id(id)};
+            uint64_t wall_time = 0;
+            uint64_t cpu_time = 0;
+            for (size_t i = 0; i<tag_tables_.size(); ++i) {
+                const detail::tag_counters& c = tables[i].tags_[id];
+                tag_stats.num_tasks_ += c.num_tasks_.load(std::memory_order_relaxed);
+                wall_time += c.wall_time_.load(std::memory_order_relaxed);
+                cpu_time += c.cpu_time_.load(std::memory_order_relaxed);
+            }
+            if (tag_stats.num_tasks_==0) { continue; }
+            tag_stats.wall_time_ = std::chrono::nanoseconds{wall_time};
+            tag_stats.cpu_time_ = std::chrono::nanoseconds{cpu_time};
+            stats.push_back(tag_stats);
+        }
+        return stats;
+    }
+
+    // mkr::thread_pool is compiled once, into the library.
+    extern template class basic_thread_pool<thread_pool_policies>;
+
+    static_assert(executor<thread_pool>);
+}
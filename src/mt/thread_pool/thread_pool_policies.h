@@ -0,0 +1,161 @@
+#pragma once
+
+#include "task.h"
+#include "../container/threadsafe_queue.h"
+#include "../container/threadsafe_stack.h"
+
+#include <algorithm>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace mkr {
+    /**
+     * A task queue which can be a worker thread's local task queue in a mkr::basic_thread_pool.
+     * push() returns the size of the queue after the push, which fork() records so that a joining worker knows which tasks are above
+     * the forked one, and try_pop_if_size_above() lets a joining worker take only those tasks.
+     */
+    template<typename Q>
+    concept local_task_queue = requires(Q& _queue, const Q& _const_queue, task&& _task, size_t _size)
+    {
+        { _queue.push(std::move(_task)) } -> std::convertible_to<size_t>;
+        { _queue.try_pop() } -> std::same_as<std::shared_ptr<task>>;
+        { _queue.try_pop_if_size_above(_size) } -> std::same_as<std::shared_ptr<task>>;
+        { _const_queue.size() } -> std::convertible_to<size_t>;
+        { _const_queue.empty() } -> std::convertible_to<bool>;
+    };
+
+    /**
+     * A task queue which can be the global task queue of a mkr::basic_thread_pool.
+     */
+    template<typename Q>
+    concept global_task_queue = requires(Q& _queue, const Q& _const_queue, task&& _task)
+    {
+        _queue.push(std::move(_task));
+        { _queue.try_pop() } -> std::same_as<std::shared_ptr<task>>;
+        { _const_queue.size() } -> std::convertible_to<size_t>;
+        { _const_queue.empty() } -> std::convertible_to<bool>;
+    };
+
+    /**
+     * An idle strategy which yields the CPU every time a worker finds nothing to do. Idle workers wake up as soon as work arrives,
+     * but keep their CPUs busy when nothing else wants them.
+     */
+    struct yield_idle {
+        void idle() { std::this_thread::yield(); }
+        void reset() { }
+    };
+
+    /**
+     * An idle strategy which spins without giving up the CPU. It has the lowest wake-up latency, but each idle worker burns a whole CPU,
+     * so it only suits a thread pool which has CPUs to itself.
+     */
+    struct spin_idle {
+        void idle()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#elif defined(__aarch64__)
+            asm volatile("yield");
+#endif
+        }
+        void reset() { }
+    };
+
+    /**
+     * An idle strategy which spins, then yields, then sleeps for longer and longer, until work arrives.
+     * A thread pool which is idle for long uses almost no CPU, at the cost of up to a millisecond of wake-up latency.
+     */
+    struct backoff_idle {
+        /// The number of idle() calls which spin.
+        static constexpr uint32_t num_spins = 64;
+        /// The number of idle() calls which spin or yield.
+        static constexpr uint32_t num_yields = 128;
+        /// The longest sleep.
+        static constexpr std::chrono::microseconds max_sleep{1000};
+
+        /// The number of idle() calls since the last reset().
+        uint32_t num_idles_ = 0;
+
+        void idle()
+        {
+            if (num_idles_<num_spins) { spin_idle{}.idle(); }
+            else if (num_idles_<num_yields) { std::this_thread::yield(); }
+            else {
+                // The sleep doubles every time, from 1us up to max_sleep.
+                const uint32_t shift = std::min<uint32_t>(num_idles_-num_yields, 10);
+                std::this_thread::sleep_for(std::min(std::chrono::microseconds{1 << shift}, max_sleep));
+            }
+            ++num_idles_;
+        }
+
+        void reset() { num_idles_ = 0; }
+    };
+
+    /**
+     * A steal policy which tries the other workers in order, starting with the next one. It is deterministic and has no state.
+     */
+    struct round_robin_steal {
+        /**
+         * @param _thief The index of the stealing worker.
+         * @param _num_victims The number of other workers.
+         * @return The offset, from the worker after the thief, of the first worker to steal from.
+         */
+        static size_t first_victim(size_t, size_t) { return 0; }
+    };
+
+    /**
+     * A steal policy which starts at a random worker, so that thieves do not all hit the same victim first.
+     */
+    struct random_steal {
+        /**
+         * @param _thief The index of the stealing worker.
+         * @param _num_victims The number of other workers.
+         * @return The offset, from the worker after the thief, of the first worker to steal from.
+         */
+        static size_t first_victim(size_t _thief, size_t _num_victims)
+        {
+            thread_local std::minstd_rand rng{static_cast<std::minstd_rand::result_type>(_thief+1)};
+            return _num_victims==0 ? 0 : rng()%_num_victims;
+        }
+    };
+
+    /**
+     * The scheduling policies of a mkr::basic_thread_pool, which are fixed at compile time. These are the policies of mkr::thread_pool.
+     * To change some of them, derive from this and hide the ones to change, such as:
+     *
+     * struct quiet_policies : thread_pool_policies {
+     *     typedef backoff_idle idle_policy;
+     *     static constexpr bool enable_stats = false;
+     * };
+     * basic_thread_pool<quiet_policies> tp{4};
+     */
+    struct thread_pool_policies {
+        /// The worker threads' local task queues. It must satisfy mkr::local_task_queue. A LIFO stack keeps recently pushed tasks' data warm.
+        template<typename T>
+        using local_queue = threadsafe_stack<T>;
+
+        /// The global task queue, which tasks submitted from outside the thread pool go to. It must satisfy mkr::global_task_queue.
+        template<typename T>
+        using global_queue = threadsafe_queue<T>;
+
+        /// What a worker does each time it finds nothing to do. See mkr::yield_idle, mkr::spin_idle and mkr::backoff_idle.
+        typedef yield_idle idle_policy;
+
+        /**
+         * Whether the thread pool counts tasks, steals, idle time, queueing latency and tag time, and publishes running tasks.
+         * Without stats, get_stats() only reports queue depths, get_tag_stats() is empty, and a mkr::thread_pool_watchdog sees no tasks.
+         * The tracepoints fire either way.
+         */
+        static constexpr bool enable_stats = true;
+
+        /// Which worker a worker with nothing to do steals from first. See mkr::round_robin_steal and mkr::random_steal.
+        typedef round_robin_steal steal_policy;
+    };
+}
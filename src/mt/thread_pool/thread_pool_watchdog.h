@@ -0,0 +1,151 @@
+#pragma once
+
+#include "thread_pool.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mkr {
+    /**
+     * A task which has been running for longer than a mkr::thread_pool_watchdog's threshold.
+     */
+    struct stalled_task {
+        /// The index of the worker thread running the task.
+        size_t worker_index_ = 0;
+        /// The tag of the task.
+        task_tag tag_;
+        /// How long the task has been running.
+        std::chrono::nanoseconds running_time_{0};
+    };
+
+    /**
+     * A thread which periodically samples the start time and tag of the task each worker of a thread pool is running, and reports tasks
+     * which have been running for longer than a threshold. A hung task silently takes a worker out of the thread pool, and with
+     * enough of them throughput collapses, so the stall is reported while it is happening rather than found afterwards.
+     *
+     * The workers publish the start time and tag of each task with a single relaxed store, and the watchdog only reads it, so watching
+     * costs the workers nothing else. A stalled task is reported once. A task which runs other tasks while it waits counts as
+     * running those tasks until they finish.
+     *
+     * Additional Notes:
+     * - The handler runs on the watchdog thread. It may, for example, log the stall, raise an alert, or grow a compensating thread pool.
+     * - The watchdog must be destroyed before the thread pool.
+     * - thread_pool_watchdog is non-copyable AND non-movable.
+     */
+    class thread_pool_watchdog {
+    public:
+        /// The function invoked with each stalled task.
+        typedef std::function<void(const stalled_task&)> handler;
+
+    private:
+        /// The thread pool to watch.
+        const thread_pool& thread_pool_;
+        /// Tasks running for longer than this are reported.
+        const std::chrono::nanoseconds threshold_;
+        /// The time between samples.
+        const std::chrono::nanoseconds interval_;
+        /// The function invoked with each stalled task.
+        const handler on_stall_;
+        /// Protects reported_start_times_.
+        std::mutex check_mutex_;
+        /// The start time of the last task reported for each worker thread, so that each stall is reported once.
+        std::vector<uint64_t> reported_start_times_;
+        /// Protects end_flag_.
+        std::mutex mutex_;
+        /// Wakes up the watchdog thread to stop.
+        std::condition_variable cond_;
+        /// A flag to signal the watchdog thread to stop.
+        bool end_flag_ = false;
+        /// The watchdog thread.
+        std::thread watchdog_thread_;
+
+        /**
+         * Watchdog thread function.
+         */
+        void watchdog_thread_func()
+        {
+            std::unique_lock lock{mutex_};
+            while (!cond_.wait_for(lock, interval_, [this]() { return end_flag_; })) {
+                lock.unlock();
+                for (const stalled_task& stall : check()) { on_stall_(stall); }
+                lock.lock();
+            }
+        }
+
+    public:
+        /**
+         * Print a stalled task to std::cerr.
+         * @param _stall The stalled task.
+         */
+        static void report_to_stderr(const stalled_task& _stall)
+        {
+            std::cerr << "mkr::thread_pool_watchdog: worker " << _stall.worker_index_ << " has been running a task"
+                      << (_stall.tag_.empty() ? std::string{} : " tagged \""+_stall.tag_.name()+"\"") << " for "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(_stall.running_time_).count() << "ms" << std::endl;
+        }
+
+        /**
+         * Constructs the watchdog, and starts its thread.
+         * @param _thread_pool The thread pool to watch.
+         * @param _threshold Tasks running for longer than this are reported.
+         * @param _on_stall The function invoked on the watchdog thread with each stalled task.
+         * @param _interval The time between samples. If 0, a quarter of the threshold, but at least a millisecond.
+         */
+        thread_pool_watchdog(const thread_pool& _thread_pool, std::chrono::nanoseconds _threshold, handler _on_stall = &report_to_stderr,
+                             std::chrono::nanoseconds _interval = std::chrono::nanoseconds{0})
+                :thread_pool_{_thread_pool}, threshold_{_threshold},
+                 interval_{_interval.count()>0 ? _interval : std::max<std::chrono::nanoseconds>(_threshold/4, std::chrono::milliseconds{1})},
+                 on_stall_{std::move(_on_stall)}, reported_start_times_(_thread_pool.num_threads(), 0)
+        {
+            watchdog_thread_ = std::thread{&thread_pool_watchdog::watchdog_thread_func, this};
+        }
+
+        /**
+         * Destructs the watchdog, and stops its thread.
+         */
+        ~thread_pool_watchdog()
+        {
+            {
+                std::lock_guard lock{mutex_};
+                end_flag_ = true;
+            }
+            cond_.notify_one();
+            watchdog_thread_.join();
+        }
+
+        thread_pool_watchdog(const thread_pool_watchdog&) = delete;
+        thread_pool_watchdog(thread_pool_watchdog&&) = delete;
+        thread_pool_watchdog& operator=(const thread_pool_watchdog&) = delete;
+        thread_pool_watchdog& operator=(thread_pool_watchdog&&) = delete;
+
+        inline std::chrono::nanoseconds threshold() const { return threshold_; }
+
+        /**
+         * Sample the workers once.
+         * @return The tasks which have been running for longer than the threshold, and have not been reported before.
+         */
+        std::vector<stalled_task> check()
+        {
+            std::vector<stalled_task> stalls;
+            std::lock_guard lock{check_mutex_};
+            const uint64_t now = detail::steady_time();
+            for (size_t i = 0; i<reported_start_times_.size(); ++i) {
+                const std::optional<running_task_info> task = thread_pool_.running_task(i);
+                if (!task || task->start_time_==reported_start_times_[i] || now<task->start_time_) { continue; }
+
+                const std::chrono::nanoseconds running_time{now-task->start_time_};
+                if (running_time>threshold_) {
+                    reported_start_times_[i] = task->start_time_;
+                    stalls.push_back(stalled_task{i, task->tag_, running_time});
+                }
+            }
+            return stalls;
+        }
+    };
+}
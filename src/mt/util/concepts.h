@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <concepts>
+#include <future>
 
 namespace mkr {
     template<class T, class U>
@@ -26,4 +27,31 @@ namespace mkr {
     {
         { std::invoke(_function, _args...) } -> mkr::not_same_as<void>;
     };
+
+    namespace detail {
+        /// A function with no arguments, used to check that an executor accepts functions.
+        struct nullary_function {
+            void operator()() const { }
+        };
+    }
+
+    /**
+     * An executor runs submitted functions, possibly concurrently, and lets a caller that waits for one of them help by running pending functions.
+     * mkr::thread_pool, mkr::inline_executor, mkr::strand and mkr::manual_executor are executors.
+     *
+     * - post(f) runs f at some point, and discards its result.
+     * - submit(f) runs f at some point, and returns a std::future of its result.
+     * - run_pending_task() runs a pending function if there is one, and returns whether it did.
+     * - run_pending_tasks(future) runs pending functions until the future is ready.
+     * - num_threads() is the number of threads, besides the callers, that run the functions. Algorithms use it to decide how finely to split their work.
+     */
+    template<class E>
+    concept executor = requires(E& _executor, detail::nullary_function _func, const std::future<void>& _future)
+    {
+        _executor.post(_func);
+        { _executor.submit(_func) } -> std::same_as<std::future<void>>;
+        { _executor.run_pending_task() } -> std::convertible_to<bool>;
+        _executor.run_pending_tasks(_future);
+        { _executor.num_threads() } -> std::convertible_to<std::size_t>;
+    };
 }
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <future>
+
+namespace mkr {
+    /**
+     * Checks if a std::future is ready.
+     * @tparam T The data type of the std::future.
+     * @param _future The std::future to check.
+     * @return Returns true if the std::future is ready. Else, returns false.
+     * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+     */
+    template<typename T>
+    bool is_future_ready(const std::future<T>& _future)
+    {
+        return _future.wait_for(std::chrono::milliseconds(0))==std::future_status::ready;
+    }
+
+    /**
+     * Checks if a std::shared_future is ready.
+     * @tparam T The data type of the std::shared_future.
+     * @param _future The std::shared_future to check.
+     * @return Returns true if the std::shared_future is ready. Else, returns false.
+     * @warning The behavior is undefined if _future.valid()==false before the call to this function.
+     */
+    template<typename T>
+    bool is_future_ready(const std::shared_future<T>& _future)
+    {
+        return _future.wait_for(std::chrono::milliseconds(0))==std::future_status::ready;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace mkr {
+    /**
+     * The assumed size of a cache line. Data written by different threads should be at least this far apart to avoid false sharing.
+     * std::hardware_destructive_interference_size is not used, because its value may differ between compilers and flags, which would
+     * change the layout of types in headers.
+     */
+    constexpr std::size_t cache_line_size = 64;
+
+    /// The L2 cache size assumed when the operating system does not report one.
+    constexpr std::size_t default_l2_cache_size = 256*1024;
+
+    /**
+     * Query the size of the L2 cache of the current CPU.
+     * @return The size of the L2 cache in bytes. If the size cannot be determined, default_l2_cache_size is returned.
+     */
+    inline std::size_t l2_cache_size()
+    {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        long size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        if (size>0) { return static_cast<std::size_t>(size); }
+#endif
+        return default_l2_cache_size;
+    }
+
+    namespace detail {
+        /**
+         * Read the first line of a file.
+         * @param _path The path of the file.
+         * @return The first line of the file, or std::nullopt if the file cannot be read.
+         */
+        inline std::optional<std::string> read_first_line(const std::string& _path)
+        {
+            std::ifstream file{_path};
+            std::string line;
+            if (!file || !std::getline(file, line)) { return std::nullopt; }
+            return line;
+        }
+
+        /**
+         * Count the CPUs in a Linux CPU list, such as "0-3,8,10-11".
+         * @param _cpu_list The CPU list.
+         * @return The number of CPUs in the list, or 0 if it cannot be parsed.
+         */
+        inline std::size_t parse_cpu_list(const std::string& _cpu_list)
+        {
+            std::size_t count = 0;
+            std::stringstream list{_cpu_list};
+            std::string range;
+            while (std::getline(list, range, ',')) {
+                if (range.find_first_not_of(" \t\n")==std::string::npos) { continue; }
+                try {
+                    const std::size_t dash = range.find('-');
+                    const std::size_t first = std::stoul(range.substr(0, dash));
+                    const std::size_t last = dash==std::string::npos ? first : std::stoul(range.substr(dash+1));
+                    if (last<first) { return 0; }
+                    count += last-first+1;
+                }
+                catch (...) {
+                    return 0;
+                }
+            }
+            return count;
+        }
+
+        /**
+         * Convert a CFS quota to a number of CPUs, rounding up.
+         * @param _quota The CPU time the group may use per period, in microseconds. A negative value means no limit.
+         * @param _period The length of a period, in microseconds.
+         * @return The number of CPUs, or 0 if there is no limit.
+         */
+        inline std::size_t cpus_from_quota(long _quota, long _period)
+        {
+            if (_quota<=0 || _period<=0) { return 0; }
+            return static_cast<std::size_t>((_quota+_period-1)/_period);
+        }
+
+        /**
+         * Parse the contents of a cgroup v2 cpu.max file, such as "400000 100000" or "max 100000".
+         * @param _cpu_max The contents of the file.
+         * @return The number of CPUs, or 0 if there is no limit or the contents cannot be parsed.
+         */
+        inline std::size_t parse_cpu_max(const std::string& _cpu_max)
+        {
+            std::stringstream fields{_cpu_max};
+            std::string quota;
+            long period = 0;
+            if (!(fields >> quota >> period) || quota=="max") { return 0; }
+            try {
+                return cpus_from_quota(std::stol(quota), period);
+            }
+            catch (...) {
+                return 0;
+            }
+        }
+
+        /**
+         * Find the cgroup of the calling process for a controller, from /proc/self/cgroup.
+         * @param _controller The name of a cgroup v1 controller, or an empty string for the cgroup v2 hierarchy.
+         * @return The path of the cgroup relative to the controller's mount point, or std::nullopt if there is none.
+         */
+        inline std::optional<std::string> cgroup_path(const std::string& _controller)
+        {
+            std::ifstream file{"/proc/self/cgroup"};
+            std::string line;
+            while (std::getline(file, line)) {
+                // Each line is "hierarchy-ID:controller-list:path".
+                const std::size_t first_colon = line.find(':');
+                const std::size_t second_colon = line.find(':', first_colon+1);
+                if (first_colon==std::string::npos || second_colon==std::string::npos) { continue; }
+
+                const std::string controllers = ","+line.substr(first_colon+1, second_colon-first_colon-1)+",";
+                const bool match = _controller.empty() ? controllers=="," : controllers.find(","+_controller+",")!=std::string::npos;
+                if (match) { return line.substr(second_colon+1); }
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * Find the tightest limit along a cgroup and its ancestors, as a limit on a parent also applies to its children.
+         * @param _mount The mount point of the hierarchy.
+         * @param _path The path of the cgroup relative to the mount point.
+         * @param _read_limit A function which reads the limit of a cgroup directory, returning 0 if it has none.
+         * @return The tightest limit, or 0 if there is none.
+         */
+        template<typename Function>
+        std::size_t min_cgroup_limit(const std::string& _mount, std::string _path, Function&& _read_limit)
+        {
+            std::size_t limit = 0;
+            while (true) {
+                const std::size_t cgroup_limit = _read_limit(_mount+_path);
+                if (cgroup_limit!=0) { limit = limit==0 ? cgroup_limit : std::min(limit, cgroup_limit); }
+                if (_path.empty() || _path=="/") { break; }
+                const std::size_t slash = _path.find_last_of('/');
+                _path = slash==std::string::npos ? std::string{} : _path.substr(0, slash);
+            }
+            return limit;
+        }
+
+        /**
+         * Query the CPU quota of the calling process's cgroup, for cgroup v2 and cgroup v1.
+         * @return The number of CPUs the quota allows, rounded up, or 0 if there is no quota.
+         */
+        inline std::size_t cgroup_cpu_quota()
+        {
+            if (std::optional<std::string> path = cgroup_path("")) {
+                for (const char* mount : {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"}) {
+                    const std::size_t limit = min_cgroup_limit(mount, *path, [](const std::string& _dir) {
+                        std::optional<std::string> cpu_max = read_first_line(_dir+"/cpu.max");
+                        return cpu_max ? parse_cpu_max(*cpu_max) : 0;
+                    });
+                    if (limit!=0) { return limit; }
+                }
+            }
+
+            if (std::optional<std::string> path = cgroup_path("cpu")) {
+                for (const char* mount : {"/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct"}) {
+                    const std::size_t limit = min_cgroup_limit(mount, *path, [](const std::string& _dir) {
+                        std::optional<std::string> quota = read_first_line(_dir+"/cpu.cfs_quota_us");
+                        std::optional<std::string> period = read_first_line(_dir+"/cpu.cfs_period_us");
+                        if (!quota || !period) { return std::size_t{0}; }
+                        try {
+                            return cpus_from_quota(std::stol(*quota), std::stol(*period));
+                        }
+                        catch (...) {
+                            return std::size_t{0};
+                        }
+                    });
+                    if (limit!=0) { return limit; }
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * Query the number of CPUs in the calling process's cpuset, for cgroup v2 and cgroup v1.
+         * @return The number of CPUs, or 0 if it cannot be determined.
+         */
+        inline std::size_t cgroup_cpuset_size()
+        {
+            if (std::optional<std::string> path = cgroup_path("")) {
+                for (const char* mount : {"/sys/fs/cgroup", "/sys/fs/cgroup/unified"}) {
+                    if (std::optional<std::string> cpus = read_first_line(mount+*path+"/cpuset.cpus.effective")) {
+                        if (const std::size_t count = parse_cpu_list(*cpus)) { return count; }
+                    }
+                }
+            }
+
+            if (std::optional<std::string> path = cgroup_path("cpuset")) {
+                for (const char* file : {"/cpuset.effective_cpus", "/cpuset.cpus"}) {
+                    if (std::optional<std::string> cpus = read_first_line("/sys/fs/cgroup/cpuset"+*path+file)) {
+                        if (const std::size_t count = parse_cpu_list(*cpus)) { return count; }
+                    }
+                }
+            }
+            return 0;
+        }
+
+        /**
+         * Query the number of CPUs in the calling thread's affinity mask.
+         * @return The number of CPUs, or 0 if it cannot be determined.
+         */
+        inline std::size_t affinity_cpu_count()
+        {
+#ifdef __linux__
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set)==0) { return static_cast<std::size_t>(CPU_COUNT(&cpu_set)); }
+#endif
+            return 0;
+        }
+    }
+
+    /**
+     * Query the number of CPUs the process can actually use. Unlike std::thread::hardware_concurrency, which counts every CPU of
+     * the machine, this takes the cgroup CPU quota (cpu.max, or cpu.cfs_quota_us on cgroup v1), the cgroup cpuset and the affinity
+     * mask into account, so that a container limited to 4 CPUs on a 96 CPU host reports 4.
+     * The limits are read on every call, as they may change while the process runs.
+     * @return The number of usable CPUs. Always 1 or greater.
+     */
+    inline std::size_t available_concurrency()
+    {
+        std::size_t count = std::thread::hardware_concurrency();
+        for (const std::size_t limit : {detail::affinity_cpu_count(), detail::cgroup_cpuset_size(), detail::cgroup_cpu_quota()}) {
+            if (limit!=0) { count = count==0 ? limit : std::min(count, limit); }
+        }
+        return std::max<std::size_t>(count, 1);
+    }
+}
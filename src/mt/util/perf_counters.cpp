@@ -0,0 +1,189 @@
+#include "perf_counters.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace mkr {
+    namespace {
+        /// The printed name of each counter, indexed by mkr::perf_event.
+        constexpr const char* perf_event_names[num_perf_events] = {"cycles", "instructions", "cache-misses", "branch-misses", "context-switches"};
+
+#ifdef __linux__
+        /**
+         * Open a counter of a thread, disabled.
+         * @return The file descriptor of the counter, or -1 if it is unavailable.
+         */
+        int open_counter(perf_event _event, pid_t _tid)
+        {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            switch (_event) {
+            case perf_event::cycles: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CPU_CYCLES; break;
+            case perf_event::instructions: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_INSTRUCTIONS; break;
+            case perf_event::cache_misses: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_CACHE_MISSES; break;
+            case perf_event::branch_misses: attr.type = PERF_TYPE_HARDWARE; attr.config = PERF_COUNT_HW_BRANCH_MISSES; break;
+            case perf_event::context_switches: attr.type = PERF_TYPE_SOFTWARE; attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES; break;
+            }
+            attr.disabled = 1;
+            // Counting only user space works with the default perf_event_paranoid setting.
+            // Context switches happen in the kernel, and a software event does not need the PMU, so it is counted everywhere.
+            attr.exclude_kernel = attr.type==PERF_TYPE_HARDWARE ? 1 : 0;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return static_cast<int>(::syscall(SYS_perf_event_open, &attr, _tid, -1, -1, PERF_FLAG_FD_CLOEXEC));
+        }
+#endif
+    }
+
+    std::optional<double> perf_sample::ipc() const
+    {
+        const std::optional<uint64_t> cycles = get(perf_event::cycles);
+        const std::optional<uint64_t> instructions = get(perf_event::instructions);
+        if (!cycles || !instructions || *cycles==0) { return std::nullopt; }
+        return static_cast<double>(*instructions)/static_cast<double>(*cycles);
+    }
+
+    perf_sample& perf_sample::operator+=(const perf_sample& _sample)
+    {
+        for (std::size_t i = 0; i<num_perf_events; ++i) {
+            if (!_sample.values_[i]) { continue; }
+            values_[i] = values_[i].value_or(0)+*_sample.values_[i];
+        }
+        return *this;
+    }
+
+    std::string perf_sample::to_string() const
+    {
+        std::string text;
+        for (std::size_t i = 0; i<num_perf_events; ++i) {
+            if (i!=0) { text += " "; }
+            text += perf_event_names[i];
+            text += "=";
+            text += values_[i] ? std::to_string(*values_[i]) : "n/a";
+            if (static_cast<perf_event>(i)==perf_event::instructions) {
+                if (const std::optional<double> ipc_value = ipc()) {
+                    char buffer[32];
+                    std::snprintf(buffer, sizeof(buffer), " (IPC %.2f)", *ipc_value);
+                    text += buffer;
+                }
+            }
+        }
+        return text;
+    }
+
+    perf_counters::perf_counters(pid_t _tid)
+    {
+        for (std::size_t i = 0; i<num_perf_events; ++i) {
+#ifdef __linux__
+            fds_[i] = open_counter(static_cast<perf_event>(i), _tid);
+#else
+            fds_[i] = -1;
+#endif
+        }
+    }
+
+    perf_counters::~perf_counters()
+    {
+        for (int fd : fds_) {
+            if (fd>=0) { ::close(fd); }
+        }
+    }
+
+    bool perf_counters::available() const
+    {
+        return std::any_of(fds_.begin(), fds_.end(), [](int _fd) { return _fd>=0; });
+    }
+
+    void perf_counters::start()
+    {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd<0) { continue; }
+            ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    void perf_counters::stop()
+    {
+#ifdef __linux__
+        for (int fd : fds_) {
+            if (fd>=0) { ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0); }
+        }
+#endif
+    }
+
+    perf_sample perf_counters::read() const
+    {
+        perf_sample sample;
+        for (std::size_t i = 0; i<num_perf_events; ++i) {
+            if (fds_[i]<0) { continue; }
+
+            // The value, the time the counter was enabled, and the time it was running on the PMU.
+            uint64_t values[3] = {0, 0, 0};
+            if (::read(fds_[i], values, sizeof(values))!=static_cast<ssize_t>(sizeof(values)) || values[2]==0) { continue; }
+
+            // A multiplexed counter only ran for part of the time, so scale it up.
+            sample.values_[i] = values[2]<values[1] ?
+                    static_cast<uint64_t>(static_cast<double>(values[0])*static_cast<double>(values[1])/static_cast<double>(values[2])) : values[0];
+        }
+        return sample;
+    }
+
+    thread_perf_counters::thread_perf_counters()
+    {
+#ifdef __linux__
+        const pid_t self = static_cast<pid_t>(::syscall(SYS_gettid));
+        std::vector<pid_t> others;
+        std::error_code error;
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator{"/proc/self/task", error}) {
+            const pid_t tid = static_cast<pid_t>(std::strtol(entry.path().filename().c_str(), nullptr, 10));
+            if (tid>0 && tid!=self) { others.push_back(tid); }
+        }
+        std::sort(others.begin(), others.end());
+
+        threads_.emplace_back(self, std::make_unique<perf_counters>(0));
+        for (pid_t tid : others) { threads_.emplace_back(tid, std::make_unique<perf_counters>(tid)); }
+#else
+        threads_.emplace_back(0, std::make_unique<perf_counters>(0));
+#endif
+    }
+
+    bool thread_perf_counters::available() const
+    {
+        return threads_.front().second->available();
+    }
+
+    void thread_perf_counters::start()
+    {
+        for (const auto& [tid, counters] : threads_) { counters->start(); }
+    }
+
+    void thread_perf_counters::stop()
+    {
+        for (const auto& [tid, counters] : threads_) { counters->stop(); }
+    }
+
+    std::vector<std::pair<pid_t, perf_sample>> thread_perf_counters::read() const
+    {
+        std::vector<std::pair<pid_t, perf_sample>> samples;
+        for (const auto& [tid, counters] : threads_) { samples.emplace_back(tid, counters->read()); }
+        return samples;
+    }
+
+    perf_sample thread_perf_counters::read_total() const
+    {
+        perf_sample total;
+        for (const auto& [tid, counters] : threads_) { total += counters->read(); }
+        return total;
+    }
+}
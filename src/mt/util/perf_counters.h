@@ -0,0 +1,164 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+namespace mkr {
+    /**
+     * The events counted by mkr::perf_counters.
+     */
+    enum class perf_event : std::size_t {
+        /// CPU cycles.
+        cycles,
+        /// Retired instructions.
+        instructions,
+        /// Last level cache misses.
+        cache_misses,
+        /// Mispredicted branches.
+        branch_misses,
+        /// Context switches.
+        context_switches,
+    };
+
+    /// The number of events in mkr::perf_event.
+    constexpr std::size_t num_perf_events = 5;
+
+    /**
+     * The values of a set of performance counters. A counter which could not be opened, or never ran, has no value.
+     */
+    struct perf_sample {
+        /// The value of each counter, indexed by mkr::perf_event.
+        std::array<std::optional<uint64_t>, num_perf_events> values_;
+
+        inline std::optional<uint64_t> get(perf_event _event) const { return values_[static_cast<std::size_t>(_event)]; }
+
+        /**
+         * @return The instructions per cycle, or std::nullopt if either counter is unavailable.
+         */
+        std::optional<double> ipc() const;
+
+        /**
+         * Add the values of another sample. A counter missing from one sample takes the value of the other.
+         * @param _sample The other sample.
+         * @return This sample.
+         */
+        perf_sample& operator+=(const perf_sample& _sample);
+
+        /**
+         * @return The counters on one line, such as "cycles=1000 instructions=2000 (IPC 2.00) cache-misses=n/a ...".
+         */
+        std::string to_string() const;
+    };
+
+    /**
+     * Hardware and software performance counters of a single thread, read with perf_event_open(2).
+     * Cycles, instructions, cache misses and branch misses are counted in user space, and context switches in the kernel.
+     *
+     * The counters degrade gracefully. Each counter is opened separately, so a counter the CPU, hypervisor or
+     * /proc/sys/kernel/perf_event_paranoid does not allow is simply missing from the samples, and the others still work.
+     * Counters which the kernel multiplexes are scaled up by the fraction of time they ran.
+     *
+     * Additional Notes:
+     * - Only Linux is supported. Elsewhere, every counter is unavailable.
+     * - perf_counters is non-copyable AND non-movable.
+     */
+    class perf_counters {
+    private:
+        /// The file descriptor of each counter, or -1 if it is unavailable.
+        std::array<int, num_perf_events> fds_;
+
+    public:
+        /**
+         * Opens the counters, disabled.
+         * @param _tid The id of the thread to count, as returned by gettid(2). 0 counts the calling thread.
+         */
+        explicit perf_counters(pid_t _tid = 0);
+
+        /**
+         * Closes the counters.
+         */
+        ~perf_counters();
+
+        perf_counters(const perf_counters&) = delete;
+        perf_counters(perf_counters&&) = delete;
+        perf_counters& operator=(const perf_counters&) = delete;
+        perf_counters& operator=(perf_counters&&) = delete;
+
+        /**
+         * @return True if at least one counter is available.
+         */
+        bool available() const;
+
+        /**
+         * Reset the counters to 0 and start counting.
+         */
+        void start();
+
+        /**
+         * Stop counting.
+         */
+        void stop();
+
+        /**
+         * @return The current values of the counters.
+         */
+        perf_sample read() const;
+    };
+
+    /**
+     * mkr::perf_counters for every thread of the process which exists when it is constructed, such as the caller and the worker
+     * threads of a thread pool. Construct it after the thread pool, and before the benchmark.
+     * Threads created later, such as the ones created by std::async, are not counted.
+     *
+     * Additional Notes:
+     * - thread_perf_counters is non-copyable AND non-movable.
+     */
+    class thread_perf_counters {
+    private:
+        /// The id and counters of each thread. The calling thread is first.
+        std::vector<std::pair<pid_t, std::unique_ptr<perf_counters>>> threads_;
+
+    public:
+        /**
+         * Opens the counters of every thread of the process, disabled.
+         */
+        thread_perf_counters();
+
+        thread_perf_counters(const thread_perf_counters&) = delete;
+        thread_perf_counters(thread_perf_counters&&) = delete;
+        thread_perf_counters& operator=(const thread_perf_counters&) = delete;
+        thread_perf_counters& operator=(thread_perf_counters&&) = delete;
+
+        /**
+         * @return True if at least one counter of the calling thread is available.
+         */
+        bool available() const;
+
+        /**
+         * Reset the counters of every thread to 0 and start counting.
+         */
+        void start();
+
+        /**
+         * Stop counting on every thread.
+         */
+        void stop();
+
+        /**
+         * @return The thread id and counter values of each thread. The calling thread is first, followed by the others in order of id.
+         */
+        std::vector<std::pair<pid_t, perf_sample>> read() const;
+
+        /**
+         * @return The sum of the counter values of every thread.
+         */
+        perf_sample read_total() const;
+    };
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+/**
+ * USDT (user statically-defined tracing) probes, which perf, bpftrace and SystemTap can attach to in a running process.
+ *
+ * A probe compiles to a single NOP and an ELF note describing where its arguments live, so it costs nothing while no tracer is
+ * attached, and attaching needs no rebuild. The arguments must be values which are already at hand, such as pointers and
+ * integers, as they are not evaluated when tracepoints are disabled. They still count as used, so a variable which is only passed to a
+ * probe does not trigger -Wunused-variable.
+ *
+ * Probes are enabled when <sys/sdt.h> is available (from systemtap-sdt-dev or systemtap-sdt-devel), and can be disabled by defining
+ * MKR_NO_TRACEPOINTS. List them with `readelf -n <binary>` or `bpftrace -l 'usdt:<binary>:mkr:*'`.
+ *
+ * The probes, in the provider "mkr", are:
+ * - task_submit(thread_pool*, tag id, enqueue time): A task was created to be queued.
+ * - task_start(thread_pool*, worker index, tag id, enqueue time, start time): A task started. Non-worker threads have the index num_threads().
+ * - task_end(thread_pool*, worker index, tag id, start time): A task finished.
+ * - task_steal(thread_pool*, thief worker index, victim worker index): A task was taken from another worker's local task queue.
+ * - worker_park(thread_pool*, worker index): A worker found nothing to do and went idle.
+ * - worker_unpark(thread_pool*, worker index): An idle worker found a task.
+ * - queue_push(container*, size): A value was pushed onto a mkr::threadsafe_queue or mkr::threadsafe_stack.
+ * - queue_pop(container*, size): A value was popped from a mkr::threadsafe_queue or mkr::threadsafe_stack.
+ * - lock_contended(mutex*): A mkr::contention_counting_mutex, such as a mkr::threadsafe_hashtable bucket lock, had to wait.
+ * - lock_acquired(mutex*): A mkr::contention_counting_mutex which had to wait was acquired.
+ *
+ * Times are std::chrono::steady_clock nanoseconds, which is CLOCK_MONOTONIC on Linux, the same clock as bpftrace's nsecs.
+ * Sample bpftrace scripts are in tools/bpftrace.
+ */
+
+#if !defined(MKR_NO_TRACEPOINTS) && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MKR_TRACEPOINTS_ENABLED 1
+/// Fire the USDT probe mkr:_name with up to 12 arguments.
+#define MKR_TRACE(_name, ...) STAP_PROBEV(mkr, _name, __VA_ARGS__)
+#else
+#define MKR_TRACEPOINTS_ENABLED 0
+/// Use the arguments of the probe mkr:_name without evaluating them.
+#define MKR_TRACE(_name, ...) (false ? mkr::detail::trace_args(__VA_ARGS__) : (void)0)
+
+namespace mkr {
+    namespace detail {
+        /**
+         * Takes the arguments of a disabled probe. It is never called.
+         */
+        template<typename... Args>
+        constexpr void trace_args(const Args&...) { }
+    }
+}
+#endif
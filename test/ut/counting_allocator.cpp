@@ -0,0 +1,76 @@
+#include "counting_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <malloc.h>
+
+namespace {
+    std::atomic_size_t num_allocations{0};
+    std::atomic_size_t num_deallocations{0};
+    std::atomic_size_t allocated_bytes{0};
+    std::atomic_size_t deallocated_bytes{0};
+    std::atomic_size_t peak_live_bytes{0};
+
+    void* count_allocation(void* _ptr)
+    {
+        if (!_ptr) { throw std::bad_alloc{}; }
+        num_allocations.fetch_add(1, std::memory_order_relaxed);
+        const std::size_t allocated = allocated_bytes.fetch_add(malloc_usable_size(_ptr), std::memory_order_relaxed)+malloc_usable_size(_ptr);
+        // The peak is approximate while other threads allocate and deallocate concurrently.
+        const std::size_t live = allocated-std::min(allocated, deallocated_bytes.load(std::memory_order_relaxed));
+        std::size_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+        while (peak<live && !peak_live_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+        return _ptr;
+    }
+
+    void count_deallocation(void* _ptr)
+    {
+        if (!_ptr) { return; }
+        num_deallocations.fetch_add(1, std::memory_order_relaxed);
+        deallocated_bytes.fetch_add(malloc_usable_size(_ptr), std::memory_order_relaxed);
+        std::free(_ptr);
+    }
+
+    std::size_t aligned_size(std::size_t _size, std::align_val_t _alignment)
+    {
+        // aligned_alloc requires the size to be a multiple of the alignment.
+        const std::size_t alignment = static_cast<std::size_t>(_alignment);
+        return (std::max<std::size_t>(_size, 1)+alignment-1)/alignment*alignment;
+    }
+}
+
+namespace mkr {
+    allocation_counts get_allocation_counts()
+    {
+        allocation_counts counts;
+        counts.num_allocations_ = num_allocations.load(std::memory_order_relaxed);
+        counts.num_deallocations_ = num_deallocations.load(std::memory_order_relaxed);
+        counts.allocated_bytes_ = allocated_bytes.load(std::memory_order_relaxed);
+        counts.deallocated_bytes_ = deallocated_bytes.load(std::memory_order_relaxed);
+        return counts;
+    }
+
+    std::size_t get_peak_live_bytes()
+    {
+        return peak_live_bytes.load(std::memory_order_relaxed);
+    }
+
+    void reset_peak_live_bytes()
+    {
+        peak_live_bytes.store(get_allocation_counts().live_bytes(), std::memory_order_relaxed);
+    }
+}
+
+// The array and nothrow forms call these by default.
+void* operator new(std::size_t _size) { return count_allocation(std::malloc(_size==0 ? 1 : _size)); }
+void* operator new(std::size_t _size, std::align_val_t _alignment)
+{
+    return count_allocation(std::aligned_alloc(static_cast<std::size_t>(_alignment), aligned_size(_size, _alignment)));
+}
+
+void operator delete(void* _ptr) noexcept { count_deallocation(_ptr); }
+void operator delete(void* _ptr, std::size_t) noexcept { count_deallocation(_ptr); }
+void operator delete(void* _ptr, std::align_val_t) noexcept { count_deallocation(_ptr); }
+void operator delete(void* _ptr, std::size_t, std::align_val_t) noexcept { count_deallocation(_ptr); }
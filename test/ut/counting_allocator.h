@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+namespace mkr {
+    /**
+     * The heap allocations made by the whole process through the global operator new and operator delete, which the test
+     * executable replaces with counting versions in counting_allocator.cpp. The counters only grow, so the allocations made by
+     * an operation are the difference between the counts before and after it.
+     * Bytes are the usable sizes of the blocks returned by malloc, which include the padding malloc rounds requests up to.
+     */
+    struct allocation_counts {
+        /// The number of allocations.
+        std::size_t num_allocations_ = 0;
+        /// The number of deallocations.
+        std::size_t num_deallocations_ = 0;
+        /// The number of bytes allocated.
+        std::size_t allocated_bytes_ = 0;
+        /// The number of bytes deallocated.
+        std::size_t deallocated_bytes_ = 0;
+
+        /**
+         * @return The number of bytes allocated and not deallocated yet.
+         */
+        inline std::size_t live_bytes() const { return allocated_bytes_-deallocated_bytes_; }
+    };
+
+    /**
+     * @return The allocations made by the whole process so far.
+     */
+    allocation_counts get_allocation_counts();
+
+    /**
+     * @return The most bytes which have been allocated and not deallocated at once since the last reset_peak_live_bytes().
+     */
+    std::size_t get_peak_live_bytes();
+
+    /**
+     * Start measuring the peak live bytes again from the bytes live now.
+     */
+    void reset_peak_live_bytes();
+}
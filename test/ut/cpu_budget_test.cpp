@@ -0,0 +1,71 @@
+#include "mt/thread_pool/cpu_budget.h"
+#include "mt/thread_pool/thread_pool.h"
+#include "mt/algorithm/parallel_for.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+using namespace mkr;
+
+namespace {
+    /**
+     * Submit tasks which sleep to every thread pool, and record the most tasks seen running at once.
+     */
+    int max_concurrent_tasks(const std::vector<thread_pool*>& _thread_pools, int _num_tasks_per_pool)
+    {
+        std::atomic_int running{0}, max_running{0};
+        std::vector<std::future<void>> futures;
+        for (thread_pool* tp : _thread_pools) {
+            for (int i = 0; i<_num_tasks_per_pool; ++i) {
+                futures.push_back(tp->submit([&]() {
+                    int now = ++running;
+                    int observed = max_running.load();
+                    while (now>observed && !max_running.compare_exchange_weak(observed, now)) { }
+                    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+                    --running;
+                }));
+            }
+        }
+        // Block without helping, so that only the workers run tasks.
+        for (std::future<void>& f : futures) { f.get(); }
+        return max_running.load();
+    }
+}
+
+TEST(cpu_budget, shared_between_thread_pools) {
+    cpu_budget& budget = cpu_budget::get_instance();
+    const size_t old_limit = budget.limit();
+    budget.set_limit(2);
+
+    {
+        thread_pool a{4}, b{4};
+
+        // Both thread pools are busy, and share the 2 slots.
+        EXPECT_LE(max_concurrent_tasks({&a, &b}, 16), 2);
+
+        // b is idle, so a can use every slot.
+        EXPECT_EQ(max_concurrent_tasks({&a}, 16), 2);
+    }
+    EXPECT_EQ(budget.num_active(), 0u);
+
+    budget.set_limit(old_limit);
+}
+
+TEST(cpu_budget, nested_parallel_for_across_thread_pools) {
+    // At the default limit, which is 1 on a single CPU host, a worker of a which waits for b must not keep b's workers from running.
+    thread_pool a{2}, b{2};
+
+    std::vector<std::future<long>> futures;
+    for (int i = 0; i<2; ++i) {
+        futures.push_back(a.submit([&b]() {
+            std::atomic_long sum{0};
+            parallel_for(b, blocked_range<int>{0, 1000, 10}, [&sum](const blocked_range<int>& _range) {
+                for (int j = _range.begin(); j<_range.end(); ++j) { sum += j; }
+            });
+            return sum.load();
+        }));
+    }
+    for (std::future<long>& f : futures) { EXPECT_EQ(f.get(), 499500); }
+}
@@ -0,0 +1,58 @@
+#include "mt/container/enumerable_thread_specific.h"
+#include "mt/algorithm/parallel_for.h"
+#include <gtest/gtest.h>
+
+#include <set>
+
+using namespace mkr;
+
+TEST(enumerable_thread_specific, combine) {
+    thread_pool tp{};
+    enumerable_thread_specific<std::size_t> sums;
+
+    const std::size_t n = 1000000;
+    parallel_for(tp, blocked_range<std::size_t>{0, n, 1024}, [&](const blocked_range<std::size_t>& _range) {
+        std::size_t& sum = sums.local();
+        for (std::size_t i = _range.begin(); i<_range.end(); ++i) { sum += i; }
+    });
+
+    // Every thread that ran a task has exactly one element.
+    EXPECT_GE(sums.size(), 1u);
+    EXPECT_LE(sums.size(), tp.num_threads()+1);
+    EXPECT_EQ(sums.combine(std::plus<>{}), n*(n-1)/2);
+
+    std::size_t total = 0;
+    sums.combine_each([&](std::size_t _sum) { total += _sum; });
+    EXPECT_EQ(total, n*(n-1)/2);
+
+    sums.clear();
+    EXPECT_TRUE(sums.empty());
+    EXPECT_EQ(sums.combine(std::plus<>{}), 0u);
+}
+
+TEST(enumerable_thread_specific, local) {
+    std::atomic_int num_constructed{0};
+    enumerable_thread_specific<std::set<int>> sets{[&]() {
+        ++num_constructed;
+        return std::set<int>{};
+    }};
+
+    bool exists = true;
+    sets.local(exists).insert(1);
+    EXPECT_FALSE(exists);
+    sets.local(exists).insert(2);
+    EXPECT_TRUE(exists);
+
+    std::thread other{[&]() { sets.local().insert(3); }};
+    other.join();
+
+    EXPECT_EQ(num_constructed.load(), 2);
+    std::size_t num_values = 0;
+    for (const std::set<int>& s : sets) { num_values += s.size(); }
+    EXPECT_EQ(num_values, 3u);
+
+    // After clear(), the element is constructed again rather than served from the thread's cache.
+    sets.clear();
+    EXPECT_TRUE(sets.local(exists).empty());
+    EXPECT_FALSE(exists);
+}
@@ -0,0 +1,68 @@
+#include "mt/execution/execution.h"
+#include "counting_allocator.h"
+#include <gtest/gtest.h>
+
+#include <new>
+
+using namespace mkr;
+
+TEST(execution, schedule_then) {
+    thread_pool tp{};
+    thread_pool::scheduler sch = tp.get_scheduler();
+    EXPECT_EQ(sch, tp.get_scheduler());
+
+    std::optional<bool> on_worker;
+    auto result = sync_wait(schedule(sch)
+                            | then([&]() { on_worker = tp.worker_index().has_value(); return 20; })
+                            | then([](int _x) { return _x*2+2; }));
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(std::get<0>(*result), 42);
+    // sync_wait() helps the thread pool while waiting, so the work may also run on this thread.
+    EXPECT_TRUE(on_worker.has_value());
+
+    auto no_value = sync_wait(schedule(sch) | then([]() { }));
+    EXPECT_TRUE(no_value.has_value());
+
+    // Errors are rethrown by sync_wait().
+    EXPECT_THROW(sync_wait(schedule(sch) | then([]() -> int { throw std::runtime_error{"failed"}; }) | then([](int _x) { return _x; })),
+                 std::runtime_error);
+
+    // Senders which do not complete on a thread pool.
+    EXPECT_EQ(std::get<0>(*sync_wait(just(std::string{"value"}) | then([](std::string _s) { return _s.size(); }))), 5u);
+}
+
+TEST(execution, bulk) {
+    thread_pool tp{4};
+    const std::size_t n = 100000;
+    std::vector<int> values(n, 0);
+
+    auto result = sync_wait(schedule(tp.get_scheduler())
+                            | then([]() { return 3; })
+                            | bulk(n, [&](std::size_t _i, int _x) { values[_i] += _x; })
+                            | then([&](int _x) { return _x+1; }));
+    EXPECT_EQ(std::get<0>(*result), 4);
+    for (int v : values) { ASSERT_EQ(v, 3); }
+
+    // Without a thread pool, bulk runs the indices in order.
+    std::vector<std::size_t> order;
+    sync_wait(just() | bulk(5, [&](std::size_t _i) { order.push_back(_i); }));
+    EXPECT_EQ(order, (std::vector<std::size_t>{0, 1, 2, 3, 4}));
+}
+
+TEST(execution, no_allocations) {
+    thread_pool tp{};
+    thread_pool::scheduler sch = tp.get_scheduler();
+    auto pipeline = [&]() {
+        return sync_wait(schedule(sch) | then([]() { return 1; }) | then([](int _x) { return _x+1; }) | then([](int _x) { return _x*3; }));
+    };
+
+    // Let every thread reach a steady state first.
+    EXPECT_EQ(std::get<0>(*pipeline()), 6);
+
+    const std::size_t num_allocations = get_allocation_counts().num_allocations_;
+    int sum = 0;
+    for (int i = 0; i<1000; ++i) { sum += std::get<0>(*pipeline()); }
+
+    EXPECT_EQ(sum, 6000);
+    EXPECT_EQ(get_allocation_counts().num_allocations_-num_allocations, 0u);
+}
@@ -0,0 +1,111 @@
+#include "mt/algorithm/parallel_sort.h"
+#include "mt/executor/inline_executor.h"
+#include "mt/executor/manual_executor.h"
+#include "mt/executor/strand.h"
+#include <gtest/gtest.h>
+
+#include <random>
+
+using namespace mkr;
+
+static_assert(executor<strand<thread_pool>>);
+static_assert(executor<strand<inline_executor>>);
+
+namespace {
+    template<executor Executor>
+    void check_sort(Executor& _executor) {
+        std::mt19937 rng{42};
+        std::vector<int> values(100000);
+        for (int& value : values) { value = static_cast<int>(rng()%1000); }
+        std::vector<int> expected = values;
+        std::sort(expected.begin(), expected.end());
+
+        parallel_sort(_executor, values.begin(), values.end(), std::less<>{}, 1000);
+        EXPECT_EQ(values, expected);
+    }
+}
+
+TEST(executor, algorithms) {
+    // The same algorithm runs on every executor.
+    thread_pool tp{};
+    check_sort(tp);
+
+    inline_executor inline_exec;
+    check_sort(inline_exec);
+
+    manual_executor manual_exec;
+    check_sort(manual_exec);
+    EXPECT_EQ(manual_exec.num_pending(), 0u);
+
+    strand<thread_pool> s{tp};
+    check_sort(s);
+}
+
+TEST(executor, inline_executor) {
+    inline_executor exec;
+    int value = 0;
+    exec.post([&]() { value = 1; });
+    EXPECT_EQ(value, 1);
+
+    std::future<int> result = exec.submit([](int _x) { return _x*2; }, 21);
+    EXPECT_TRUE(is_future_ready(result));
+    EXPECT_EQ(result.get(), 42);
+
+    std::future<void> failed = exec.submit([]() { throw std::runtime_error{"failed"}; });
+    EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(executor, manual_executor) {
+    manual_executor exec;
+    std::vector<int> order;
+    exec.post([&]() { order.push_back(1); });
+    std::future<void> second = exec.submit([&]() {
+        order.push_back(2);
+        exec.post([&]() { order.push_back(3); });
+    });
+
+    // Nothing runs until asked to.
+    EXPECT_TRUE(order.empty());
+    EXPECT_EQ(exec.num_pending(), 2u);
+
+    EXPECT_TRUE(exec.run_pending_task());
+    EXPECT_EQ(order, std::vector<int>{1});
+    EXPECT_EQ(exec.run_all(), 2u);
+    EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+    EXPECT_TRUE(is_future_ready(second));
+    EXPECT_FALSE(exec.run_pending_task());
+}
+
+TEST(executor, strand) {
+    thread_pool tp{4};
+    std::vector<int> order;
+    std::atomic_int num_running{0};
+    std::atomic_bool overlapped{false};
+
+    {
+        strand<thread_pool> s{tp};
+        const int num_tasks = 10000;
+        for (int i = 0; i<num_tasks; ++i) {
+            s.post([&, i]() {
+                if (num_running.fetch_add(1)!=0) { overlapped = true; }
+                order.push_back(i);
+                num_running.fetch_sub(1);
+            });
+        }
+
+        // A function on the strand can wait for a later function of the same strand.
+        std::future<bool> nested = s.submit([&]() {
+            std::future<int> inner = s.submit([]() { return 7; });
+            s.run_pending_tasks(inner);
+            return s.running_in_this_thread() && inner.get()==7;
+        });
+        tp.run_pending_tasks(nested);
+        EXPECT_TRUE(nested.get());
+        EXPECT_FALSE(s.running_in_this_thread());
+    }
+
+    // The strand's functions ran one at a time, in submission order.
+    EXPECT_FALSE(overlapped.load());
+    ASSERT_EQ(order.size(), 10000u);
+    for (int i = 0; i<10000; ++i) { ASSERT_EQ(order[i], i); }
+}
@@ -0,0 +1,87 @@
+#include "external_sort_test.h"
+#include "counting_allocator.h"
+#include <gtest/gtest.h>
+
+using namespace mkr;
+
+TEST(external_sort, correctness) {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string input_path = (directory / "mkr_mt_external_sort_test_input.txt").string();
+    const std::string output_path = (directory / "mkr_mt_external_sort_test_output.txt").string();
+
+    const std::size_t num_records = 200000;
+    external_sort_test::generate_input(input_path, num_records);
+    {
+        // The last record has no newline.
+        std::ofstream file{input_path, std::ios::binary | std::ios::app};
+        file << "last";
+    }
+
+    std::vector<std::string> expected;
+    {
+        std::ifstream file{input_path, std::ios::binary};
+        for (std::string line; std::getline(file, line);) { expected.push_back(line); }
+        std::sort(expected.begin(), expected.end());
+    }
+
+    thread_pool tp{};
+    io_executor io{tp};
+
+    // A tiny memory budget forces many runs and several merge passes.
+    external_sort_options options;
+    options.memory_budget_ = 256 * 1024;
+    options.min_read_ahead_ = 4096;
+    options.write_block_size_ = 16 * 1024;
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    external_sort_stats stats = external_sort(tp, io, input_path, output_path, options);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "External Sort " << num_records << " Records: " << stats.num_runs_ << " Runs, " << stats.num_merge_passes_
+              << " Merge Passes, " << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() << "ms" << std::endl;
+
+    EXPECT_EQ(stats.num_records_, expected.size());
+    EXPECT_GT(stats.num_merge_passes_, 1u);
+
+    std::vector<std::string> result;
+    {
+        std::ifstream file{output_path, std::ios::binary};
+        for (std::string line; std::getline(file, line);) { result.push_back(line); }
+    }
+    EXPECT_EQ(result, expected);
+
+    std::filesystem::remove(input_path);
+    std::filesystem::remove(output_path);
+}
+
+TEST(external_sort, memory_budget) {
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const std::string input_path = (directory / "mkr_mt_external_sort_budget_input.txt").string();
+    const std::string output_path = (directory / "mkr_mt_external_sort_budget_output.txt").string();
+
+    // Short records make the per record memory outweigh the text.
+    const std::size_t num_records = 200000;
+    external_sort_test::generate_input(input_path, num_records, 2);
+
+    thread_pool tp{};
+    io_executor io{tp};
+
+    external_sort_options options;
+    options.memory_budget_ = 1024 * 1024;
+    options.min_read_ahead_ = 4096;
+    options.write_block_size_ = 16 * 1024;
+
+    // The mapped input is not allocated on the heap, so the heap alone must stay within the budget. Runs and buffers are sized from nine
+    // tenths of it, which leaves the last tenth for the thread pool's tasks, the vectors of runs and the loser tree.
+    reset_peak_live_bytes();
+    const std::size_t live_bytes = get_allocation_counts().live_bytes();
+    external_sort_stats stats = external_sort(tp, io, input_path, output_path, options);
+    const std::size_t peak_bytes = get_peak_live_bytes()-live_bytes;
+    std::cout << "External Sort Peak Heap: " << peak_bytes << " Bytes, " << stats.num_runs_ << " Runs" << std::endl;
+
+    EXPECT_EQ(stats.num_records_, num_records);
+    EXPECT_GT(stats.num_runs_, 1u);
+    EXPECT_LE(peak_bytes, options.memory_budget_);
+
+    std::filesystem::remove(input_path);
+    std::filesystem::remove(output_path);
+}
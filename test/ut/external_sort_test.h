@@ -0,0 +1,87 @@
+#pragma once
+
+#include "mt/io/external_sort.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <random>
+
+namespace mkr {
+    /**
+     * A demo of the performance of mkr::external_sort against GNU sort.
+     */
+    class external_sort_test {
+    public:
+        external_sort_test() = delete;
+
+        /**
+         * Write a file of random alphanumeric records.
+         * @param _path The path of the file.
+         * @param _num_records The number of records.
+         * @param _max_length The maximum length of a record. Records are 1 to _max_length characters long.
+         */
+        static void generate_input(const std::string& _path, std::size_t _num_records, std::size_t _max_length = 32) {
+            static const char alphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+            std::mt19937_64 rng{12345};
+            std::ofstream file{_path, std::ios::binary};
+            std::string record;
+            for (std::size_t i = 0; i < _num_records; ++i) {
+                record.resize(1 + rng() % _max_length);
+                for (char& c : record) { c = alphabet[rng() % (sizeof(alphabet) - 1)]; }
+                file << record << '\n';
+            }
+        }
+
+        /**
+         * Call this function to run the external sort demo.
+         * @param _num_records The number of records to sort.
+         * @param _memory_budget The memory budget of both mkr::external_sort and GNU sort.
+         */
+        static void run(std::size_t _num_records = 50000000, std::size_t _memory_budget = 256 * 1024 * 1024) {
+            const std::filesystem::path directory = std::filesystem::temp_directory_path();
+            const std::string input_path = (directory / "mkr_mt_external_sort_input.txt").string();
+            const std::string mkr_output_path = (directory / "mkr_mt_external_sort_mkr.txt").string();
+            const std::string gnu_output_path = (directory / "mkr_mt_external_sort_gnu.txt").string();
+
+            generate_input(input_path, _num_records);
+            std::cout << "Number of Hardware Threads Your System Supports: " << std::thread::hardware_concurrency() << "\n" << std::endl;
+
+            // mkr::external_sort
+            {
+                thread_pool tp{};
+                io_executor io{tp};
+                external_sort_options options;
+                options.memory_budget_ = _memory_budget;
+
+                std::cout << "External Sort " << _num_records << " Records (mkr::external_sort - " << tp.num_threads() << " Threads, "
+                          << (io.uses_io_uring() ? "io_uring" : "blocking I/O threads") << ")" << std::endl;
+                auto start_time = std::chrono::high_resolution_clock::now();
+                external_sort_stats stats = external_sort(tp, io, input_path, mkr_output_path, options);
+                auto end_time = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+
+                std::cout << "Runs: " << stats.num_runs_ << ", Merge Passes: " << stats.num_merge_passes_ << std::endl;
+                std::cout << "Time Taken: " << duration << "ms" << std::endl << std::endl;
+            }
+
+            // GNU sort
+            {
+                std::string command = "LC_ALL=C sort --parallel=" + std::to_string(std::thread::hardware_concurrency()) +
+                                      " -S " + std::to_string(_memory_budget / 1024) + "K -T " + directory.string() +
+                                      " -o " + gnu_output_path + " " + input_path;
+                std::cout << "External Sort " << _num_records << " Records (" << command << ")" << std::endl;
+                auto start_time = std::chrono::high_resolution_clock::now();
+                int status = std::system(command.c_str());
+                auto end_time = std::chrono::high_resolution_clock::now();
+                auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+
+                if (status != 0) { std::cout << "GNU sort is not available." << std::endl << std::endl; }
+                else { std::cout << "Time Taken: " << duration << "ms" << std::endl << std::endl; }
+            }
+
+            std::filesystem::remove(input_path);
+            std::filesystem::remove(mkr_output_path);
+            std::filesystem::remove(gnu_output_path);
+        }
+    };
+}
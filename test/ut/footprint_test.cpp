@@ -0,0 +1,55 @@
+#include "footprint_test.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+using namespace mkr;
+
+namespace {
+    /**
+     * The footprint limits, measured with 10000 elements on x86-64 with glibc and libstdc++.
+     * A footprint above its limit is a regression. When a change shrinks a footprint, lower its limit, so that it does not grow back.
+     */
+    struct footprint_limit {
+        const char *container_;
+        const char *element_;
+        std::size_t empty_bytes_;
+        double bytes_per_element_;
+        double allocations_per_insert_;
+    };
+
+    constexpr footprint_limit footprint_limits[] = {
+        {"threadsafe_stack", "int", 192, 48, 2},
+        {"threadsafe_queue", "int", 280, 48, 2},
+        {"threadsafe_list", "int", 104, 112, 2},
+        {"threadsafe_hashtable", "int", 9784, 152, 3},
+        {"threadsafe_stack", "block64", 192, 112, 2},
+        {"threadsafe_queue", "block64", 280, 112, 2},
+        {"threadsafe_list", "block64", 104, 176, 2},
+        {"threadsafe_hashtable", "block64", 9784, 216, 3},
+        {"threadsafe_stack", "string(100)", 192, 184, 3},
+        {"threadsafe_queue", "string(100)", 280, 184, 3},
+        {"threadsafe_list", "string(100)", 104, 248, 3},
+        {"threadsafe_hashtable", "string(100)", 9784, 288, 4},
+        {"atomic_bitmap", "bit", 32, 0.125, 0},
+    };
+}
+
+TEST(footprint, regression) {
+    const std::vector<footprint_test::footprint> results = footprint_test::run({10000});
+
+    for (const footprint_limit &limit : footprint_limits) {
+        auto result = std::find_if(results.begin(), results.end(), [&](const footprint_test::footprint &_footprint) {
+            return _footprint.container_ == limit.container_ && _footprint.element_ == limit.element_;
+        });
+        ASSERT_NE(result, results.end()) << limit.container_ << "<" << limit.element_ << ">";
+
+        // The averages also include the odd unrelated allocation made while measuring, so allow a little slack.
+        SCOPED_TRACE(std::string{limit.container_} + "<" + limit.element_ + ">");
+        EXPECT_LE(result->empty_bytes_, limit.empty_bytes_);
+        EXPECT_LE(result->bytes_per_element_, limit.bytes_per_element_ + 0.5);
+        EXPECT_LE(result->allocations_per_insert_, limit.allocations_per_insert_ + 0.01);
+        // Removing an element never allocates.
+        EXPECT_EQ(result->allocations_per_remove_, 0.0);
+    }
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "counting_allocator.h"
+#include "mt/container/atomic_bitmap.h"
+#include "mt/container/threadsafe_hashtable.h"
+#include "mt/container/threadsafe_list.h"
+#include "mt/container/threadsafe_queue.h"
+#include "mt/container/threadsafe_stack.h"
+#include <array>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mkr {
+    /**
+     * A benchmark of the memory footprint of the containers, measured with the counting global allocator in counting_allocator.cpp.
+     * Every element of a container costs its nodes, its value, and the control blocks of the std::shared_ptr holding it,
+     * each rounded up by malloc, so the footprint is measured rather than added up from sizeof.
+     */
+    class footprint_test {
+    public:
+        footprint_test() = delete;
+
+        /**
+         * The footprint of a container holding a number of elements.
+         */
+        struct footprint {
+            /// The container.
+            std::string container_;
+            /// The element type.
+            std::string element_;
+            /// The number of elements.
+            std::size_t num_elements_ = 0;
+            /// The bytes of an empty container, including the container object itself.
+            std::size_t empty_bytes_ = 0;
+            /// The bytes each element adds.
+            double bytes_per_element_ = 0.0;
+            /// The allocations made by each insertion.
+            double allocations_per_insert_ = 0.0;
+            /// The allocations made by each removal.
+            double allocations_per_remove_ = 0.0;
+        };
+
+        /// A 64-byte trivially copyable element.
+        typedef std::array<char, 64> block64;
+
+        /**
+         * Make the _index-th element of a type. Strings are long enough not to fit in the small string buffer, so they allocate too.
+         */
+        template<typename T>
+        static T make_element(std::size_t _index) {
+            if constexpr (std::is_same_v<T, std::string>) {
+                return std::string(100, static_cast<char>('a' + _index % 26));
+            } else if constexpr (std::is_same_v<T, block64>) {
+                block64 block{};
+                block[0] = static_cast<char>(_index);
+                return block;
+            } else {
+                return static_cast<T>(_index);
+            }
+        }
+
+        template<typename T>
+        static const char *element_name() {
+            if constexpr (std::is_same_v<T, std::string>) { return "string(100)"; }
+            else if constexpr (std::is_same_v<T, block64>) { return "block64"; }
+            else { return "int"; }
+        }
+
+        /**
+         * Measure the footprint of a container.
+         * @param _name The name of the container.
+         * @param _num_elements The number of elements to insert.
+         * @param _insert Inserts the _index-th element into the container.
+         * @param _remove Removes the _index-th element from the container.
+         */
+        template<typename Container, typename T, typename Insert, typename Remove>
+        static footprint measure(const std::string &_name, std::size_t _num_elements, Insert &&_insert, Remove &&_remove) {
+            // The elements are made before counting, so that only the copies the container makes are counted.
+            std::vector<T> elements;
+            elements.reserve(_num_elements);
+            for (std::size_t i = 0; i < _num_elements; ++i) { elements.push_back(make_element<T>(i)); }
+
+            footprint result;
+            result.container_ = _name;
+            result.element_ = element_name<T>();
+            result.num_elements_ = _num_elements;
+
+            const allocation_counts before = get_allocation_counts();
+            std::unique_ptr<Container> container = std::make_unique<Container>();
+            const allocation_counts empty = get_allocation_counts();
+            for (std::size_t i = 0; i < _num_elements; ++i) { _insert(*container, i, elements[i]); }
+            const allocation_counts full = get_allocation_counts();
+            for (std::size_t i = 0; i < _num_elements; ++i) { _remove(*container, i); }
+            const allocation_counts removed = get_allocation_counts();
+
+            result.empty_bytes_ = empty.live_bytes() - before.live_bytes();
+            result.bytes_per_element_ = static_cast<double>(full.live_bytes() - empty.live_bytes()) / static_cast<double>(_num_elements);
+            result.allocations_per_insert_ = static_cast<double>(full.num_allocations_ - empty.num_allocations_) / static_cast<double>(_num_elements);
+            result.allocations_per_remove_ = static_cast<double>(removed.num_allocations_ - full.num_allocations_) / static_cast<double>(_num_elements);
+            return result;
+        }
+
+        /**
+         * Measure the footprint of every container holding elements of a type.
+         */
+        template<typename T>
+        static std::vector<footprint> measure_all(std::size_t _num_elements) {
+            std::vector<footprint> results;
+            results.push_back(measure<threadsafe_stack<T>, T>("threadsafe_stack", _num_elements,
+                    [](threadsafe_stack<T> &_c, std::size_t, const T &_v) { _c.push(_v); },
+                    [](threadsafe_stack<T> &_c, std::size_t) { _c.try_pop(); }));
+            results.push_back(measure<threadsafe_queue<T>, T>("threadsafe_queue", _num_elements,
+                    [](threadsafe_queue<T> &_c, std::size_t, const T &_v) { _c.push(_v); },
+                    [](threadsafe_queue<T> &_c, std::size_t) { _c.try_pop(); }));
+            results.push_back(measure<threadsafe_list<T>, T>("threadsafe_list", _num_elements,
+                    [](threadsafe_list<T> &_c, std::size_t, const T &_v) { _c.push_front(_v); },
+                    [](threadsafe_list<T> &_c, std::size_t) { _c.remove_if([](const T &) { return true; }, 1); }));
+            results.push_back(measure<threadsafe_hashtable<std::size_t, T>, T>("threadsafe_hashtable", _num_elements,
+                    [](threadsafe_hashtable<std::size_t, T> &_c, std::size_t _i, const T &_v) { _c.insert(_i, _v); },
+                    [](threadsafe_hashtable<std::size_t, T> &_c, std::size_t _i) { _c.remove(_i); }));
+            return results;
+        }
+
+        /**
+         * Measure the footprint of an atomic_bitmap, whose elements are bits. It allocates all of its bits when it is constructed.
+         */
+        static footprint measure_bitmap(std::size_t _num_bits) {
+            footprint result;
+            result.container_ = "atomic_bitmap";
+            result.element_ = "bit";
+            result.num_elements_ = _num_bits;
+
+            const allocation_counts before = get_allocation_counts();
+            atomic_bitmap bitmap{_num_bits};
+            const allocation_counts full = get_allocation_counts();
+            for (std::size_t i = 0; i < _num_bits; ++i) { bitmap.set(i); }
+            const allocation_counts set = get_allocation_counts();
+
+            result.empty_bytes_ = sizeof(atomic_bitmap);
+            result.bytes_per_element_ = static_cast<double>(full.live_bytes() - before.live_bytes()) / static_cast<double>(_num_bits);
+            result.allocations_per_insert_ = static_cast<double>(set.num_allocations_ - full.num_allocations_) / static_cast<double>(_num_bits);
+            return result;
+        }
+
+        static void print_header() {
+            std::printf("%-22s %-12s %8s %10s %12s %10s %10s\n", "container", "element", "elements", "empty B", "B/element", "allocs/ins", "allocs/rem");
+        }
+
+        static void print(const footprint &_footprint) {
+            std::printf("%-22s %-12s %8zu %10zu %12.2f %10.2f %10.2f\n", _footprint.container_.c_str(), _footprint.element_.c_str(),
+                        _footprint.num_elements_, _footprint.empty_bytes_, _footprint.bytes_per_element_,
+                        _footprint.allocations_per_insert_, _footprint.allocations_per_remove_);
+        }
+
+        /**
+         * Call this function to run the memory footprint demo.
+         * @param _sizes The numbers of elements to measure each container with.
+         * @return The footprint of each container, element type and size.
+         */
+        static std::vector<footprint> run(const std::vector<std::size_t> &_sizes = {100, 1000, 10000}) {
+            std::vector<footprint> results;
+            for (std::size_t size : _sizes) {
+                for (std::vector<footprint> r : {measure_all<int>(size), measure_all<block64>(size), measure_all<std::string>(size)}) {
+                    results.insert(results.end(), r.begin(), r.end());
+                }
+                results.push_back(measure_bitmap(size));
+            }
+            print_header();
+            for (const footprint &f : results) { print(f); }
+            std::printf("\n");
+            return results;
+        }
+    };
+}
@@ -0,0 +1,134 @@
+#include "mt/graph/bfs.h"
+#include "mt/graph/connected_components.h"
+#include "mt/graph/pagerank.h"
+#include <gtest/gtest.h>
+
+#include <queue>
+#include <random>
+
+using namespace mkr;
+
+namespace {
+    /// A random undirected graph made of several disconnected random subgraphs, plus some isolated vertices.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> make_edges(std::uint32_t _num_vertices, std::size_t _num_edges) {
+        std::mt19937 rng{42};
+        const std::uint32_t num_islands = 5;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> edges;
+        for (std::size_t i = 0; i < _num_edges; ++i) {
+            std::uint32_t island = rng() % num_islands;
+            std::uint32_t island_size = (_num_vertices - 100) / num_islands;
+            std::uint32_t u = island * island_size + rng() % island_size;
+            std::uint32_t v = island * island_size + rng() % island_size;
+            edges.emplace_back(u, v);
+            edges.emplace_back(v, u);
+        }
+        return edges;
+    }
+
+    std::vector<std::size_t> serial_bfs_depths(const csr_graph<std::uint32_t>& _graph, std::uint32_t _source) {
+        std::vector<std::size_t> depths(_graph.num_vertices(), SIZE_MAX);
+        std::queue<std::uint32_t> queue;
+        depths[_source] = 0;
+        queue.push(_source);
+        while (!queue.empty()) {
+            std::uint32_t u = queue.front();
+            queue.pop();
+            for (std::uint32_t v : _graph.neighbours(u)) {
+                if (depths[v] == SIZE_MAX) {
+                    depths[v] = depths[u] + 1;
+                    queue.push(v);
+                }
+            }
+        }
+        return depths;
+    }
+
+    /// Two dense random clusters joined by a long path, so that a search switches to bottom-up, back to top-down, and to bottom-up again.
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> make_barbell_edges(std::uint32_t _cluster_size, std::uint32_t _path_length) {
+        std::mt19937 rng{7};
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> edges;
+        auto add_edge = [&edges](std::uint32_t _u, std::uint32_t _v) {
+            edges.emplace_back(_u, _v);
+            edges.emplace_back(_v, _u);
+        };
+        const std::uint32_t second_cluster = _cluster_size + _path_length;
+        for (std::size_t i = 0; i < 20 * static_cast<std::size_t>(_cluster_size); ++i) {
+            add_edge(rng() % _cluster_size, rng() % _cluster_size);
+            add_edge(second_cluster + rng() % _cluster_size, second_cluster + rng() % _cluster_size);
+        }
+        for (std::uint32_t i = 0; i <= _path_length; ++i) { add_edge(_cluster_size - 1 + i, _cluster_size + i); }
+        return edges;
+    }
+
+    /// Check that every reachable vertex's parent is a neighbour one level closer to the source.
+    void expect_bfs_tree(const csr_graph<std::uint32_t>& _graph, const std::vector<std::uint32_t>& _parents, std::uint32_t _source) {
+        auto depths = serial_bfs_depths(_graph, _source);
+        ASSERT_EQ(_parents[_source], _source);
+        for (std::uint32_t v = 0; v < _graph.num_vertices(); ++v) {
+            if (depths[v] == SIZE_MAX) {
+                EXPECT_EQ(_parents[v], csr_graph<std::uint32_t>::invalid_vertex);
+            } else if (v != _source) {
+                ASSERT_NE(_parents[v], csr_graph<std::uint32_t>::invalid_vertex);
+                EXPECT_EQ(depths[_parents[v]] + 1, depths[v]);
+            }
+        }
+    }
+}
+
+TEST(graph, bfs) {
+    const std::uint32_t num_vertices = 50000;
+    thread_pool tp{};
+    auto graph = csr_graph<std::uint32_t>::from_edges(tp, num_vertices, make_edges(num_vertices, 200000));
+
+    expect_bfs_tree(graph, parallel_bfs(tp, graph, 3), 3);
+}
+
+TEST(graph, bfs_switches_direction) {
+    const std::uint32_t cluster_size = 5000, path_length = 200;
+    thread_pool tp{};
+    auto graph = csr_graph<std::uint32_t>::from_edges(tp, 2 * cluster_size + path_length, make_barbell_edges(cluster_size, path_length));
+
+    std::vector<bfs_direction> directions;
+    expect_bfs_tree(graph, parallel_bfs(tp, graph, graph, 0, 15, 18, &directions), 0);
+
+    // The first cluster is searched bottom-up, the path top-down, and the second cluster bottom-up again.
+    std::vector<bfs_direction> runs;
+    for (bfs_direction direction : directions) {
+        if (runs.empty() || runs.back() != direction) { runs.push_back(direction); }
+    }
+    EXPECT_EQ(runs, (std::vector<bfs_direction>{bfs_direction::top_down, bfs_direction::bottom_up, bfs_direction::top_down, bfs_direction::bottom_up}));
+}
+
+TEST(graph, connected_components) {
+    const std::uint32_t num_vertices = 50000;
+    thread_pool tp{};
+    auto graph = csr_graph<std::uint32_t>::from_edges(tp, num_vertices, make_edges(num_vertices, 100000));
+
+    auto labels = parallel_connected_components(tp, graph);
+
+    // Two vertices share a label if and only if a BFS from one reaches the other.
+    for (std::uint32_t source : {0u, 10000u, 49990u}) {
+        auto depths = serial_bfs_depths(graph, source);
+        for (std::uint32_t v = 0; v < num_vertices; ++v) {
+            ASSERT_EQ(depths[v] != SIZE_MAX, labels[v] == labels[source]);
+            if (labels[v] == labels[source]) { ASSERT_LE(labels[source], v); }
+        }
+    }
+}
+
+TEST(graph, pagerank) {
+    // A directed cycle 0->1->2->0, plus vertex 3 pointing into the cycle, and a dangling vertex 4 pointed to by 3.
+    thread_pool tp{};
+    auto graph = csr_graph<std::uint32_t>::from_edges(tp, 5, {{0, 1}, {1, 2}, {2, 0}, {3, 0}, {3, 4}});
+    auto ranks = parallel_pagerank(tp, graph, graph.transpose(tp), 0.85, 1e-12, 1000);
+
+    // Check the fixed point of the PageRank equation directly.
+    const double d = 0.85;
+    const double base = (1.0 - d + d * ranks[4]) / 5.0;
+    EXPECT_NEAR(ranks[0], base + d * (ranks[2] + ranks[3] / 2.0), 1e-9);
+    EXPECT_NEAR(ranks[1], base + d * ranks[0], 1e-9);
+    EXPECT_NEAR(ranks[2], base + d * ranks[1], 1e-9);
+    EXPECT_NEAR(ranks[3], base, 1e-9);
+    EXPECT_NEAR(ranks[4], base + d * ranks[3] / 2.0, 1e-9);
+    EXPECT_NEAR(ranks[0] + ranks[1] + ranks[2] + ranks[3] + ranks[4], 1.0, 1e-9);
+}
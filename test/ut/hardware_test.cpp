@@ -0,0 +1,38 @@
+#include "mt/util/hardware.h"
+#include "mt/thread_pool/thread_pool.h"
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+using namespace mkr;
+
+TEST(hardware, parse_cgroup_limits) {
+    EXPECT_EQ(detail::parse_cpu_list("0-3,8,10-11\n"), 7u);
+    EXPECT_EQ(detail::parse_cpu_list("5"), 1u);
+    EXPECT_EQ(detail::parse_cpu_list("3-1"), 0u);
+    EXPECT_EQ(detail::parse_cpu_list("garbage"), 0u);
+
+    EXPECT_EQ(detail::parse_cpu_max("max 100000"), 0u);
+    EXPECT_EQ(detail::parse_cpu_max("400000 100000"), 4u);
+    EXPECT_EQ(detail::parse_cpu_max("250000 100000"), 3u);
+    EXPECT_EQ(detail::cpus_from_quota(-1, 100000), 0u);
+    EXPECT_EQ(detail::cpus_from_quota(50000, 100000), 1u);
+}
+
+TEST(hardware, default_num_threads) {
+    EXPECT_GE(available_concurrency(), 1u);
+    EXPECT_LE(available_concurrency(), std::max(std::thread::hardware_concurrency(), 1u));
+
+    setenv("MKR_NUM_THREADS", "3", 1);
+    EXPECT_EQ(thread_pool::default_num_threads(), 3u);
+    {
+        thread_pool tp{};
+        EXPECT_EQ(tp.num_threads(), 3u);
+    }
+
+    // Invalid values are ignored.
+    setenv("MKR_NUM_THREADS", "lots", 1);
+    EXPECT_EQ(thread_pool::default_num_threads(), std::max<std::size_t>(available_concurrency()-1, 1));
+    unsetenv("MKR_NUM_THREADS");
+    EXPECT_EQ(thread_pool::default_num_threads(), std::max<std::size_t>(available_concurrency()-1, 1));
+}
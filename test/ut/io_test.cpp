@@ -0,0 +1,96 @@
+#include "mt/io/io_executor.h"
+#include "mt/io/parallel_for_each_line.h"
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace mkr;
+
+TEST(io, parallel_for_each_line) {
+    const std::string path = (std::filesystem::temp_directory_path() / "mkr_mt_parallel_for_each_line.txt").string();
+    const long num_lines = 200000;
+    long expected_sum = 0;
+    {
+        std::ofstream file{path, std::ios::binary};
+        for (long i = 0; i < num_lines; ++i) {
+            file << i << '\n';
+            expected_sum += i;
+        }
+        // The last record has no newline.
+        file << num_lines;
+        expected_sum += num_lines;
+    }
+
+    thread_pool tp{};
+    std::atomic_long num_records{0};
+    std::atomic_long sum{0};
+    // Use a small chunk size to force many chunks.
+    parallel_for_each_line(tp, path, [&](std::string_view _line) {
+        ++num_records;
+        sum += std::stol(std::string{_line});
+    }, 4096);
+
+    EXPECT_EQ(num_records.load(), num_lines + 1);
+    EXPECT_EQ(sum.load(), expected_sum);
+
+    std::filesystem::remove(path);
+    EXPECT_THROW(parallel_for_each_line(tp, path, [](std::string_view) {}), std::system_error);
+}
+
+TEST(io, io_executor) {
+    const std::string path = (std::filesystem::temp_directory_path() / "mkr_mt_io_executor.bin").string();
+    const std::size_t block_size = 4096;
+    const std::size_t num_blocks = 64;
+
+    thread_pool tp{};
+    for (bool use_io_uring : {true, false}) {
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        ASSERT_GE(fd, 0);
+
+        io_executor io{tp, 2, use_io_uring};
+        std::cout << "io_executor backend: " << (io.uses_io_uring() ? "io_uring" : "threads") << std::endl;
+
+        // Write every block asynchronously, then wait for each write and count the bytes it wrote.
+        std::vector<std::vector<char>> blocks(num_blocks);
+        std::size_t bytes_written = 0;
+        std::vector<std::future<std::int64_t>> writes;
+        for (std::size_t i = 0; i < num_blocks; ++i) {
+            blocks[i].assign(block_size, static_cast<char>('a' + i % 26));
+            writes.push_back(io.write(fd, blocks[i].data(), block_size, i * block_size));
+        }
+        for (auto& write : writes) {
+            tp.run_pending_tasks(write);
+            bytes_written += static_cast<std::size_t>(write.get());
+        }
+        EXPECT_EQ(bytes_written, block_size * num_blocks);
+
+        // Read the blocks back in reverse order, with the continuation verifying the contents on the thread pool.
+        std::vector<char> buffer(block_size * num_blocks);
+        std::atomic_size_t num_correct{0};
+        std::atomic_size_t num_done{0};
+        std::promise<void> all_read;
+        for (std::size_t i = num_blocks; i-- > 0;) {
+            io.async_read(fd, &buffer[i * block_size], block_size, i * block_size, [&, i](std::int64_t _result) {
+                if (_result == static_cast<std::int64_t>(block_size) &&
+                        std::equal(blocks[i].begin(), blocks[i].end(), buffer.begin() + i * block_size)) {
+                    ++num_correct;
+                }
+                if (++num_done == num_blocks) { all_read.set_value(); }
+            });
+        }
+        std::future<void> all_read_future = all_read.get_future();
+        tp.run_pending_tasks(all_read_future);
+        EXPECT_EQ(num_correct.load(), num_blocks);
+
+        // Errors are reported as a negated errno.
+        std::future<std::int64_t> bad_read = io.read(-1, buffer.data(), block_size, 0);
+        tp.run_pending_tasks(bad_read);
+        EXPECT_EQ(bad_read.get(), -EBADF);
+
+        ::close(fd);
+    }
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,36 @@
+#include "latency_test.h"
+#include <gtest/gtest.h>
+
+using namespace mkr;
+
+TEST(latency, open_loop) {
+    thread_pool tp{2};
+    const std::chrono::microseconds service_time{20};
+    // 5% of the nominal capacity, so that the thread pool keeps up even on a single CPU.
+    const double rate = 0.05 * 2 * 1e6 / 20;
+    latency_test::load_point point = latency_test::measure(tp, rate, std::chrono::milliseconds{200}, service_time);
+    latency_test::print_header();
+    latency_test::print(point);
+
+    // About rate * duration tasks arrive, and every one of them finishes.
+    EXPECT_GT(point.num_tasks_, 0.5 * rate * 0.2);
+    EXPECT_LT(point.num_tasks_, 1.5 * rate * 0.2);
+    EXPECT_GT(point.throughput_, 0.5 * rate);
+
+    // A task takes at least its service time from its arrival to its end.
+    EXPECT_GE(point.p50_, static_cast<uint64_t>(std::chrono::nanoseconds{service_time}.count()));
+    EXPECT_LE(point.p50_, point.p90_);
+    EXPECT_LE(point.p90_, point.p99_);
+    EXPECT_LE(point.p99_, point.p999_);
+    EXPECT_LE(point.p999_, point.max_);
+}
+
+TEST(latency, percentile) {
+    std::vector<uint64_t> sorted(100);
+    for (std::size_t i = 0; i < sorted.size(); ++i) { sorted[i] = i + 1; }
+    EXPECT_EQ(latency_test::percentile(sorted, 50.0), 50u);
+    EXPECT_EQ(latency_test::percentile(sorted, 99.0), 99u);
+    EXPECT_EQ(latency_test::percentile(sorted, 99.9), 100u);
+    EXPECT_EQ(latency_test::percentile(sorted, 0.0), 1u);
+    EXPECT_EQ(latency_test::percentile({}, 50.0), 0u);
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "mt/thread_pool/thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+namespace mkr {
+    /**
+     * An open-loop latency-under-load benchmark of mkr::thread_pool, which models a request-serving process.
+     *
+     * External threads submit tasks at a fixed average arrival rate, with Poisson arrivals, whether or not the earlier tasks have
+     * finished. The latency of a task is measured from the time it was scheduled to arrive to the time it finished. A submitting thread
+     * which falls behind its schedule does not postpone the arrivals, so the queueing delay caused by a stall is counted for every task
+     * it delayed, and the percentiles do not suffer from coordinated omission.
+     */
+    class latency_test {
+    public:
+        latency_test() = delete;
+
+        /**
+         * The latency percentiles at one offered load.
+         */
+        struct load_point {
+            /// The offered arrival rate, in tasks per second.
+            double offered_rate_ = 0.0;
+            /// The rate at which the tasks finished, in tasks per second.
+            double throughput_ = 0.0;
+            /// The number of tasks.
+            std::size_t num_tasks_ = 0;
+            /// Latency percentiles, in nanoseconds.
+            uint64_t p50_ = 0, p90_ = 0, p99_ = 0, p999_ = 0, max_ = 0;
+        };
+
+        /**
+         * Keep a thread busy for a duration, like a task which does some work.
+         */
+        static void spin_for(std::chrono::nanoseconds _duration) {
+            const auto end_time = std::chrono::steady_clock::now() + _duration;
+            while (std::chrono::steady_clock::now() < end_time) { }
+        }
+
+        /**
+         * The nearest-rank percentile of sorted values.
+         */
+        static uint64_t percentile(const std::vector<uint64_t> &_sorted, double _percentile) {
+            if (_sorted.empty()) { return 0; }
+            const std::size_t rank = static_cast<std::size_t>(std::ceil(_percentile / 100.0 * static_cast<double>(_sorted.size())));
+            return _sorted[std::clamp<std::size_t>(rank, 1, _sorted.size()) - 1];
+        }
+
+        /**
+         * Offer tasks to a thread pool at a fixed average rate, and measure their latency.
+         * @param _thread_pool The thread pool.
+         * @param _rate The average arrival rate, in tasks per second, over all the submitting threads.
+         * @param _duration How long tasks arrive for.
+         * @param _service_time How long each task keeps a worker busy.
+         * @param _num_submitters The number of external threads which submit the tasks.
+         * @param _seed The seed of the arrival times.
+         * @return The latency percentiles.
+         */
+        static load_point measure(thread_pool &_thread_pool, double _rate, std::chrono::nanoseconds _duration, std::chrono::nanoseconds _service_time,
+                                  std::size_t _num_submitters = 2, unsigned _seed = 42) {
+            typedef std::chrono::steady_clock clock;
+
+            // The arrival schedule is drawn before the run, so that drawing it does not slow down the submitters.
+            // Exponential inter-arrival times give Poisson arrivals.
+            std::vector<std::vector<clock::duration>> schedules(_num_submitters);
+            std::size_t num_tasks = 0;
+            for (std::size_t s = 0; s < _num_submitters; ++s) {
+                std::mt19937_64 rng{_seed + s};
+                std::exponential_distribution<double> gap{_rate / static_cast<double>(_num_submitters) * 1e-9};
+                for (double t = gap(rng); t < static_cast<double>(_duration.count()); t += gap(rng)) {
+                    schedules[s].push_back(std::chrono::duration_cast<clock::duration>(std::chrono::nanoseconds{static_cast<long long>(t)}));
+                }
+                num_tasks += schedules[s].size();
+            }
+
+            std::vector<std::vector<uint64_t>> latencies(_num_submitters);
+            for (std::size_t s = 0; s < _num_submitters; ++s) { latencies[s].resize(schedules[s].size()); }
+            std::atomic_size_t num_finished{0};
+            std::atomic<clock::rep> last_finish{0};
+
+            const clock::time_point start_time = clock::now() + std::chrono::milliseconds{1};
+            std::vector<std::thread> submitters;
+            for (std::size_t s = 0; s < _num_submitters; ++s) {
+                submitters.emplace_back([&, s]() {
+#ifdef __linux__
+                    // Wake up as close to each arrival time as possible. The default timer slack of 50us would delay most arrivals.
+                    prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+#endif
+                    for (std::size_t i = 0; i < schedules[s].size(); ++i) {
+                        const clock::time_point arrival = start_time + schedules[s][i];
+                        std::this_thread::sleep_until(arrival);
+                        uint64_t *latency = &latencies[s][i];
+                        _thread_pool.post([&, arrival, latency]() {
+                            spin_for(_service_time);
+                            const clock::time_point finish = clock::now();
+                            *latency = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(finish - arrival).count());
+                            clock::rep previous = last_finish.load();
+                            while (previous < finish.time_since_epoch().count() &&
+                                   !last_finish.compare_exchange_weak(previous, finish.time_since_epoch().count())) { }
+                            num_finished.fetch_add(1, std::memory_order_release);
+                        });
+                    }
+                });
+            }
+            for (std::thread &submitter : submitters) { submitter.join(); }
+            while (num_finished.load(std::memory_order_acquire) < num_tasks) { std::this_thread::yield(); }
+
+            std::vector<uint64_t> sorted;
+            sorted.reserve(num_tasks);
+            for (const std::vector<uint64_t> &l : latencies) { sorted.insert(sorted.end(), l.begin(), l.end()); }
+            std::sort(sorted.begin(), sorted.end());
+
+            load_point point;
+            point.offered_rate_ = _rate;
+            point.num_tasks_ = num_tasks;
+            const double elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::time_point{clock::duration{last_finish.load()}} - start_time).count()) * 1e-9;
+            point.throughput_ = elapsed > 0.0 ? static_cast<double>(num_tasks) / elapsed : 0.0;
+            point.p50_ = percentile(sorted, 50.0);
+            point.p90_ = percentile(sorted, 90.0);
+            point.p99_ = percentile(sorted, 99.0);
+            point.p999_ = percentile(sorted, 99.9);
+            point.max_ = sorted.empty() ? 0 : sorted.back();
+            return point;
+        }
+
+        static void print_header() {
+            std::printf("%12s %12s %8s %10s %10s %10s %10s %10s\n", "offered/s", "achieved/s", "tasks", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+        }
+
+        static void print(const load_point &_point) {
+            std::printf("%12.0f %12.0f %8zu %10.1f %10.1f %10.1f %10.1f %10.1f\n", _point.offered_rate_, _point.throughput_, _point.num_tasks_,
+                        _point.p50_ * 1e-3, _point.p90_ * 1e-3, _point.p99_ * 1e-3, _point.p999_ * 1e-3, _point.max_ * 1e-3);
+        }
+
+        /**
+         * Call this function to run the latency-under-load demo. The offered load is swept from 10% of the thread pool's nominal capacity
+         * (num_threads() / _service_time) upwards, and the sweep stops at the first load which saturates the thread pool, which is when
+         * it finishes fewer than 95% of the offered tasks per second, or the p99 latency exceeds 100 times the service time.
+         * @param _step_duration How long tasks arrive for at each load.
+         * @param _service_time How long each task keeps a worker busy.
+         * @param _num_submitters The number of external threads which submit the tasks.
+         * @return The latency percentiles at each load.
+         */
+        static std::vector<load_point> run(std::chrono::nanoseconds _step_duration = std::chrono::seconds{2},
+                                           std::chrono::nanoseconds _service_time = std::chrono::microseconds{50}, std::size_t _num_submitters = 2) {
+            thread_pool tp{};
+            const double capacity = static_cast<double>(tp.num_threads()) * 1e9 / static_cast<double>(_service_time.count());
+            std::cout << "Open-Loop Latency Under Load (mkr::thread_pool - " << tp.num_threads() << " Threads, "
+                      << std::chrono::duration_cast<std::chrono::microseconds>(_service_time).count() << "us Tasks, Nominal Capacity "
+                      << static_cast<long>(capacity) << "/s)" << std::endl;
+            print_header();
+
+            std::vector<load_point> points;
+            for (double load : {0.1, 0.2, 0.3, 0.4, 0.5, 0.6, 0.7, 0.8, 0.85, 0.9, 0.95, 1.0, 1.05, 1.1, 1.2}) {
+                points.push_back(measure(tp, load * capacity, _step_duration, _service_time, _num_submitters));
+                print(points.back());
+                if (points.back().throughput_ < 0.95 * points.back().offered_rate_ ||
+                    points.back().p99_ > 100 * static_cast<uint64_t>(_service_time.count())) {
+                    std::cout << "Saturated." << std::endl;
+                    break;
+                }
+            }
+            std::cout << std::endl;
+            return points;
+        }
+    };
+}
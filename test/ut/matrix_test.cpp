@@ -0,0 +1,80 @@
+#include "matrix_test.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cmath>
+
+using namespace mkr;
+
+TEST(blocked_range, split_2d_3d) {
+    thread_pool tp{};
+
+    // Every cell is visited exactly once, and the leaves are no larger than the grain size in either dimension.
+    const std::size_t rows = 301, cols = 517;
+    std::vector<std::atomic_int> visits2d(rows * cols);
+    parallel_for(tp, blocked_range2d<std::size_t>{0, rows, 16, 0, cols, 32}, [&](const blocked_range2d<std::size_t>& _range) {
+        EXPECT_LE(_range.rows().size(), 16u);
+        EXPECT_LE(_range.cols().size(), 32u);
+        for (std::size_t i = _range.rows().begin(); i<_range.rows().end(); ++i) {
+            for (std::size_t j = _range.cols().begin(); j<_range.cols().end(); ++j) { ++visits2d[i*cols+j]; }
+        }
+    });
+    for (const std::atomic_int& v : visits2d) { ASSERT_EQ(v.load(), 1); }
+
+    // The longer dimension is split first.
+    blocked_range2d<int> wide{0, 10, 1, 0, 1000, 1};
+    blocked_range2d<int> right = wide.split();
+    EXPECT_EQ(wide.rows().size(), 10u);
+    EXPECT_EQ(wide.cols().end(), 500);
+    EXPECT_EQ(right.cols().begin(), 500);
+
+    const std::size_t pages = 13, rows3d = 29, cols3d = 41;
+    std::vector<std::atomic_int> visits3d(pages * rows3d * cols3d);
+    parallel_for(tp, blocked_range3d<std::size_t>{{0, pages, 4}, {0, rows3d, 8}, {0, cols3d, 8}}, [&](const blocked_range3d<std::size_t>& _range) {
+        for (std::size_t p = _range.pages().begin(); p<_range.pages().end(); ++p) {
+            for (std::size_t i = _range.rows().begin(); i<_range.rows().end(); ++i) {
+                for (std::size_t j = _range.cols().begin(); j<_range.cols().end(); ++j) { ++visits3d[(p*rows3d+i)*cols3d+j]; }
+            }
+        }
+    });
+    for (const std::atomic_int& v : visits3d) { ASSERT_EQ(v.load(), 1); }
+}
+
+TEST(matrix, transpose) {
+    thread_pool tp{};
+    const std::size_t rows = 1000, cols = 1500, tile_size = 64;
+    std::vector<float> a = matrix_test::random_matrix(rows, cols);
+    std::vector<float> expected(rows * cols), result(rows * cols);
+
+    matrix_test::single_thread_transpose(a.data(), expected.data(), rows, cols);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    matrix_test::tiled_transpose(tp, a.data(), result.data(), rows, cols, tile_size);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "Tiled Transpose " << rows << "x" << cols << ": "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() << "ms" << std::endl;
+
+    EXPECT_EQ(result, expected);
+}
+
+TEST(matrix, gemm) {
+    thread_pool tp{};
+    const std::size_t m = 200, n = 300, k = 250, tile_size = 64;
+    std::vector<float> a = matrix_test::random_matrix(m, k);
+    std::vector<float> b = matrix_test::random_matrix(k, n);
+    std::vector<float> expected(m * n), result(m * n);
+
+    matrix_test::single_thread_gemm(a.data(), b.data(), expected.data(), m, n, k);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    matrix_test::tiled_gemm(tp, a.data(), b.data(), result.data(), m, n, k, tile_size);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::cout << "Tiled GEMM " << m << "x" << k << " * " << k << "x" << n << ": "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count() << "ms" << std::endl;
+
+    // The tiled version sums the inner products in the same order, but allow for the compiler contracting differently.
+    for (std::size_t i = 0; i < m * n; ++i) { ASSERT_NEAR(result[i], expected[i], 1e-3f); }
+
+    matrix_test::row_parallel_gemm(tp, a.data(), b.data(), result.data(), m, n, k, 16);
+    for (std::size_t i = 0; i < m * n; ++i) { ASSERT_NEAR(result[i], expected[i], 1e-3f); }
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "mt/algorithm/parallel_for.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace mkr {
+    /**
+     * A demo of the effect of cache blocking on parallel matrix transpose and matrix multiplication.
+     * Matrices are stored in row-major order.
+     */
+    class matrix_test {
+    public:
+        matrix_test() = delete;
+
+        static std::vector<float> random_matrix(std::size_t _rows, std::size_t _cols) {
+            std::mt19937 rng{42};
+            std::uniform_real_distribution<float> dist{-1.0f, 1.0f};
+            std::vector<float> matrix(_rows * _cols);
+            for (float& value : matrix) { value = dist(rng); }
+            return matrix;
+        }
+
+        /**
+         * Transpose the _rows x _cols matrix _a into the _cols x _rows matrix _b on a single thread.
+         */
+        static void single_thread_transpose(const float *_a, float *_b, std::size_t _rows, std::size_t _cols) {
+            for (std::size_t i = 0; i < _rows; ++i) {
+                for (std::size_t j = 0; j < _cols; ++j) {
+                    _b[j * _rows + i] = _a[i * _cols + j];
+                }
+            }
+        }
+
+        /**
+         * Transpose by splitting the rows of _a only. Each task reads whole rows of _a, but writes one column of _b per row,
+         * touching a different cache line of _b for every element.
+         */
+        static void row_parallel_transpose(thread_pool &_thread_pool, const float *_a, float *_b, std::size_t _rows, std::size_t _cols,
+                                           std::size_t _grain_size) {
+            parallel_for(_thread_pool, blocked_range<std::size_t>{0, _rows, _grain_size}, [=](const blocked_range<std::size_t> &_range) {
+                for (std::size_t i = _range.begin(); i < _range.end(); ++i) {
+                    for (std::size_t j = 0; j < _cols; ++j) {
+                        _b[j * _rows + i] = _a[i * _cols + j];
+                    }
+                }
+            });
+        }
+
+        /**
+         * Transpose tile by tile. Each task reads and writes a tile of about _tile_size x _tile_size elements, which fits in cache,
+         * so every cache line of _a and _b that a task touches is fully used.
+         */
+        static void tiled_transpose(thread_pool &_thread_pool, const float *_a, float *_b, std::size_t _rows, std::size_t _cols,
+                                    std::size_t _tile_size) {
+            parallel_for(_thread_pool, blocked_range2d<std::size_t>{0, _rows, _tile_size, 0, _cols, _tile_size},
+                         [=](const blocked_range2d<std::size_t> &_range) {
+                for (std::size_t i = _range.rows().begin(); i < _range.rows().end(); ++i) {
+                    for (std::size_t j = _range.cols().begin(); j < _range.cols().end(); ++j) {
+                        _b[j * _rows + i] = _a[i * _cols + j];
+                    }
+                }
+            });
+        }
+
+        /**
+         * Compute _c = _a * _b on a single thread, where _a is _m x _k, _b is _k x _n and _c is _m x _n.
+         */
+        static void single_thread_gemm(const float *_a, const float *_b, float *_c, std::size_t _m, std::size_t _n, std::size_t _k) {
+            for (std::size_t i = 0; i < _m; ++i) {
+                for (std::size_t j = 0; j < _n; ++j) { _c[i * _n + j] = 0.0f; }
+                for (std::size_t p = 0; p < _k; ++p) {
+                    const float a = _a[i * _k + p];
+                    for (std::size_t j = 0; j < _n; ++j) { _c[i * _n + j] += a * _b[p * _n + j]; }
+                }
+            }
+        }
+
+        /**
+         * Compute _c = _a * _b by splitting the rows of _c only. Every task streams the whole of _b through the cache for each of its rows.
+         */
+        static void row_parallel_gemm(thread_pool &_thread_pool, const float *_a, const float *_b, float *_c, std::size_t _m, std::size_t _n,
+                                      std::size_t _k, std::size_t _grain_size) {
+            parallel_for(_thread_pool, blocked_range<std::size_t>{0, _m, _grain_size}, [=](const blocked_range<std::size_t> &_range) {
+                for (std::size_t i = _range.begin(); i < _range.end(); ++i) {
+                    for (std::size_t j = 0; j < _n; ++j) { _c[i * _n + j] = 0.0f; }
+                    for (std::size_t p = 0; p < _k; ++p) {
+                        const float a = _a[i * _k + p];
+                        for (std::size_t j = 0; j < _n; ++j) { _c[i * _n + j] += a * _b[p * _n + j]; }
+                    }
+                }
+            });
+        }
+
+        /**
+         * Compute _c = _a * _b tile by tile. Each task owns a tile of _c, and walks the inner dimension in blocks of _tile_size,
+         * so the tiles of _a, _b and _c it works on at any time fit in cache together.
+         */
+        static void tiled_gemm(thread_pool &_thread_pool, const float *_a, const float *_b, float *_c, std::size_t _m, std::size_t _n,
+                               std::size_t _k, std::size_t _tile_size) {
+            parallel_for(_thread_pool, blocked_range2d<std::size_t>{0, _m, _tile_size, 0, _n, _tile_size},
+                         [=](const blocked_range2d<std::size_t> &_range) {
+                const std::size_t row_begin = _range.rows().begin(), row_end = _range.rows().end();
+                const std::size_t col_begin = _range.cols().begin(), col_end = _range.cols().end();
+
+                for (std::size_t i = row_begin; i < row_end; ++i) {
+                    for (std::size_t j = col_begin; j < col_end; ++j) { _c[i * _n + j] = 0.0f; }
+                }
+                for (std::size_t p_begin = 0; p_begin < _k; p_begin += _tile_size) {
+                    const std::size_t p_end = std::min(p_begin + _tile_size, _k);
+                    for (std::size_t i = row_begin; i < row_end; ++i) {
+                        for (std::size_t p = p_begin; p < p_end; ++p) {
+                            const float a = _a[i * _k + p];
+                            for (std::size_t j = col_begin; j < col_end; ++j) { _c[i * _n + j] += a * _b[p * _n + j]; }
+                        }
+                    }
+                }
+            });
+        }
+
+        template<typename Function>
+        static void time(const std::string &_name, int _num_loops, Function &&_function) {
+            std::cout << _name << std::endl;
+            long total_duration = 0;
+            for (int i = 0; i < _num_loops; ++i) {
+                auto start_time = std::chrono::high_resolution_clock::now();
+                _function();
+                auto end_time = std::chrono::high_resolution_clock::now();
+                total_duration += std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+            }
+            std::cout << "Average Time Taken (" << _num_loops << " Loops): " << total_duration / _num_loops << "ms" << std::endl << std::endl;
+        }
+
+        /**
+         * Call this function to run the matrix demo.
+         * @param _num_loops The number of times each test runs. The more times a test run, the more accurate the average time.
+         * @param _transpose_size The number of rows and columns of the transposed matrix.
+         * @param _gemm_size The number of rows and columns of the multiplied matrices.
+         * @param _tile_size The number of rows and columns of a tile. A tile of each matrix should fit in the L1 or L2 cache.
+         */
+        static void run(int _num_loops = 4, std::size_t _transpose_size = 8192, std::size_t _gemm_size = 1024, std::size_t _tile_size = 64) {
+            std::cout << "Number of Hardware Threads Your System Supports: " << std::thread::hardware_concurrency() << "\n" << std::endl;
+            thread_pool tp{};
+
+            {
+                const std::size_t n = _transpose_size;
+                std::vector<float> a = random_matrix(n, n);
+                std::vector<float> b(n * n);
+                const std::string size = std::to_string(n) + "x" + std::to_string(n);
+
+                time("Transpose " + size + " (Single Thread)", _num_loops, [&]() { single_thread_transpose(a.data(), b.data(), n, n); });
+                time("Transpose " + size + " (mkr::thread_pool - " + std::to_string(tp.num_threads()) + " Threads, Rows)", _num_loops,
+                     [&]() { row_parallel_transpose(tp, a.data(), b.data(), n, n, _tile_size); });
+                time("Transpose " + size + " (mkr::thread_pool - " + std::to_string(tp.num_threads()) + " Threads, Tiles)", _num_loops,
+                     [&]() { tiled_transpose(tp, a.data(), b.data(), n, n, _tile_size); });
+            }
+
+            {
+                const std::size_t n = _gemm_size;
+                std::vector<float> a = random_matrix(n, n);
+                std::vector<float> b = random_matrix(n, n);
+                std::vector<float> c(n * n);
+                const std::string size = std::to_string(n) + "x" + std::to_string(n);
+
+                time("GEMM " + size + " (Single Thread)", _num_loops, [&]() { single_thread_gemm(a.data(), b.data(), c.data(), n, n, n); });
+                time("GEMM " + size + " (mkr::thread_pool - " + std::to_string(tp.num_threads()) + " Threads, Rows)", _num_loops,
+                     [&]() { row_parallel_gemm(tp, a.data(), b.data(), c.data(), n, n, n, _tile_size); });
+                time("GEMM " + size + " (mkr::thread_pool - " + std::to_string(tp.num_threads()) + " Threads, Tiles)", _num_loops,
+                     [&]() { tiled_gemm(tp, a.data(), b.data(), c.data(), n, n, n, _tile_size); });
+            }
+        }
+    };
+}
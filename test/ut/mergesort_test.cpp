@@ -41,12 +41,20 @@ TEST(mergesort, correctness) {
         thread_pool tp{};
         std::cout << "Merge Sort " << array_size << " Numbers (mkr::thread_pool - " << tp.num_threads() << " Threads)" << std::endl;
 
+        thread_perf_counters counters;
+        counters.start();
         auto start_time = std::chrono::high_resolution_clock::now();
         mergesort_test::thread_pool_mergesort(&tp_sorted_array[0], &temp_buffer[0], 0, array_size, &tp, granularity);
         auto end_time = std::chrono::high_resolution_clock::now();
+        counters.stop();
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
 
-        std::cout << "Time Taken: " << duration << "ms" << std::endl << std::endl;
+        std::cout << "Time Taken: " << duration << "ms" << std::endl;
+        perf_sample total_counters;
+        std::vector<perf_sample> thread_counters;
+        mergesort_test::accumulate_counters(counters, total_counters, thread_counters);
+        mergesort_test::print_counters(counters.available(), total_counters, thread_counters);
+        std::cout << std::endl;
     }
 
     // std::async
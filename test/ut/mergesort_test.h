@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mt/thread_pool/thread_pool.h"
+#include "mt/util/perf_counters.h"
 #include <iostream>
 #include <cstring>
 
@@ -46,9 +47,9 @@ namespace mkr {
             do_sort(_array, _temp_buffer, _start, mid, _end);
         }
 
-        template<typename T>
+        template<typename T, executor Executor>
         static void
-        thread_pool_mergesort(T *_array, T *_temp_buffer, int _start, int _end, thread_pool *_thread_pool,
+        thread_pool_mergesort(T *_array, T *_temp_buffer, int _start, int _end, Executor *_thread_pool,
                               int _granularity) {
             int num_elements = _end - _start;
             if (num_elements <= 1) { return; }
@@ -105,6 +106,32 @@ namespace mkr {
             do_sort(_array, _temp_buffer, _start, mid, _end);
         }
 
+        /**
+         * Add the counters of a run to the totals of every run. Threads are matched by their position, so the calling thread is always first.
+         */
+        static void accumulate_counters(const thread_perf_counters &_counters, perf_sample &_total, std::vector<perf_sample> &_threads) {
+            const std::vector<std::pair<pid_t, perf_sample>> samples = _counters.read();
+            if (_threads.size() < samples.size()) { _threads.resize(samples.size()); }
+            for (std::size_t i = 0; i < samples.size(); ++i) {
+                _total += samples[i].second;
+                _threads[i] += samples[i].second;
+            }
+        }
+
+        /**
+         * Print the hardware counters of every run, in total and per thread.
+         */
+        static void print_counters(bool _available, const perf_sample &_total, const std::vector<perf_sample> &_threads) {
+            if (!_available) {
+                std::cout << "Counters: unavailable (perf_event_open failed, see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+                return;
+            }
+            std::cout << "Counters: " << _total.to_string() << std::endl;
+            for (std::size_t i = 0; i < _threads.size(); ++i) {
+                std::cout << "  " << (i == 0 ? "Calling Thread" : "Worker " + std::to_string(i - 1)) << ": " << _threads[i].to_string() << std::endl;
+            }
+        }
+
         template<typename T>
         static void print_array(T _array[], int _size) {
             for (int i = 0; i < _size; ++i) {
@@ -143,14 +170,22 @@ namespace mkr {
             {
                 std::cout << "Merge Sort " << _array_size << " Numbers (Single Thread)" << std::endl;
                 long total_duration = 0;
+                bool counters_available = false;
+                perf_sample total_counters;
+                std::vector<perf_sample> thread_counters;
                 for (int i = 0; i < _num_loops; ++i) {
                     int *sorted_array = new int[_array_size];
                     int *temp_buffer = new int[_array_size];
                     std::memcpy(&sorted_array[0], &unsorted_array[0], _array_size * sizeof(unsorted_array[0]));
 
+                    perf_counters counters;
+                    counters.start();
                     auto start_time = std::chrono::high_resolution_clock::now();
                     single_thread_mergesort(&sorted_array[0], &temp_buffer[0], 0, _array_size);
                     auto end_time = std::chrono::high_resolution_clock::now();
+                    counters.stop();
+                    counters_available = counters.available();
+                    total_counters += counters.read();
                     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                             end_time - start_time).count();
 
@@ -167,6 +202,7 @@ namespace mkr {
                 std::cout << "Total Time Taken: " << total_duration << "ms" << std::endl;
                 std::cout << "Average Time Taken (" << _num_loops << " Loops): " << total_duration / _num_loops << "ms"
                           << std::endl;
+                print_counters(counters_available, total_counters, thread_counters);
                 std::cout << std::endl;
             }
 
@@ -177,15 +213,24 @@ namespace mkr {
                     std::cout << "Merge Sort " << _array_size << " Numbers (mkr::thread_pool - " << num_threads[n]
                               << " Threads)" << std::endl;
                     long total_duration = 0;
+                    bool counters_available = false;
+                    perf_sample total_counters;
+                    std::vector<perf_sample> thread_counters;
                     for (int i = 0; i < _num_loops; ++i) {
                         thread_pool tp{num_threads[n] - 1};
                         int *sorted_array = new int[_array_size];
                         int *temp_buffer = new int[_array_size];
                         std::memcpy(&sorted_array[0], &unsorted_array[0], _array_size * sizeof(unsorted_array[0]));
 
+                        // Opened after the thread pool, so that its worker threads are counted too.
+                        thread_perf_counters counters;
+                        counters.start();
                         auto start_time = std::chrono::high_resolution_clock::now();
                         thread_pool_mergesort(&sorted_array[0], &temp_buffer[0], 0, _array_size, &tp, _granularity);
                         auto end_time = std::chrono::high_resolution_clock::now();
+                        counters.stop();
+                        counters_available = counters.available();
+                        accumulate_counters(counters, total_counters, thread_counters);
                         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                                 end_time - start_time).count();
                         total_duration += duration;
@@ -202,6 +247,7 @@ namespace mkr {
                     std::cout << "Average Time Taken (" << _num_loops << " Loops): " << total_duration / _num_loops
                               << "ms"
                               << std::endl;
+                    print_counters(counters_available, total_counters, thread_counters);
                     std::cout << std::endl;
                 }
             }
@@ -210,14 +256,23 @@ namespace mkr {
             {
                 std::cout << "Merge Sort " << _array_size << " Numbers (std::async)" << std::endl;
                 long total_duration = 0;
+                bool counters_available = false;
+                perf_sample total_counters;
+                std::vector<perf_sample> thread_counters;
                 for (int i = 0; i < _num_loops; ++i) {
                     int *sorted_array = new int[_array_size];
                     int *temp_buffer = new int[_array_size];
                     std::memcpy(&sorted_array[0], &unsorted_array[0], _array_size * sizeof(unsorted_array[0]));
 
+                    // std::async creates its threads during the sort, so only the calling thread is counted.
+                    perf_counters counters;
+                    counters.start();
                     auto start_time = std::chrono::high_resolution_clock::now();
                     async_mergesort(&sorted_array[0], &temp_buffer[0], 0, _array_size, _granularity);
                     auto end_time = std::chrono::high_resolution_clock::now();
+                    counters.stop();
+                    counters_available = counters.available();
+                    total_counters += counters.read();
                     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(
                             end_time - start_time).count();
 
@@ -234,6 +289,7 @@ namespace mkr {
                 std::cout << "Total Time Taken: " << total_duration << "ms" << std::endl;
                 std::cout << "Average Time Taken (" << _num_loops << " Loops): " << total_duration / _num_loops << "ms"
                           << std::endl;
+                print_counters(counters_available, total_counters, thread_counters);
                 std::cout << std::endl;
             }
 
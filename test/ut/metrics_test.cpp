@@ -0,0 +1,103 @@
+#include "mt/metrics/metrics_http_server.h"
+#include "mt/container/threadsafe_hashtable.h"
+#include "mt/container/threadsafe_queue.h"
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <vector>
+
+using namespace mkr;
+
+namespace {
+    /**
+     * Send a request to a server on localhost, and read the whole response.
+     */
+    std::string http_get(std::uint16_t _port, const std::string& _path)
+    {
+        const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(_port);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address))<0) {
+            ::close(fd);
+            return "";
+        }
+
+        const std::string request = "GET "+_path+" HTTP/1.1\r\nHost: localhost\r\n\r\n";
+        ::send(fd, request.data(), request.size(), 0);
+        std::string response;
+        char buffer[4096];
+        for (ssize_t n; (n = ::recv(fd, buffer, sizeof(buffer), 0))>0;) { response.append(buffer, static_cast<std::size_t>(n)); }
+        ::close(fd);
+        return response;
+    }
+}
+
+TEST(metrics, thread_pool_stats) {
+    thread_pool tp{2};
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i<100; ++i) { futures.push_back(tp.submit([i]() { return i; })); }
+    for (std::future<int>& f : futures) { f.get(); }
+
+    const thread_pool_stats stats = tp.get_stats();
+    EXPECT_EQ(stats.num_threads_, 2u);
+    EXPECT_EQ(stats.local_queue_depths_.size(), 2u);
+    EXPECT_GE(stats.num_tasks_run_, 100u);
+    EXPECT_GE(stats.latency_count_, 100u);
+    EXPECT_GE(stats.idle_fraction_, 0.0);
+    EXPECT_LE(stats.idle_fraction_, 1.0);
+}
+
+TEST(metrics, render) {
+    thread_pool tp{2};
+    threadsafe_queue<int> queue;
+    threadsafe_hashtable<int, int> hashtable;
+    for (int i = 0; i<10; ++i) {
+        queue.push(i);
+        hashtable.insert_or_replace(i, i);
+    }
+    tp.submit([]() { }).get();
+
+    metrics_registry registry;
+    registry.add_thread_pool("main", tp);
+    registry.add_container("requests", queue);
+    registry.add_container("cache", hashtable);
+
+    const std::string text = registry.render_prometheus();
+    EXPECT_NE(text.find("# TYPE mkr_thread_pool_tasks_run_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("mkr_thread_pool_threads{pool=\"main\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("mkr_thread_pool_queue_depth{pool=\"main\",queue=\"local\",worker=\"1\"}"), std::string::npos);
+    EXPECT_NE(text.find("mkr_thread_pool_task_latency_seconds_bucket{pool=\"main\",le=\"+Inf\"}"), std::string::npos);
+    EXPECT_NE(text.find("mkr_container_size{container=\"requests\"} 10\n"), std::string::npos);
+    EXPECT_NE(text.find("mkr_container_size{container=\"cache\"} 10\n"), std::string::npos);
+    EXPECT_NE(text.find("mkr_container_contentions_total{container=\"cache\"} 0\n"), std::string::npos);
+
+    const std::string json = registry.render_json();
+    EXPECT_EQ(json.rfind("{\"metrics\":[", 0), 0u);
+    EXPECT_NE(json.find("{\"name\":\"mkr_container_size\",\"labels\":{\"container\":\"requests\"},\"value\":10}"), std::string::npos);
+
+    registry.remove("requests");
+    EXPECT_EQ(registry.render_prometheus().find("container=\"requests\""), std::string::npos);
+}
+
+TEST(metrics, http_server) {
+    thread_pool tp{2};
+    metrics_registry registry;
+    registry.add_thread_pool("main", tp);
+    metrics_http_server server{registry};
+    ASSERT_NE(server.port(), 0);
+
+    const std::string text = http_get(server.port(), "/metrics");
+    EXPECT_EQ(text.rfind("HTTP/1.1 200 OK\r\n", 0), 0u);
+    EXPECT_NE(text.find("mkr_thread_pool_threads{pool=\"main\"} 2\n"), std::string::npos);
+
+    const std::string json = http_get(server.port(), "/metrics.json");
+    EXPECT_NE(json.find("Content-Type: application/json"), std::string::npos);
+
+    EXPECT_EQ(http_get(server.port(), "/other").rfind("HTTP/1.1 404", 0), 0u);
+}
@@ -0,0 +1,48 @@
+#include "mt/algorithm/parallel_hash_join.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace mkr;
+
+TEST(parallel_hash_join, correctness) {
+    struct order { int customer_id_; int order_id_; };
+    struct customer { int customer_id_; int region_; };
+
+    const int num_customers = 20000;
+    const int num_orders = 100000;
+
+    std::vector<customer> customers;
+    for (int i = 0; i < num_customers; ++i) {
+        // Every 10th customer has a duplicate row, and customers >= num_customers/2 have no orders.
+        customers.push_back(customer{i, i % 7});
+        if (i % 10 == 0) { customers.push_back(customer{i, -1}); }
+    }
+    std::vector<order> orders;
+    for (int i = 0; i < num_orders; ++i) {
+        orders.push_back(order{std::rand() % num_customers + num_customers / 2, i});
+    }
+
+    auto key_fn = [](const auto& _row) { return _row.customer_id_; };
+    auto emit = [](const customer& _c, const order& _o) { return std::make_pair(_o.order_id_, _c.region_); };
+
+    thread_pool tp{};
+    // Use a tiny cache size to force many partitions.
+    auto buffers = parallel_hash_join(tp, customers, orders, key_fn, emit, 4096);
+
+    std::vector<std::pair<int, int>> result;
+    for (auto& buffer : buffers) { result.insert(result.end(), buffer.begin(), buffer.end()); }
+
+    std::unordered_multimap<int, int> reference_table;
+    for (const customer& c : customers) { reference_table.emplace(c.customer_id_, c.region_); }
+    std::vector<std::pair<int, int>> expected;
+    for (const order& o : orders) {
+        auto [first, last] = reference_table.equal_range(o.customer_id_);
+        for (auto it = first; it != last; ++it) { expected.emplace_back(o.order_id_, it->second); }
+    }
+
+    std::sort(result.begin(), result.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(result, expected);
+}
@@ -0,0 +1,69 @@
+#include "mt/algorithm/parallel_policy.h"
+#include "mt/executor/inline_executor.h"
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <random>
+
+using namespace mkr;
+
+TEST(parallel_policy, algorithms) {
+    thread_pool tp{};
+    std::mt19937 rng{42};
+    std::vector<int> values(200000);
+    for (int& value : values) { value = static_cast<int>(rng()%100000); }
+
+    // for_each
+    std::vector<int> incremented = values;
+    mkr::for_each(mkr::par(tp), incremented.begin(), incremented.end(), [](int& _x) { ++_x; });
+    for (std::size_t i = 0; i<values.size(); ++i) { ASSERT_EQ(incremented[i], values[i]+1); }
+
+    // transform
+    std::vector<long long> squares(values.size());
+    auto squares_end = mkr::transform(mkr::par(tp), values.begin(), values.end(), squares.begin(), [](int _x) { return static_cast<long long>(_x)*_x; });
+    EXPECT_EQ(squares_end, squares.end());
+    std::vector<long long> expected_squares(values.size());
+    std::transform(values.begin(), values.end(), expected_squares.begin(), [](int _x) { return static_cast<long long>(_x)*_x; });
+    EXPECT_EQ(squares, expected_squares);
+
+    std::vector<int> differences(values.size());
+    mkr::transform(mkr::par(tp), incremented.begin(), incremented.end(), values.begin(), differences.begin(), std::minus<>{});
+    EXPECT_EQ(std::count(differences.begin(), differences.end(), 1), static_cast<std::ptrdiff_t>(values.size()));
+
+    // reduce
+    EXPECT_EQ(mkr::reduce(mkr::par(tp), squares.begin(), squares.end()), std::accumulate(squares.begin(), squares.end(), 0LL));
+    EXPECT_EQ(mkr::reduce(mkr::par(tp), values.begin(), values.end(), 0, [](int _a, int _b) { return std::max(_a, _b); }),
+              *std::max_element(values.begin(), values.end()));
+    EXPECT_EQ(mkr::reduce(mkr::par(tp), values.begin(), values.begin(), 7), 7);
+
+    // copy_if
+    std::vector<int> evens(values.size());
+    auto evens_end = mkr::copy_if(mkr::par(tp), values.begin(), values.end(), evens.begin(), [](int _x) { return _x%2==0; });
+    evens.erase(evens_end, evens.end());
+    std::vector<int> expected_evens;
+    std::copy_if(values.begin(), values.end(), std::back_inserter(expected_evens), [](int _x) { return _x%2==0; });
+    EXPECT_EQ(evens, expected_evens);
+
+    // sort
+    std::vector<int> sorted = values;
+    mkr::sort(mkr::par(tp), sorted.begin(), sorted.end(), std::greater<>{});
+    std::vector<int> expected_sorted = values;
+    std::sort(expected_sorted.begin(), expected_sorted.end(), std::greater<>{});
+    EXPECT_EQ(sorted, expected_sorted);
+}
+
+TEST(parallel_policy, executors) {
+    // Small inputs can run inline with no scheduling overhead, by swapping only the executor.
+    inline_executor inline_exec;
+    std::vector<int> values{5, 3, 1, 4, 2};
+    mkr::sort(mkr::par(inline_exec), values.begin(), values.end());
+    EXPECT_EQ(values, (std::vector<int>{1, 2, 3, 4, 5}));
+    EXPECT_EQ(mkr::reduce(mkr::par(inline_exec), values.begin(), values.end()), 15);
+
+    // An explicit grain size.
+    thread_pool tp{4};
+    std::vector<int> ones(1000, 1);
+    mkr::for_each(mkr::par(tp, 100), ones.begin(), ones.end(), [](int& _x) { _x *= 2; });
+    EXPECT_EQ(std::count(ones.begin(), ones.end(), 2), 1000);
+    EXPECT_EQ(mkr::reduce(mkr::par(tp).with_grain_size(7), ones.begin(), ones.end()), 2000);
+}
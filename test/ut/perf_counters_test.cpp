@@ -0,0 +1,66 @@
+#include "mt/util/perf_counters.h"
+#include "mt/thread_pool/thread_pool.h"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace mkr;
+
+TEST(perf_counters, sample) {
+    perf_sample a;
+    a.values_[static_cast<std::size_t>(perf_event::cycles)] = 100;
+    a.values_[static_cast<std::size_t>(perf_event::instructions)] = 250;
+    EXPECT_DOUBLE_EQ(*a.ipc(), 2.5);
+    EXPECT_EQ(a.to_string(), "cycles=100 instructions=250 (IPC 2.50) cache-misses=n/a branch-misses=n/a context-switches=n/a");
+
+    perf_sample b;
+    b.values_[static_cast<std::size_t>(perf_event::cycles)] = 50;
+    b.values_[static_cast<std::size_t>(perf_event::context_switches)] = 3;
+    a += b;
+    EXPECT_EQ(a.get(perf_event::cycles), 150u);
+    EXPECT_EQ(a.get(perf_event::instructions), 250u);
+    EXPECT_EQ(a.get(perf_event::context_switches), 3u);
+    EXPECT_FALSE(a.get(perf_event::cache_misses).has_value());
+    EXPECT_FALSE(perf_sample{}.ipc().has_value());
+}
+
+TEST(perf_counters, count) {
+    // The counters may be unavailable, for example in a container or a VM. Then every value is missing, and nothing fails.
+    perf_counters counters;
+    counters.start();
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i<1000000; ++i) { sum = sum+i; }
+    counters.stop();
+
+    const perf_sample sample = counters.read();
+    if (!counters.available()) {
+        for (const std::optional<uint64_t>& value : sample.values_) { EXPECT_FALSE(value.has_value()); }
+        GTEST_SKIP() << "perf_event_open is unavailable";
+    }
+    if (const std::optional<uint64_t> instructions = sample.get(perf_event::instructions)) { EXPECT_GE(*instructions, 1000000u); }
+
+    // Stopped counters do not change.
+    for (uint64_t i = 0; i<1000000; ++i) { sum = sum+i; }
+    EXPECT_EQ(counters.read().values_, sample.values_);
+}
+
+TEST(perf_counters, threads) {
+    thread_pool tp{2};
+    thread_perf_counters counters;
+    const std::vector<std::pair<pid_t, perf_sample>> samples = counters.read();
+    // The calling thread and the worker threads, at least.
+    ASSERT_GE(samples.size(), 3u);
+
+    counters.start();
+    for (int i = 0; i<100; ++i) {
+        tp.submit([]() { std::this_thread::sleep_for(std::chrono::microseconds{100}); }).get();
+    }
+    counters.stop();
+    if (!counters.available()) { GTEST_SKIP() << "perf_event_open is unavailable"; }
+
+    // Sleeping switches out the worker threads, and waiting switches out the calling thread.
+    if (const std::optional<uint64_t> context_switches = counters.read_total().get(perf_event::context_switches)) {
+        EXPECT_GT(*context_switches, 0u);
+    }
+}
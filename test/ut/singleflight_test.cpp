@@ -0,0 +1,44 @@
+#include "mt/sync/singleflight.h"
+#include <gtest/gtest.h>
+
+#include <latch>
+#include <thread>
+
+using namespace mkr;
+
+TEST(singleflight, coalesce) {
+    thread_pool tp{};
+    singleflight<int, std::string> flight;
+    std::atomic_int num_computations{0};
+
+    // Stay in flight until every other caller waits for the computation.
+    const int num_callers = 16;
+    std::latch callers_waiting{1};
+    auto compute = [&]() {
+        ++num_computations;
+        callers_waiting.wait();
+        return std::string{"value"};
+    };
+
+    std::vector<std::shared_ptr<const std::string>> results(num_callers);
+    std::vector<std::thread> callers;
+    for (int i = 0; i < num_callers; ++i) {
+        callers.emplace_back([&, i]() { results[i] = flight.call(tp, 42, compute); });
+    }
+    while (flight.num_waiting() < num_callers - 1) { std::this_thread::yield(); }
+    callers_waiting.count_down();
+    for (std::thread& caller : callers) { caller.join(); }
+    for (const auto& result : results) { EXPECT_EQ(*result, "value"); }
+
+    EXPECT_EQ(num_computations.load(), 1);
+    EXPECT_EQ(flight.num_in_flight(), 0u);
+    EXPECT_EQ(flight.num_waiting(), 0u);
+
+    // Once the computation has finished, the next caller computes a fresh value.
+    flight.call(42, compute);
+    EXPECT_EQ(num_computations.load(), 2);
+
+    // Exceptions are delivered to the caller.
+    EXPECT_THROW(flight.call(7, []() -> std::string { throw std::runtime_error{"failed"}; }), std::runtime_error);
+    EXPECT_EQ(flight.num_in_flight(), 0u);
+}
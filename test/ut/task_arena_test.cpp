@@ -0,0 +1,138 @@
+#include "mt/thread_pool/task_arena.h"
+#include "mt/algorithm/parallel_for.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <vector>
+
+using namespace mkr;
+
+namespace {
+    /// True while the calling thread waits inside an isolated region.
+    thread_local bool waiting_in_isolation = false;
+}
+
+TEST(task_arena, isolate) {
+    thread_pool tp{2};
+
+    // Outer work which a waiting thread would pick up if it was not isolated.
+    std::atomic_int outer_done{0}, picked_up_while_isolated{0};
+    for (int i = 0; i<8; ++i) {
+        tp.post([&]() {
+            if (waiting_in_isolation) { ++picked_up_while_isolated; }
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+            ++outer_done;
+        });
+    }
+
+    const int result = isolate(tp, [&]() {
+        waiting_in_isolation = true;
+        std::future<int> inner = tp.submit([]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds{20});
+            return 42;
+        });
+        tp.run_pending_tasks(inner);
+        waiting_in_isolation = false;
+        return inner.get();
+    });
+    EXPECT_EQ(result, 42);
+    EXPECT_EQ(picked_up_while_isolated.load(), 0);
+
+    // Forking and joining inside an arena stays inside it.
+    const long leaves = isolate(tp, [&]() {
+        std::function<long(int)> tree = [&](int _depth) -> long {
+            if (_depth==0) { return 1; }
+            fork_handle<long> left = tp.fork(tree, _depth-1);
+            const long right = tree(_depth-1);
+            tp.run_pending_tasks(left);
+            return left.get()+right;
+        };
+        return tree(8);
+    });
+    EXPECT_EQ(leaves, 256);
+
+    while (outer_done.load()!=8) { tp.run_pending_task(); }
+}
+
+TEST(task_arena, max_concurrency) {
+    thread_pool tp{4};
+    task_arena arena{tp, 2};
+    EXPECT_EQ(arena.max_concurrency(), 2u);
+
+    std::atomic_int running{0}, max_running{0};
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i<16; ++i) {
+        futures.push_back(arena.submit([&]() {
+            int now = ++running;
+            int observed = max_running.load();
+            while (now>observed && !max_running.compare_exchange_weak(observed, now)) { }
+            std::this_thread::sleep_for(std::chrono::milliseconds{5});
+            --running;
+        }));
+    }
+    // Block without helping, so that only the pool's workers run the arena's tasks.
+    for (std::future<void>& f : futures) { f.get(); }
+    EXPECT_GE(max_running.load(), 1);
+    EXPECT_LE(max_running.load(), 2);
+}
+
+TEST(task_arena, executor) {
+    thread_pool tp{};
+    task_arena arena{tp};
+
+    std::vector<int> values(10000, 1);
+    std::atomic_long sum{0};
+    parallel_for(arena, blocked_range<std::size_t>{0, values.size(), 100}, [&](const blocked_range<std::size_t>& _range) {
+        long partial = 0;
+        for (std::size_t i = _range.begin(); i<_range.end(); ++i) { partial += values[i]; }
+        sum += partial;
+    });
+    EXPECT_EQ(sum.load(), 10000);
+}
+
+namespace {
+    /**
+     * Busy the calling thread for some CPU time.
+     */
+    void burn_cpu(std::chrono::microseconds _duration)
+    {
+        timespec start{}, now{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+        const long long end = start.tv_sec*1000000000LL+start.tv_nsec+std::chrono::nanoseconds{_duration}.count();
+        do {
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        } while (now.tv_sec*1000000000LL+now.tv_nsec<end);
+    }
+}
+
+TEST(task_arena, weighted_fair_sharing) {
+    thread_pool tp{2};
+    task_arena a{tp, 0, 7}, b{tp, 0, 3};
+
+    // Keep both tenants busy for a while.
+    std::atomic_bool stop{false};
+    for (int i = 0; i<4000; ++i) {
+        a.post([&]() { if (!stop.load()) { burn_cpu(std::chrono::microseconds{100}); } });
+        b.post([&]() { if (!stop.load()) { burn_cpu(std::chrono::microseconds{100}); } });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{200});
+    const double a_time = static_cast<double>(a.cpu_time().count());
+    const double b_time = static_cast<double>(b.cpu_time().count());
+    stop = true;
+
+    EXPECT_GT(a.num_tasks_run(), 0u);
+    EXPECT_GT(b.num_tasks_run(), 0u);
+    EXPECT_NEAR(a_time/(a_time+b_time), 0.7, 0.1);
+
+    // A tenant gets every worker while the other is idle.
+    while (a.num_tasks_run()+b.num_tasks_run()!=8000) {
+        if (!a.run_pending_task() && !b.run_pending_task()) { std::this_thread::yield(); }
+    }
+    const size_t b_tasks = b.num_tasks_run();
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i<100; ++i) { futures.push_back(a.submit([]() { burn_cpu(std::chrono::microseconds{100}); })); }
+    for (std::future<void>& f : futures) { f.get(); }
+    EXPECT_EQ(b.num_tasks_run(), b_tasks);
+}
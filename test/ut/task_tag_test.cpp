@@ -0,0 +1,63 @@
+#include "mt/thread_pool/thread_pool.h"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace mkr;
+
+TEST(task_tag, intern) {
+    const task_tag search = task_tag::intern("search");
+    EXPECT_EQ(task_tag::intern("search"), search);
+    EXPECT_NE(task_tag::intern("indexing"), search);
+    EXPECT_EQ(search.name(), "search");
+    EXPECT_FALSE(search.empty());
+    EXPECT_TRUE(task_tag{}.empty());
+    EXPECT_EQ(task_tag{}.name(), "");
+}
+
+TEST(task_tag, cpu_time_accounting) {
+    thread_pool tp{2};
+    const task_tag busy = task_tag::intern("busy");
+    const task_tag sleepy = task_tag::intern("sleepy");
+
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i<10; ++i) {
+        futures.push_back(tp.submit(busy, []() {
+            timespec start{}, now{};
+            clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+            do {
+                clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+            } while ((now.tv_sec-start.tv_sec)*1000000000LL+(now.tv_nsec-start.tv_nsec)<2000000);
+        }));
+        futures.push_back(tp.submit(sleepy, []() { std::this_thread::sleep_for(std::chrono::milliseconds{2}); }));
+        tp.post([]() { });
+    }
+    for (std::future<void>& f : futures) { f.get(); }
+
+    // A task's time is accounted after its result is set, so wait for the last tasks to be accounted.
+    std::vector<task_tag_stats> stats;
+    auto find = [&](const task_tag& _tag) {
+        auto iter = std::find_if(stats.begin(), stats.end(), [&](const task_tag_stats& _stats) { return _stats.tag_==_tag; });
+        return iter==stats.end() ? task_tag_stats{} : *iter;
+    };
+    do {
+        std::this_thread::yield();
+        stats = tp.get_tag_stats();
+    } while (find(busy).num_tasks_+find(sleepy).num_tasks_<20);
+    // Untagged tasks are not accounted.
+    for (const task_tag_stats& s : stats) { EXPECT_FALSE(s.tag_.empty()); }
+
+    const task_tag_stats busy_stats = find(busy);
+    EXPECT_EQ(busy_stats.num_tasks_, 10u);
+    EXPECT_GE(busy_stats.cpu_time_, std::chrono::milliseconds{20});
+    EXPECT_GE(busy_stats.wall_time_, busy_stats.cpu_time_);
+
+    // Sleeping uses wall time, but hardly any CPU time.
+    const task_tag_stats sleepy_stats = find(sleepy);
+    EXPECT_EQ(sleepy_stats.num_tasks_, 10u);
+    EXPECT_GE(sleepy_stats.wall_time_, std::chrono::milliseconds{20});
+    EXPECT_LT(sleepy_stats.cpu_time_, std::chrono::milliseconds{10});
+}
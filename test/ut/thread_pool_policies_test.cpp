@@ -0,0 +1,126 @@
+#include "mt/thread_pool/thread_pool.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using namespace mkr;
+
+namespace {
+    /// Every policy differs from the default.
+    struct lean_policies : thread_pool_policies {
+        template<typename T>
+        using global_queue = threadsafe_stack<T>;
+        typedef backoff_idle idle_policy;
+        static constexpr bool enable_stats = false;
+        typedef random_steal steal_policy;
+    };
+
+    /// Only the steal policy differs from the default.
+    struct random_steal_policies : thread_pool_policies {
+        typedef random_steal steal_policy;
+    };
+
+    /// Only the idle policy differs from the default.
+    struct backoff_idle_policies : thread_pool_policies {
+        typedef backoff_idle idle_policy;
+    };
+
+    template<typename Policies>
+    int fib(basic_thread_pool<Policies>& _thread_pool, int _n)
+    {
+        if (_n<2) { return _n; }
+        fork_handle<int> left = _thread_pool.fork([&_thread_pool, _n]() { return fib(_thread_pool, _n-1); });
+        const int right = fib(_thread_pool, _n-2);
+        _thread_pool.run_pending_tasks(left);
+        return left.get()+right;
+    }
+}
+
+static_assert(std::is_same_v<thread_pool, basic_thread_pool<thread_pool_policies>>);
+static_assert(executor<basic_thread_pool<lean_policies>>);
+
+TEST(thread_pool_policies, lean) {
+    basic_thread_pool<lean_policies> tp{3};
+
+    EXPECT_EQ(tp.submit([]() { return 42; }).get(), 42);
+    EXPECT_EQ(tp.submit(fib<lean_policies>, std::ref(tp), 18).get(), 2584);
+
+    std::atomic_int sum{0};
+    std::vector<std::future<void>> futures;
+    for (int i = 1; i<=100; ++i) {
+        futures.push_back(tp.submit(task_tag::intern("lean"), [&sum, i]() { sum += i; }));
+    }
+    for (std::future<void>& f : futures) { tp.run_pending_tasks(f); }
+    EXPECT_EQ(sum.load(), 5050);
+
+    // Without stats, nothing is counted, but the queues are still measured.
+    const thread_pool_stats stats = tp.get_stats();
+    EXPECT_EQ(stats.num_threads_, 3u);
+    EXPECT_EQ(stats.local_queue_depths_.size(), 3u);
+    EXPECT_EQ(stats.num_tasks_run_, 0u);
+    EXPECT_EQ(stats.latency_count_, 0u);
+    EXPECT_TRUE(tp.get_tag_stats().empty());
+    EXPECT_FALSE(tp.running_task(0).has_value());
+}
+
+TEST(thread_pool_policies, lean_post_lvalue) {
+    basic_thread_pool<lean_policies> tp{1};
+
+    // Keep the only worker busy, so that the posted task outlives the lambda it was posted from.
+    std::atomic_bool started{false};
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    tp.post([&started, released]() {
+        started = true;
+        released.wait();
+    });
+    while (!started) { std::this_thread::yield(); }
+
+    std::atomic_int sum{0};
+    {
+        int value = 21;
+        auto add = [&sum, value]() { sum += value; };
+        tp.post(add);
+        tp.post(task_tag::intern("lean"), add);
+    }
+    // Overwrite the stack where the lambda was.
+    {
+        volatile int scratch[64];
+        for (int i = 0; i<64; ++i) { scratch[i] = -1; }
+    }
+    release.set_value();
+    const auto deadline = std::chrono::steady_clock::now()+std::chrono::seconds{5};
+    while (sum.load()!=42 && std::chrono::steady_clock::now()<deadline) { std::this_thread::yield(); }
+    EXPECT_EQ(sum.load(), 42);
+}
+
+TEST(thread_pool_policies, random_steal) {
+    basic_thread_pool<random_steal_policies> tp{4};
+    EXPECT_EQ(fib(tp, 20), 6765);
+
+    const thread_pool_stats stats = tp.get_stats();
+    EXPECT_GT(stats.num_tasks_run_, 0u);
+
+    for (int i = 0; i<100; ++i) { EXPECT_LT(random_steal::first_victim(0, 3), 3u); }
+    EXPECT_EQ(random_steal::first_victim(0, 0), 0u);
+}
+
+TEST(thread_pool_policies, backoff_idle) {
+    basic_thread_pool<backoff_idle_policies> tp{2};
+
+    for (int i = 0; i<3; ++i) {
+        // Give the workers time to back off until they sleep for max_sleep.
+        std::this_thread::sleep_for(std::chrono::milliseconds{50});
+
+        // Wait without helping, so that a sleeping worker must wake up and run the task.
+        std::future<std::thread::id> runner = tp.submit([]() { return std::this_thread::get_id(); });
+        ASSERT_EQ(runner.wait_for(std::chrono::seconds{1}), std::future_status::ready);
+        EXPECT_NE(runner.get(), std::this_thread::get_id());
+    }
+}
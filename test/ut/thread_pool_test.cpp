@@ -0,0 +1,102 @@
+#include "mt/thread_pool/thread_pool.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+using namespace mkr;
+
+namespace {
+    /// The number of fork_join_tree frames on the calling thread's stack.
+    thread_local int stack_depth = 0;
+
+    /**
+     * Recursively fork a binary tree of tasks and record the deepest stack of frames seen on any thread.
+     * @return The number of leaves.
+     */
+    long fork_join_tree(thread_pool& _thread_pool, int _depth, std::atomic_int& _max_stack_depth)
+    {
+        ++stack_depth;
+        int observed = _max_stack_depth.load();
+        while (stack_depth>observed && !_max_stack_depth.compare_exchange_weak(observed, stack_depth)) { }
+
+        long leaves;
+        if (_depth==0) {
+            // Give thieves time to steal.
+            volatile long sum = 0;
+            for (int i = 0; i<2000; ++i) { sum = sum+i; }
+            leaves = 1;
+        }
+        else {
+            fork_handle<long> fork = _thread_pool.fork([&_thread_pool, _depth, &_max_stack_depth]() {
+                return fork_join_tree(_thread_pool, _depth-1, _max_stack_depth);
+            });
+            leaves = fork_join_tree(_thread_pool, _depth-1, _max_stack_depth);
+            _thread_pool.run_pending_tasks(fork);
+            leaves += fork.get();
+        }
+
+        --stack_depth;
+        return leaves;
+    }
+}
+
+TEST(thread_pool, fork_join) {
+    thread_pool tp{4};
+
+    fork_handle<int> result = tp.fork([](int _x) { return _x*2; }, 21);
+    tp.run_pending_tasks(result);
+    EXPECT_EQ(result.get(), 42);
+
+    fork_handle<void> failed = tp.fork([]() { throw std::runtime_error{"failed"}; });
+    tp.run_pending_tasks(failed);
+    EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(thread_pool, fork_join_from_outside) {
+    thread_pool tp{1};
+
+    // The only worker is busy until the forked task has run, so the joining thread must run it.
+    std::atomic_bool started{false};
+    std::atomic_bool forked_ran{false};
+    std::future<void> blocker = tp.submit([&]() {
+        started = true;
+        while (!forked_ran) { std::this_thread::yield(); }
+    });
+    while (!started) { std::this_thread::yield(); }
+
+    fork_handle<int> result = tp.fork([&]() {
+        forked_ran = true;
+        return 42;
+    });
+    tp.run_pending_tasks(result);
+    EXPECT_EQ(result.get(), 42);
+    tp.run_pending_tasks(blocker);
+
+    // A task forked by the busy worker sits in its local task queue, so the joining thread must steal it.
+    std::atomic_bool parent_forked{false};
+    std::atomic_bool child_ran{false};
+    std::future<void> parent = tp.submit([&]() {
+        fork_handle<void> child = tp.fork([&]() { child_ran = true; });
+        parent_forked = true;
+        while (!child_ran) { std::this_thread::yield(); }
+        tp.run_pending_tasks(child);
+    });
+    while (!parent_forked) { std::this_thread::yield(); }
+    tp.run_pending_tasks(parent);
+    EXPECT_TRUE(child_ran.load());
+}
+
+TEST(thread_pool, leapfrogging) {
+    thread_pool tp{4};
+    const int depth = 14;
+
+    // Join from inside the pool, so that every join is by a worker.
+    std::atomic_int max_stack_depth{0};
+    fork_handle<long> root = tp.fork([&]() { return fork_join_tree(tp, depth, max_stack_depth); });
+    tp.run_pending_tasks(root);
+    EXPECT_EQ(root.get(), 1L << depth);
+
+    // A joining worker only runs descendants of the task it waits for, so a stack never holds more frames than the tree is deep.
+    EXPECT_LE(max_stack_depth.load(), depth+1);
+}
@@ -0,0 +1,54 @@
+#include "mt/thread_pool/thread_pool_watchdog.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+using namespace mkr;
+
+TEST(thread_pool_watchdog, reports_stalled_task) {
+    thread_pool tp{2};
+    std::mutex mutex;
+    std::vector<stalled_task> stalls;
+    {
+        thread_pool_watchdog watchdog{tp, std::chrono::milliseconds{50}, [&](const stalled_task& _stall) {
+            std::lock_guard lock{mutex};
+            stalls.push_back(_stall);
+        }, std::chrono::milliseconds{5}};
+
+        // Short tasks are not reported.
+        for (int i = 0; i<100; ++i) { tp.submit([]() { }).get(); }
+
+        std::future<void> hung = tp.submit([]() { std::this_thread::sleep_for(std::chrono::milliseconds{300}); });
+        hung.get();
+
+        // An idle pool has nothing to report.
+        EXPECT_TRUE(watchdog.check().empty());
+    }
+
+    // The stall is reported once, while the task is still running.
+    ASSERT_EQ(stalls.size(), 1u);
+    EXPECT_LT(stalls[0].worker_index_, 2u);
+    EXPECT_GT(stalls[0].running_time_, std::chrono::milliseconds{50});
+    EXPECT_LT(stalls[0].running_time_, std::chrono::milliseconds{300});
+}
+
+TEST(thread_pool_watchdog, reports_tag) {
+    thread_pool tp{1};
+    const task_tag tag = task_tag::intern("watchdog_test");
+    std::mutex mutex;
+    std::vector<stalled_task> stalls;
+    {
+        thread_pool_watchdog watchdog{tp, std::chrono::milliseconds{20}, [&](const stalled_task& _stall) {
+            std::lock_guard lock{mutex};
+            stalls.push_back(_stall);
+        }, std::chrono::milliseconds{5}};
+        tp.submit(tag, []() { std::this_thread::sleep_for(std::chrono::milliseconds{100}); }).get();
+    }
+
+    ASSERT_EQ(stalls.size(), 1u);
+    EXPECT_EQ(stalls[0].worker_index_, 0u);
+    EXPECT_EQ(stalls[0].tag_, tag);
+}
@@ -0,0 +1,97 @@
+#include "mt/thread_pool/thread_pool.h"
+#include "mt/thread_pool/task_arena.h"
+#include "counting_allocator.h"
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace mkr;
+
+TEST(worker_startup, lazy_construction) {
+    // No thread is created until a task is submitted, so the thread pool can be constructed and destroyed cheaply.
+    const auto start_time = std::chrono::steady_clock::now();
+    for (int i = 0; i<100; ++i) {
+        thread_pool tp{8, worker_startup::lazy};
+        EXPECT_EQ(tp.num_started_threads(), 0u);
+    }
+    const auto duration = std::chrono::steady_clock::now()-start_time;
+    std::cout << "Average Lazy Construction and Destruction Time (8 Threads): "
+              << std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()/100 << "ns" << std::endl;
+
+    // Nor are the counters allocated, so construction only allocates the queues: a few allocations and bytes per worker thread.
+    const allocation_counts before = get_allocation_counts();
+    {
+        thread_pool tp{8, worker_startup::lazy};
+        const allocation_counts constructed = get_allocation_counts();
+        std::cout << "Lazy Construction (8 Threads): " << constructed.num_allocations_-before.num_allocations_ << " Allocations, "
+                  << constructed.allocated_bytes_-before.allocated_bytes_ << " Bytes" << std::endl;
+        EXPECT_LE(constructed.num_allocations_-before.num_allocations_, 4u*8u);
+        EXPECT_LE(constructed.allocated_bytes_-before.allocated_bytes_, 384u*8u);
+    }
+
+    thread_pool eager{8};
+    EXPECT_EQ(eager.num_started_threads(), 8u);
+}
+
+TEST(worker_startup, lazy_grows_with_load) {
+    thread_pool tp{4, worker_startup::lazy};
+
+    // A single task at a time needs few workers. The next task may be submitted before the worker which finished the last one is idle
+    // again, which creates a second worker, but then one of the two is always idle.
+    for (int i = 0; i<100; ++i) { EXPECT_EQ(tp.submit([]() { return 1; }).get(), 1); }
+    EXPECT_GE(tp.num_started_threads(), 1u);
+    EXPECT_LE(tp.num_started_threads(), 2u);
+
+    // A burst of tasks queues up behind the first, so more workers are created.
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i<16; ++i) {
+        futures.push_back(tp.submit([]() { std::this_thread::sleep_for(std::chrono::milliseconds{1}); }));
+    }
+    for (std::future<void>& f : futures) { f.get(); }
+    EXPECT_LE(tp.num_started_threads(), 4u);
+    EXPECT_GE(tp.num_started_threads(), 2u);
+}
+
+TEST(worker_startup, lazy_blocking_tasks) {
+    // A task which blocks on a later one must not keep it from running, as with an eager thread pool of the same size.
+    // The CPU budget must also let a second worker run while the first is blocked, whatever the number of CPUs.
+    cpu_budget& budget = cpu_budget::get_instance();
+    const size_t old_limit = budget.limit();
+    budget.set_limit(4);
+    {
+        thread_pool tp{4, worker_startup::lazy};
+        std::promise<int> promise;
+        std::future<int> a = tp.submit([&promise]() { return promise.get_future().get(); });
+        std::future<void> b = tp.submit([&promise]() { promise.set_value(42); });
+
+        EXPECT_EQ(a.wait_for(std::chrono::seconds{5}), std::future_status::ready);
+        b.get();
+        EXPECT_EQ(a.get(), 42);
+        EXPECT_GE(tp.num_started_threads(), 2u);
+    }
+    budget.set_limit(old_limit);
+}
+
+TEST(worker_startup, lazy_fork_join_and_arena) {
+    thread_pool tp{3, worker_startup::lazy};
+    std::function<int(int)> fib = [&](int _n) -> int {
+        if (_n<2) { return _n; }
+        fork_handle<int> left = tp.fork(fib, _n-1);
+        const int right = fib(_n-2);
+        tp.run_pending_tasks(left);
+        return left.get()+right;
+    };
+    EXPECT_EQ(tp.submit(fib, 15).get(), 610);
+
+    thread_pool arena_pool{2, worker_startup::lazy};
+    task_arena arena{arena_pool};
+    std::atomic_int sum{0};
+    for (int i = 1; i<=100; ++i) { arena.post([&sum, i]() { sum += i; }); }
+    while (sum.load()!=5050) { std::this_thread::yield(); }
+    EXPECT_GE(arena_pool.num_started_threads(), 1u);
+}